@@ -35,6 +35,28 @@ Item {
                         text: model.description
                         onEditingFinished: model.description = text
                         Layout.fillWidth: true
+
+                        // Files dropped on an item are attached to it.
+                        DropArea {
+                            anchors.fill: parent
+                            keys: ["text/uri-list"]
+                            onDropped: (drop) => {
+                                for (const url of drop.urls)
+                                    todoList.attachFile(index, url)
+                            }
+                        }
+                    }
+                    // Decoded off the GUI thread by the thumbnail provider.
+                    Repeater {
+                        model: attachments
+                        delegate: Image {
+                            source: "image://thumbnails/" + modelData
+                            sourceSize: Qt.size(32, 32)
+                            asynchronous: true
+                            fillMode: Image.PreserveAspectFit
+                            Layout.preferredWidth: 32
+                            Layout.preferredHeight: 32
+                        }
                     }
                 }
             }
@@ -0,0 +1,153 @@
+#include "ReminderScheduler.h"
+#include "ToDoList.h"
+
+#include <QDateTime>
+
+namespace {
+
+constexpr qint64 TickMs = 1000;
+
+quint64 currentTick()
+{
+    return quint64(QDateTime::currentMSecsSinceEpoch() / TickMs);
+}
+
+// Rounded up, so a reminder never fires early.
+quint64 tickFor(qint64 due)
+{
+    return quint64((due + TickMs - 1) / TickMs);
+}
+
+}
+
+ReminderScheduler::ReminderScheduler(QObject *parent)
+    : QObject(parent)
+    , mList(nullptr)
+    , mWheel(currentTick())
+    , mInsertFirst(-1)
+{
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &ReminderScheduler::fire);
+}
+
+ToDoList *ReminderScheduler::list() const
+{
+    return mList;
+}
+
+void ReminderScheduler::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, [=]() {
+            const int index = mList->items().size() - 1;
+            updateRows(index, index);
+        });
+        connect(mList, &ToDoList::itemChanged, this, [=](int index) {
+            updateRows(index, index);
+        });
+        connect(mList, &ToDoList::preItemRemoved, this, [=](int index) {
+            removeRows(index, index);
+        });
+
+        connect(mList, &ToDoList::preItemsInserted, this, [=](int first) {
+            mInsertFirst = first;
+        });
+        connect(mList, &ToDoList::postItemsInserted, this, [=]() {
+            updateRows(mInsertFirst, mList->items().size() - 1);
+        });
+        connect(mList, &ToDoList::itemsChanged, this, &ReminderScheduler::updateRows);
+        connect(mList, &ToDoList::preItemsRemoved, this, &ReminderScheduler::removeRows);
+        connect(mList, &ToDoList::postItemsReset, this, &ReminderScheduler::rebuild);
+    }
+
+    emit listChanged();
+    rebuild();
+}
+
+int ReminderScheduler::pending() const
+{
+    return mWheel.size();
+}
+
+void ReminderScheduler::rebuild()
+{
+    mWheel.clear(currentTick());
+    if (mList) {
+        const QVector<ToDoItem> items = mList->items();
+        for (const ToDoItem &item : items) {
+            if (item.due && !item.done)
+                mWheel.schedule(item.id, tickFor(item.due));
+        }
+    }
+
+    emit pendingChanged();
+    arm();
+}
+
+void ReminderScheduler::updateRows(int first, int last)
+{
+    const QVector<ToDoItem> items = mList->items();
+    for (int i = first; i <= last && i < items.size(); ++i) {
+        const ToDoItem &item = items.at(i);
+        if (item.due && !item.done)
+            mWheel.schedule(item.id, tickFor(item.due));
+        else
+            mWheel.cancel(item.id);
+    }
+
+    emit pendingChanged();
+    arm();
+}
+
+void ReminderScheduler::removeRows(int first, int last)
+{
+    const QVector<ToDoItem> items = mList->items();
+    for (int i = first; i <= last; ++i)
+        mWheel.cancel(items.at(i).id);
+
+    emit pendingChanged();
+    arm();
+}
+
+void ReminderScheduler::fire()
+{
+    // The timer may fire late, or the clock may have jumped; whatever is
+    // due by now goes out in one batch.
+    const QVector<quint32> ids = mWheel.advance(currentTick());
+    if (!ids.isEmpty() && mList) {
+        QList<int> indexes;
+        indexes.reserve(ids.size());
+        for (const quint32 id : ids) {
+            const int index = mList->indexOfId(id);
+            if (index >= 0)
+                indexes.append(index);
+        }
+        emit pendingChanged();
+        if (!indexes.isEmpty())
+            emit remindersDue(indexes);
+    }
+
+    arm();
+}
+
+void ReminderScheduler::arm()
+{
+    const quint64 next = mWheel.nextTick();
+    if (next == TimingWheel::NoTick) {
+        mTimer.stop();
+        return;
+    }
+
+    const qint64 delay = std::max<qint64>(0, qint64(next) * TickMs - QDateTime::currentMSecsSinceEpoch());
+    // Far-off reminders are re-armed on the way, which also bounds the
+    // effect of clock changes.
+    mTimer.start(int(std::min<qint64>(delay, 3600 * TickMs)));
+}
@@ -0,0 +1,53 @@
+#ifndef REMINDERSCHEDULER_H
+#define REMINDERSCHEDULER_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QTimer>
+
+#include "TimingWheel.h"
+
+class ToDoList;
+
+// Emits remindersDue() when the due times of open items of a ToDoList pass.
+//
+// Due times are kept in a TimingWheel at one-second resolution and follow
+// the list's edits and removals. A single timer is armed for the next tick
+// that has work, so an idle scheduler does not wake up, and all items that
+// come due together are reported by one signal.
+class ReminderScheduler : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(int pending READ pending NOTIFY pendingChanged)
+
+public:
+    explicit ReminderScheduler(QObject *parent = nullptr);
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    int pending() const;
+
+signals:
+    void listChanged();
+    void pendingChanged();
+
+    // Rows of the items that came due, in due order.
+    void remindersDue(const QList<int> &indexes);
+
+private:
+    void rebuild();
+    void updateRows(int first, int last);
+    void removeRows(int first, int last);
+    void fire();
+    void arm();
+
+    ToDoList* mList;
+    TimingWheel mWheel;
+    QTimer mTimer;
+    int mInsertFirst;
+};
+
+#endif // REMINDERSCHEDULER_H
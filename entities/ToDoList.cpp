@@ -1,9 +1,83 @@
 #include "ToDoList.h"
+#include "ActivityFile.h"
+#include "BlobStore.h"
+#include "ChangeFeed.h"
+#include "CsvFile.h"
+#include "IndexFile.h"
+#include "ListFile.h"
+#include "Trigrams.h"
 
-ToDoList::ToDoList(QObject *parent) : QObject(parent)
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Whether an edit changes anything the list stores for the item.
+bool sameContents(const ToDoItem &a, const ToDoItem &b)
+{
+    return a.done == b.done && a.description == b.description && a.tags == b.tags && a.due == b.due
+           && a.priority == b.priority && a.recurrence == b.recurrence && a.attachments == b.attachments
+           && a.consumed == b.consumed;
+}
+
+// Folds what a duplicate adds into the item it duplicates.
+void mergeInto(ToDoItem *item, const ToDoItem &duplicate)
+{
+    QVector<quint32> tags = item->tags + duplicate.tags;
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+    item->tags = tags;
+
+    for (const QString &attachment : duplicate.attachments) {
+        if (!item->attachments.contains(attachment))
+            item->attachments.append(attachment);
+    }
+    item->priority = std::max(item->priority, duplicate.priority);
+    if (duplicate.due && (!item->due || duplicate.due < item->due))
+        item->due = duplicate.due;
+}
+
+PriorityIndex::Key urgencyKey(const ToDoItem &item)
 {
-    mItems.append({ true, QStringLiteral("Wash the car") });
-    mItems.append({ false, QStringLiteral("Fix the sink") });
+    return { item.priority, item.due, item.id };
+}
+
+}
+
+ToDoList::ToDoList(QObject *parent)
+    : QObject(parent)
+    , mIdentity(QUuid::createUuid())
+    , mReloadWatcher(new QFutureWatcher<ListContents>(this))
+{
+    mReloadTimer.setSingleShot(true);
+    mReloadTimer.setInterval(250);
+    connect(&mFileWatcher, &QFileSystemWatcher::fileChanged, &mReloadTimer, qOverload<>(&QTimer::start));
+    connect(&mReloadTimer, &QTimer::timeout, this, &ToDoList::startReload);
+    connect(mReloadWatcher, &QFutureWatcher<ListContents>::finished, this, [=]() {
+        if (!mReloadWatcher->isCanceled())
+            applyReload(mReloadWatcher->result());
+    });
+
+    connect(&mCollationWatcher, &QFutureWatcher<CollationKeys>::finished, this, [=]() {
+        if (mCollationWatcher.isCanceled())
+            return;
+
+        // Descriptions edited while the keys were being built are keyed
+        // again on the next comparison.
+        mCollationKeys = mCollationWatcher.result();
+        for (const ToDoItem &item : std::as_const(mItems)) {
+            if (item.version > mCollationVersion)
+                mCollationKeys.invalidate(item.id);
+        }
+        emit collationChanged();
+    });
+
+    addItem({ true, QStringLiteral("Wash the car") });
+    addItem({ false, QStringLiteral("Fix the sink") });
 }
 
 QVector<ToDoItem> ToDoList::items() const
@@ -16,32 +90,624 @@ bool ToDoList::setItemAt(int index, const ToDoItem &item)
     if (index < 0 || index >= mItems.size())
         return false;
 
-    const ToDoItem &oldItem = mItems.at(index);
-    if (item.done == oldItem.done && item.description == oldItem.description)
+    // The identity and position in the tree are owned by the list.
+    const ToDoItem oldItem = mItems.at(index);
+    ToDoItem newItem = item;
+    newItem.id = oldItem.id;
+    newItem.parentId = oldItem.parentId;
+    newItem.seriesId = oldItem.seriesId;
+    newItem.occurrence = oldItem.occurrence;
+    newItem.consumed = oldItem.consumed;
+    std::sort(newItem.tags.begin(), newItem.tags.end());
+    newItem.tags.erase(std::unique(newItem.tags.begin(), newItem.tags.end()), newItem.tags.end());
+
+    if (sameContents(newItem, oldItem))
+        return false;
+
+    newItem.created = oldItem.created;
+    newItem.modified = QDateTime::currentMSecsSinceEpoch();
+    newItem.completed = !newItem.done ? 0 : oldItem.done ? oldItem.completed : newItem.modified;
+
+    newItem.version = ++mVersion;
+    mItems[index] = newItem;
+    updateIndexes(&oldItem, &newItem);
+
+    if (newItem.done && !oldItem.done) {
+        mActivity.record(ActivitySeries::Completed, newItem.completed);
+        mActivityDirty = true;
+    }
+
+    emit itemChanged(index);
+    return true;
+}
+
+void ToDoList::appendItems(const QVector<ToDoItem> &items)
+{
+    if (items.isEmpty())
+        return;
+
+    // Items of the batch get consecutive ids from mNextId, so duplicates
+    // within the batch are tracked under the ids they are going to have.
+    QVector<ToDoItem> accepted;
+    accepted.reserve(items.size());
+    QHash<int, ToDoItem> merged;
+    DuplicateIndex batch;
+    if (mDuplicatePolicy != AllowDuplicates)
+        updateDuplicates();
+
+    for (ToDoItem item : items) {
+        item.parentId = 0;
+        item.duplicateOf = 0;
+        std::sort(item.tags.begin(), item.tags.end());
+        item.tags.erase(std::unique(item.tags.begin(), item.tags.end()), item.tags.end());
+
+        if (mDuplicatePolicy != AllowDuplicates) {
+            const DuplicateIndex::Key key = DuplicateIndex::keyOf(item.description);
+            const quint32 original = findDuplicate(key, item.description, batch, accepted);
+            if (original && mDuplicatePolicy == RejectDuplicates)
+                continue;
+            if (original && mDuplicatePolicy == MergeDuplicates) {
+                if (original >= mNextId) {
+                    mergeInto(&accepted[original - mNextId], item);
+                } else {
+                    const int row = indexOfId(original);
+                    auto it = merged.find(row);
+                    if (it == merged.end())
+                        it = merged.insert(row, mItems.at(row));
+                    mergeInto(&*it, item);
+                }
+                continue;
+            }
+            item.duplicateOf = original;
+            batch.insert(mNextId + quint32(accepted.size()), key);
+        }
+        accepted.append(item);
+    }
+
+    if (!accepted.isEmpty()) {
+        emit preItemsInserted(mItems.size(), mItems.size() + accepted.size() - 1);
+
+        // The batch index already has the keys of the new items.
+        const bool duplicatesDirty = mDuplicatesDirty;
+        mDuplicatesDirty = true;
+        mItems.reserve(mItems.size() + accepted.size());
+        for (const ToDoItem &item : std::as_const(accepted))
+            addItem(item);
+        mDuplicatesDirty = duplicatesDirty;
+        if (!mDuplicatesDirty)
+            mDuplicates.insert(batch);
+
+        emit postItemsInserted();
+    }
+
+    for (auto it = merged.cbegin(); it != merged.cend(); ++it)
+        setItemAt(it.key(), it.value());
+}
+
+quint32 ToDoList::findDuplicate(const DuplicateIndex::Key &key, const QString &description,
+                                const DuplicateIndex &batch, const QVector<ToDoItem> &batchItems) const
+{
+    const auto descriptionOf = [&](quint32 id) {
+        return id >= mNextId ? batchItems.at(id - mNextId).description : mItems.at(indexOfId(id)).description;
+    };
+
+    // Hash collisions aside, an exact match is exact.
+    const QString normalized = DuplicateIndex::normalized(description);
+    for (const DuplicateIndex *index : { &mDuplicates, &batch }) {
+        const quint32 id = index->exactDuplicate(key, [&](quint32 candidate) {
+            return DuplicateIndex::normalized(descriptionOf(candidate)) == normalized;
+        });
+        if (id)
+            return id;
+    }
+    for (const DuplicateIndex *index : { &mDuplicates, &batch }) {
+        if (const quint32 id = index->nearDuplicate(key))
+            return id;
+    }
+    return 0;
+}
+
+void ToDoList::updateDuplicates()
+{
+    if (!mDuplicatesDirty)
+        return;
+
+    mDuplicates.clear();
+    for (const ToDoItem &item : std::as_const(mItems))
+        mDuplicates.insert(item.id, DuplicateIndex::keyOf(item.description));
+    mDuplicatesDirty = false;
+}
+
+int ToDoList::indexOfId(quint32 id) const
+{
+    if (mIndexByIdDirty) {
+        mIndexById.clear();
+        mIndexById.reserve(mItems.size());
+        for (int i = 0; i < mItems.size(); ++i)
+            mIndexById.insert(mItems.at(i).id, i);
+        mIndexByIdDirty = false;
+    }
+
+    return mIndexById.value(id, -1);
+}
+
+quint64 ToDoList::version() const
+{
+    return mVersion;
+}
+
+ChangeSet ToDoList::changesSince(quint64 version) const
+{
+    ChangeSet changes;
+    changes.fromVersion = version;
+    changes.toVersion = mVersion;
+
+    if (version > mVersion || !mChanges.covers(version)) {
+        changes.snapshot = true;
+        changes.inserts = mItems;
+        return changes;
+    }
+
+    // Net effect per id: whether it was created and whether it still exists.
+    QHash<quint32, bool> inserted;
+    QSet<quint32> deleted;
+    for (const ChangeRing::Entry &entry : mChanges.entriesSince(version)) {
+        if (!inserted.contains(entry.id))
+            inserted.insert(entry.id, entry.operation == ChangeRing::Insert);
+        if (entry.operation == ChangeRing::Delete)
+            deleted.insert(entry.id);
+    }
+
+    QVector<int> rows;
+    for (auto it = inserted.cbegin(); it != inserted.cend(); ++it) {
+        if (!deleted.contains(it.key()))
+            rows.append(indexOfId(it.key()));
+        else if (!it.value())
+            changes.deletes.append(it.key());
+    }
+
+    std::sort(rows.begin(), rows.end());
+    std::sort(changes.deletes.begin(), changes.deletes.end());
+    for (const int row : std::as_const(rows)) {
+        const ToDoItem &item = mItems.at(row);
+        if (inserted.value(item.id))
+            changes.inserts.append(item);
+        else
+            changes.updates.append(item);
+    }
+    return changes;
+}
+
+QByteArray ToDoList::exportChangesSince(quint64 version) const
+{
+    return ChangeFeed::toNdjson(changesSince(version), *this);
+}
+
+quint32 ToDoList::internTag(const QString &name)
+{
+    const QString key = name.trimmed();
+    if (key.isEmpty())
+        return 0;
+
+    quint32 tag = mTagIds.value(key);
+    if (!tag) {
+        mTagNames.append(key);
+        tag = quint32(mTagNames.size());
+        mTagIds.insert(key, tag);
+    }
+    return tag;
+}
+
+QVector<quint32> ToDoList::internTags(const QStringList &names)
+{
+    QVector<quint32> tags;
+    tags.reserve(names.size());
+    for (const QString &name : names) {
+        if (const quint32 tag = internTag(name))
+            tags.append(tag);
+    }
+    return tags;
+}
+
+quint32 ToDoList::tagId(const QString &name) const
+{
+    return mTagIds.value(name.trimmed());
+}
+
+QString ToDoList::tagName(quint32 tag) const
+{
+    return tag > 0 && tag <= quint32(mTagNames.size()) ? mTagNames.at(tag - 1) : QString();
+}
+
+QStringList ToDoList::tagNames(const QVector<quint32> &tags) const
+{
+    QStringList names;
+    names.reserve(tags.size());
+    for (const quint32 tag : tags)
+        names.append(tagName(tag));
+    return names;
+}
+
+QStringList ToDoList::allTags() const
+{
+    return mTagNames;
+}
+
+bool ToDoList::setItemTags(int index, const QStringList &tags)
+{
+    if (index < 0 || index >= mItems.size())
+        return false;
+
+    ToDoItem item = mItems.at(index);
+    item.tags = internTags(tags);
+    return setItemAt(index, item);
+}
+
+bool ToDoList::attachFile(int index, const QUrl &file)
+{
+    if (index < 0 || index >= mItems.size())
         return false;
 
-    mItems[index] = item;
+    // Hashing and copying can take a while for large files. The item is
+    // looked up again by id afterwards; it may have moved, or the list may
+    // have been replaced by another file.
+    const quint32 id = mItems.at(index).id;
+    const QUuid identity = mIdentity;
+    auto *watcher = new QFutureWatcher<QPair<QString, QString>>(this);
+    connect(watcher, &QFutureWatcher<QPair<QString, QString>>::finished, this, [=]() {
+        const auto [hash, error] = watcher->result();
+        watcher->deleteLater();
+        if (hash.isEmpty()) {
+            mErrorString = error;
+            emit attachFailed(file, error);
+            return;
+        }
+
+        const int index = identity == mIdentity ? indexOfId(id) : -1;
+        if (index < 0)
+            return;
+        ToDoItem item = mItems.at(index);
+        if (item.attachments.contains(hash))
+            return;
+        item.attachments.append(hash);
+        setItemAt(index, item);
+    });
+    watcher->setFuture(QtConcurrent::run([filePath = file.isLocalFile() ? file.toLocalFile() : file.toString()]() {
+        BlobStore store;
+        const QString hash = store.put(filePath);
+        return qMakePair(hash, store.errorString());
+    }));
     return true;
 }
 
+bool ToDoList::detachFile(int index, const QString &hash)
+{
+    if (index < 0 || index >= mItems.size())
+        return false;
+
+    // The blob stays in the store; other items may share it.
+    ToDoItem item = mItems.at(index);
+    return item.attachments.removeAll(hash) > 0 && setItemAt(index, item);
+}
+
+const CustomFieldStore &ToDoList::customFields() const
+{
+    return mCustomFields;
+}
+
+QStringList ToDoList::customFieldNames() const
+{
+    return mCustomFields.fieldNames();
+}
+
+QVariant ToDoList::customField(int index, const QString &name) const
+{
+    if (index < 0 || index >= mItems.size())
+        return QVariant();
+    return mCustomFields.value(mItems.at(index).id, name);
+}
+
+bool ToDoList::setCustomField(int index, const QString &name, const QVariant &value)
+{
+    if (index < 0 || index >= mItems.size())
+        return false;
+
+    const ToDoItem oldItem = mItems.at(index);
+    const int fieldCount = mCustomFields.fieldNames().size();
+    if (!mCustomFields.setValue(oldItem.id, name, value))
+        return false;
+
+    ToDoItem newItem = oldItem;
+    newItem.modified = QDateTime::currentMSecsSinceEpoch();
+    newItem.version = ++mVersion;
+    mItems[index] = newItem;
+    updateIndexes(&oldItem, &newItem);
+
+    if (mCustomFields.fieldNames().size() != fieldCount)
+        emit customFieldsChanged();
+    emit itemChanged(index);
+    return true;
+}
+
+const RoaringBitmap &ToDoList::liveIds() const
+{
+    return mLiveIds;
+}
+
+const RoaringBitmap &ToDoList::doneIds() const
+{
+    return mDoneIds;
+}
+
+const BitmapIndex &ToDoList::tagIndex() const
+{
+    return mTagIndex;
+}
+
+const BitmapIndex &ToDoList::textIndex() const
+{
+    return mTextIndex;
+}
+
+const CompletionTrie &ToDoList::completions() const
+{
+    if (mCompletionsDirty) {
+        mCompletions.clear();
+        for (const ToDoItem &item : mItems)
+            mCompletions.insert(completionKey(item.description), item.description.simplified(), item.version);
+        mCompletionsDirty = false;
+    }
+    return mCompletions;
+}
+
+QStringList ToDoList::complete(const QString &prefix, int limit) const
+{
+    QStringList texts;
+    const QVector<CompletionTrie::Completion> completions = completions().complete(completionKey(prefix), limit);
+    for (const CompletionTrie::Completion &completion : completions)
+        texts.append(completion.text);
+    return texts;
+}
+
+QString ToDoList::completionKey(const QString &description)
+{
+    return description.simplified().toCaseFolded();
+}
+
+QLocale ToDoList::collationLocale() const
+{
+    return mCollationLocale;
+}
+
+void ToDoList::setCollationLocale(const QLocale &locale)
+{
+    if (locale == mCollationLocale)
+        return;
+
+    mCollationLocale = locale;
+    mCollationVersion = mVersion;
+    mCollationWatcher.setFuture(QtConcurrent::run([locale, items = mItems]() {
+        return CollationKeys::build(locale, items);
+    }));
+}
+
+int ToDoList::compareDescriptions(const ToDoItem &a, const ToDoItem &b) const
+{
+    mCollationKeys.update(mItems);
+    return mCollationKeys.compare(a, b);
+}
+
+QVector<quint32> ToDoList::nextUp(int count) const
+{
+    return mNextUp.first(count);
+}
+
+QVector<quint32> ToDoList::idsBetween(TimeField field, qint64 from, qint64 to) const
+{
+    switch(field){
+    case Created:
+        return mCreatedIndex.range(from, to);
+    case Modified:
+        return mModifiedIndex.range(from, to);
+    case Completed:
+        return mCompletedIndex.range(from, to);
+    }
+
+    return QVector<quint32>();
+}
+
+QList<int> ToDoList::rowsBetween(TimeField field, const QDateTime &from, const QDateTime &to) const
+{
+    // An invalid bound leaves that end of the range open.
+    const qint64 begin = from.isValid() ? from.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    const qint64 end = to.isValid() ? to.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+
+    QList<int> rows;
+    for (const quint32 id : idsBetween(field, begin, end))
+        rows.append(indexOfId(id));
+    return rows;
+}
+
+const CalendarIndex &ToDoList::calendar() const
+{
+    return mCalendar;
+}
+
+void ToDoList::refreshCalendar()
+{
+    mCalendar.refresh();
+}
+
+QVector<Occurrence> ToDoList::occurrences(qint64 from, qint64 to, int limit) const
+{
+    QVector<Occurrence> occurrences;
+    mRecurringIds.forEach([&](quint32 id) {
+        const ToDoItem &series = mItems.at(indexOfId(id));
+        for (const qint64 time : series.recurrence.occurrences(series.due, from, to, limit)) {
+            const quint32 stored = mStoredOccurrences.value({ id, time });
+            if (stored || !std::binary_search(series.consumed.cbegin(), series.consumed.cend(), time))
+                occurrences.append({ id, time, stored });
+        }
+    });
+
+    std::sort(occurrences.begin(), occurrences.end(), [](const Occurrence &a, const Occurrence &b) {
+        return a.time != b.time ? a.time < b.time : a.seriesId < b.seriesId;
+    });
+    if (occurrences.size() > limit)
+        occurrences.resize(limit);
+    return occurrences;
+}
+
+int ToDoList::materializeOccurrence(quint32 seriesId, qint64 time)
+{
+    if (const quint32 stored = mStoredOccurrences.value({ seriesId, time }))
+        return indexOfId(stored);
+
+    const int seriesIndex = indexOfId(seriesId);
+    if (seriesIndex < 0 || !mItems.at(seriesIndex).recurrence.isValid())
+        return -1;
+
+    const ToDoItem &series = mItems.at(seriesIndex);
+    ToDoItem item;
+    item.done = false;
+    item.description = series.description;
+    item.tags = series.tags;
+    item.priority = series.priority;
+    item.due = time;
+    item.seriesId = seriesId;
+    item.occurrence = time;
+
+    const QVariantHash fields = mCustomFields.fields(seriesId);
+
+    const auto consumed = std::lower_bound(series.consumed.cbegin(), series.consumed.cend(), time);
+    if (consumed == series.consumed.cend() || *consumed != time) {
+        const ToDoItem oldSeries = series;
+        ToDoItem newSeries = series;
+        newSeries.consumed.insert(consumed - series.consumed.cbegin(), time);
+        newSeries.version = ++mVersion;
+        mItems[seriesIndex] = newSeries;
+        updateIndexes(&oldSeries, &newSeries);
+        emit itemChanged(seriesIndex);
+    }
+
+    emit preItemAppended();
+    addItem(item);
+    mCustomFields.setFields(mItems.last().id, fields);
+    emit postItemAppended();
+    return mItems.size() - 1;
+}
+
+const ActivitySeries &ToDoList::activity() const
+{
+    return mActivity;
+}
+
+RoaringBitmap ToDoList::filterIds(const QStringList &withTags, const QStringList &withoutTags,
+                                  bool includeDone) const
+{
+    RoaringBitmap result = mLiveIds;
+    for (const QString &name : withTags) {
+        const quint32 tag = tagId(name);
+        if (!tag)
+            return RoaringBitmap();
+        result = result & mTagIndex.bitmap(tag);
+    }
+    for (const QString &name : withoutTags) {
+        if (const quint32 tag = tagId(name))
+            result = result.andNot(mTagIndex.bitmap(tag));
+    }
+    if (!includeDone)
+        result = result.andNot(mDoneIds);
+    return result;
+}
+
+QList<int> ToDoList::filterRows(const QStringList &withTags, const QStringList &withoutTags,
+                                bool includeDone) const
+{
+    QList<int> rows;
+    filterIds(withTags, withoutTags, includeDone).forEach([&](quint32 id) {
+        rows.append(indexOfId(id));
+    });
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
 void ToDoList::appendItem()
 {
     emit preItemAppended();
 
     ToDoItem item;
     item.done = false;
-    mItems.append(item);
+    addItem(item);
+
+    emit postItemAppended();
+}
+
+void ToDoList::appendSubItem(int parentIndex)
+{
+    if (parentIndex < 0 || parentIndex >= mItems.size())
+        return;
+
+    emit preItemAppended();
+
+    ToDoItem item;
+    item.done = false;
+    item.parentId = mItems.at(parentIndex).id;
+    addItem(item);
 
     emit postItemAppended();
 }
 
 void ToDoList::removeCompletedItems()
 {
+    if (!mArchivePath.isEmpty()) {
+        const QDateTime now = QDateTime::currentDateTimeUtc();
+        QVector<ArchiveFile::Entry> entries;
+        // Taken before the removal below, which drops the custom fields.
+        for (const ToDoItem &item : std::as_const(mItems)) {
+            if (!item.done)
+                continue;
+
+            ArchiveFile::Entry entry;
+            entry.id = item.id;
+            entry.done = item.done;
+            entry.description = item.description;
+            entry.tags = tagNames(item.tags);
+            entry.archivedAt = now;
+            entry.parentId = item.parentId;
+            entry.created = item.created;
+            entry.modified = item.modified;
+            entry.completed = item.completed;
+            entry.due = item.due;
+            entry.priority = item.priority;
+            entry.recurrence = item.recurrence.toString();
+            entry.seriesId = item.seriesId;
+            entry.occurrence = item.occurrence;
+            entry.consumed = item.consumed;
+            entry.attachments = item.attachments;
+            entry.customFields = mCustomFields.fields(item.id);
+            entries.append(entry);
+        }
+
+        if (!entries.isEmpty()) {
+            if (!mArchive.append(entries)) {
+                mErrorString = mArchive.errorString();
+                return;
+            }
+            emit itemsArchived();
+        }
+    }
+
     for (int i = 0; i < mItems.size(); ) {
         if (mItems.at(i).done) {
             emit preItemRemoved(i);
 
-            mItems.removeAt(i);
+            const ToDoItem item = mItems.takeAt(i);
+            mIndexByIdDirty = true;
+            ++mVersion;
+            updateIndexes(&item, nullptr);
+            mActivity.record(ActivitySeries::Removed, QDateTime::currentMSecsSinceEpoch());
+            mActivityDirty = true;
 
             emit postItemRemoved();
         } else {
@@ -49,3 +715,738 @@ void ToDoList::removeCompletedItems()
         }
     }
 }
+
+void ToDoList::addItem(ToDoItem item)
+{
+    item.id = mNextId++;
+    item.created = QDateTime::currentMSecsSinceEpoch();
+    item.modified = item.created;
+    item.completed = item.done ? item.created : 0;
+    mActivity.record(ActivitySeries::Created, item.created);
+    mActivityDirty = true;
+    item.version = ++mVersion;
+    mItems.append(item);
+    if (!mIndexByIdDirty)
+        mIndexById.insert(item.id, mItems.size() - 1);
+    updateIndexes(nullptr, &item);
+}
+
+void ToDoList::updateIndexes(const ToDoItem *oldItem, const ToDoItem *newItem)
+{
+    // Every mutation funnels through here with the item before and after the
+    // change; either side is null for insertions and removals.
+    const quint32 id = newItem ? newItem->id : oldItem->id;
+
+    if (newItem) {
+        mDirtyIds.add(id);
+    } else {
+        mDirtyIds.remove(id);
+        mRemovedIds.add(id);
+        mCustomFields.removeItem(id);
+    }
+    mChanges.record(mVersion, id, !oldItem ? ChangeRing::Insert
+                                  : !newItem ? ChangeRing::Delete
+                                             : ChangeRing::Update);
+
+    if (!oldItem)
+        mLiveIds.add(id);
+    else if (!newItem)
+        mLiveIds.remove(id);
+
+    const bool wasDone = oldItem && oldItem->done;
+    const bool isDone = newItem && newItem->done;
+    if (isDone && !wasDone)
+        mDoneIds.add(id);
+    else if (wasDone && !isDone)
+        mDoneIds.remove(id);
+
+    const bool wasOpen = oldItem && !oldItem->done;
+    const bool isOpen = newItem && !newItem->done;
+    if (wasOpen != isOpen || (isOpen && (oldItem->priority != newItem->priority || oldItem->due != newItem->due))) {
+        if (wasOpen)
+            mNextUp.remove(urgencyKey(*oldItem));
+        if (isOpen)
+            mNextUp.insert(urgencyKey(*newItem));
+    }
+
+    const auto updateTime = [](TimeIndex &index, quint32 id, qint64 oldTime, qint64 newTime) {
+        if (oldTime == newTime)
+            return;
+        if (oldTime)
+            index.remove(oldTime, id);
+        if (newTime)
+            index.insert(newTime, id);
+    };
+    updateTime(mCreatedIndex, id, oldItem ? oldItem->created : 0, newItem ? newItem->created : 0);
+    updateTime(mModifiedIndex, id, oldItem ? oldItem->modified : 0, newItem ? newItem->modified : 0);
+    updateTime(mCompletedIndex, id, oldItem ? oldItem->completed : 0, newItem ? newItem->completed : 0);
+
+    // A series ends when it is marked done.
+    const auto recurring = [](const ToDoItem *item) {
+        return item && !item->done && item->due && item->recurrence.isValid();
+    };
+    const bool wasRecurring = recurring(oldItem);
+    const bool isRecurring = recurring(newItem);
+    if (isRecurring && !wasRecurring)
+        mRecurringIds.add(id);
+    else if (wasRecurring && !isRecurring)
+        mRecurringIds.remove(id);
+
+    // Series and occurrence of an item never change.
+    if (!oldItem && newItem->seriesId)
+        mStoredOccurrences.insert({ newItem->seriesId, newItem->occurrence }, id);
+    else if (!newItem && oldItem->seriesId)
+        mStoredOccurrences.remove({ oldItem->seriesId, oldItem->occurrence });
+
+    const auto updateDay = [this](CalendarIndex::Kind kind, quint32 id, qint64 oldTime, qint64 newTime) {
+        if (oldTime == newTime)
+            return;
+        if (newTime)
+            mCalendar.insert(kind, id, newTime);
+        else
+            mCalendar.remove(kind, id);
+    };
+    updateDay(CalendarIndex::Due, id, oldItem ? oldItem->due : 0, newItem ? newItem->due : 0);
+    updateDay(CalendarIndex::Completed, id, oldItem ? oldItem->completed : 0, newItem ? newItem->completed : 0);
+
+    static const QVector<quint32> noTags;
+    const QVector<quint32> &oldTags = oldItem ? oldItem->tags : noTags;
+    const QVector<quint32> &newTags = newItem ? newItem->tags : noTags;
+    if (oldTags != newTags) {
+        for (const quint32 tag : oldTags) {
+            if (!std::binary_search(newTags.constBegin(), newTags.constEnd(), tag))
+                mTagIndex.remove(tag, id);
+        }
+        for (const quint32 tag : newTags) {
+            if (!std::binary_search(oldTags.constBegin(), oldTags.constEnd(), tag))
+                mTagIndex.add(tag, id);
+        }
+    }
+
+    const QString oldDescription = oldItem ? oldItem->description : QString();
+    const QString newDescription = newItem ? newItem->description : QString();
+    if (!newItem)
+        mCollationKeys.remove(id);
+    else if (!oldItem || oldDescription != newDescription)
+        mCollationKeys.invalidate(id);
+
+    if (oldDescription != newDescription) {
+        const QVector<quint32> oldTrigrams = Trigrams::of(oldDescription);
+        const QVector<quint32> newTrigrams = Trigrams::of(newDescription);
+        for (const quint32 trigram : oldTrigrams) {
+            if (!std::binary_search(newTrigrams.constBegin(), newTrigrams.constEnd(), trigram))
+                mTextIndex.remove(trigram, id);
+        }
+        for (const quint32 trigram : newTrigrams) {
+            if (!std::binary_search(oldTrigrams.constBegin(), oldTrigrams.constEnd(), trigram))
+                mTextIndex.add(trigram, id);
+        }
+
+        if (!mCompletionsDirty) {
+            mCompletions.remove(completionKey(oldDescription));
+            mCompletions.insert(completionKey(newDescription), newDescription.simplified(), mVersion);
+        }
+    }
+
+    if (!mDuplicatesDirty && (!oldItem || !newItem || oldDescription != newDescription)) {
+        mDuplicates.remove(id);
+        if (newItem)
+            mDuplicates.insert(id, DuplicateIndex::keyOf(newDescription));
+    }
+}
+
+bool ToDoList::load(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        mErrorString = file.errorString();
+        return false;
+    }
+
+    if (!load(&file, IndexFile::pathFor(filePath)))
+        return false;
+    setFilePath(filePath);
+    mActivity = ActivityFile::read(ActivityFile::pathFor(filePath), mIdentity);
+    mActivityDirty = false;
+    return true;
+}
+
+bool ToDoList::load(QIODevice *device)
+{
+    if (!load(device, QString()))
+        return false;
+
+    // The items no longer match the file they were loaded from.
+    mLayoutDirty = true;
+    return true;
+}
+
+bool ToDoList::load(QIODevice *device, const QString &indexFilePath)
+{
+    ListContents contents;
+    if (!ListFile::read(device, &contents, &mErrorString))
+        return false;
+
+    QSharedPointer<IndexFile> indexFile;
+    if (!indexFilePath.isEmpty())
+        indexFile = IndexFile::open(indexFilePath);
+    resetContents(contents, indexFile);
+    return true;
+}
+
+void ToDoList::resetContents(const ListContents &contents, QSharedPointer<IndexFile> indexFile)
+{
+    emit preItemsReset();
+
+    mItems = contents.items;
+    mIdentity = contents.identity;
+    mNextId = contents.nextId;
+    mTagNames = contents.tagNames;
+    mTagIds.clear();
+    for (int i = 0; i < mTagNames.size(); ++i)
+        mTagIds.insert(mTagNames.at(i), quint32(i + 1));
+    mIndexByIdDirty = true;
+    mCustomFields.clear();
+    for (auto it = contents.customFields.cbegin(); it != contents.customFields.cend(); ++it)
+        mCustomFields.setFields(it.key(), it.value());
+
+    if (indexFile && (indexFile->identity() != mIdentity || indexFile->listVersion() > contents.version))
+        indexFile.reset();
+    rebuildIndexes(indexFile);
+
+    // Versions are only compared within a list, but cached results keyed on
+    // the version of the list we replaced must not match the loaded one.
+    mVersion = std::max(mVersion, contents.version) + 1;
+    markSaved(contents.version);
+    mChanges.reset(mVersion);
+
+    emit postItemsReset();
+}
+
+bool ToDoList::save(const QString &filePath)
+{
+    const bool samePath = filePath == mFilePath;
+    if (!(samePath && !mLayoutDirty && saveChanges(filePath)) && !saveAll(filePath))
+        return false;
+
+    if (samePath && !mActivityDirty)
+        return true;
+    const QString activityPath = ActivityFile::pathFor(filePath);
+    if (!(samePath ? ActivityFile::append(activityPath, mIdentity, mActivity, &mErrorString)
+                   : ActivityFile::write(activityPath, mIdentity, mActivity, &mErrorString)))
+        return false;
+    mActivityDirty = false;
+    return true;
+}
+
+bool ToDoList::saveChanges(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    // Someone else wrote the file since, or it is due for compaction.
+    ListFile::Header header;
+    if (!ListFile::readHeader(&file, &header) || header.identity != mIdentity
+        || header.version != mSavedVersion || header.end - header.snapshotEnd > header.snapshotEnd / 2)
+        return false;
+
+    ListChanges changes;
+    changes.version = mVersion;
+    changes.nextId = mNextId;
+    changes.addedTagNames = mTagNames.mid(mSavedTagCount);
+    changes.removals = mRemovedIds.toVector();
+
+    QVector<int> rows;
+    rows.reserve(int(mDirtyIds.cardinality()));
+    mDirtyIds.forEach([&](quint32 id) {
+        rows.append(indexOfId(id));
+    });
+    std::sort(rows.begin(), rows.end());
+    for (const int row : std::as_const(rows)) {
+        const ToDoItem &item = mItems.at(row);
+        changes.upserts.append(item);
+        const QVariantHash fields = mCustomFields.fields(item.id);
+        if (!fields.isEmpty())
+            changes.customFields.insert(item.id, fields);
+    }
+
+    if (!ListFile::append(&file, changes, &mErrorString))
+        return false;
+
+    // The index file is left behind; items newer than it are reindexed on
+    // load, and compaction brings it up to date.
+    markSaved(mVersion);
+    return true;
+}
+
+bool ToDoList::saveAll(const QString &filePath)
+{
+    ListContents contents;
+    contents.identity = mIdentity;
+    contents.version = mVersion;
+    contents.nextId = mNextId;
+    contents.tagNames = mTagNames;
+    contents.items = mItems;
+    for (const ToDoItem &item : std::as_const(mItems)) {
+        const QVariantHash fields = mCustomFields.fields(item.id);
+        if (!fields.isEmpty())
+            contents.customFields.insert(item.id, fields);
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        mErrorString = file.errorString();
+        return false;
+    }
+    if (!ListFile::write(&file, contents) || !file.commit()) {
+        mErrorString = file.errorString();
+        return false;
+    }
+    setFilePath(filePath);
+    markSaved(mVersion);
+
+    // The indexes may still be backed by the mapping of the file about to be
+    // replaced. An index older than the list is still usable, so a failure
+    // here only costs reindexing on the next load.
+    mTagIndex.detach();
+    mTextIndex.detach();
+    return IndexFile::write(IndexFile::pathFor(filePath), mIdentity, mVersion, mLiveIds, mTagIndex,
+                            mTextIndex, &mErrorString);
+}
+
+bool ToDoList::importCsv(const QString &filePath)
+{
+    return CsvFile::read(filePath, this, &mErrorString);
+}
+
+bool ToDoList::exportCsv(const QString &filePath)
+{
+    return CsvFile::write(filePath, *this, &mErrorString);
+}
+
+QString ToDoList::errorString() const
+{
+    return mErrorString;
+}
+
+bool ToDoList::watchFile() const
+{
+    return mWatchFile;
+}
+
+void ToDoList::setWatchFile(bool watchFile)
+{
+    if (watchFile == mWatchFile)
+        return;
+
+    mWatchFile = watchFile;
+    updateWatchedFile();
+    emit watchFileChanged();
+}
+
+QString ToDoList::archivePath() const
+{
+    return mArchivePath;
+}
+
+void ToDoList::setArchivePath(const QString &archivePath)
+{
+    if (archivePath == mArchivePath)
+        return;
+
+    mArchivePath = archivePath;
+    mArchive = ArchiveFile(archivePath);
+    emit archivePathChanged();
+}
+
+ToDoList::DuplicatePolicy ToDoList::duplicatePolicy() const
+{
+    return mDuplicatePolicy;
+}
+
+void ToDoList::setDuplicatePolicy(DuplicatePolicy policy)
+{
+    if (policy == mDuplicatePolicy)
+        return;
+
+    mDuplicatePolicy = policy;
+    if (mDuplicatePolicy == AllowDuplicates) {
+        mDuplicates.clear();
+        mDuplicatesDirty = true;
+    }
+    emit duplicatePolicyChanged();
+}
+
+void ToDoList::markSaved(quint64 fileVersion)
+{
+    mDirtyIds.clear();
+    mRemovedIds.clear();
+    mLayoutDirty = false;
+    mSavedTagCount = mTagNames.size();
+    mSavedVersion = fileVersion;
+    mSavedNextId = mNextId;
+}
+
+void ToDoList::setFilePath(const QString &filePath)
+{
+    mFilePath = filePath;
+    updateWatchedFile();
+}
+
+void ToDoList::updateWatchedFile()
+{
+    // Replacing a file (as QSaveFile does) drops it from the watcher, so
+    // this is also called after every reload.
+    const QStringList watched = mFileWatcher.files();
+    if (!watched.isEmpty())
+        mFileWatcher.removePaths(watched);
+    if (mWatchFile && !mFilePath.isEmpty())
+        mFileWatcher.addPath(mFilePath);
+}
+
+void ToDoList::startReload()
+{
+    // The header alone tells whether the file still holds what was last
+    // loaded or saved, which is the common case after our own saves.
+    mReloadWatcher->setFuture(QtConcurrent::run([filePath = mFilePath, identity = mIdentity,
+                                                 savedVersion = mSavedVersion]() {
+        ListContents contents;
+        QFile file(filePath);
+        ListFile::Header header;
+        if (!file.open(QIODevice::ReadOnly) || !ListFile::readHeader(&file, &header))
+            return ListContents(); // probably still being written; another change follows
+        if (header.identity == identity && header.version == savedVersion)
+            return ListContents();
+
+        QString error;
+        if (!file.seek(0) || !ListFile::read(&file, &contents, &error))
+            return ListContents();
+        return contents;
+    }));
+}
+
+void ToDoList::applyReload(const ListContents &contents)
+{
+    updateWatchedFile();
+    if (contents.identity.isNull())
+        return;
+
+    // Our own save, or a rewrite without changes.
+    if (contents.identity == mIdentity && contents.version == mSavedVersion)
+        return;
+
+    if (contents.identity == mIdentity && applyDiff(contents))
+        return;
+
+    // A reordered file, or one replaced by another list, cannot be merged
+    // with unsaved local changes; those win, and the next save writes them
+    // over the file.
+    if (!(mDirtyIds.isEmpty() && mRemovedIds.isEmpty())) {
+        emit reloadConflicts((mDirtyIds | mRemovedIds).toVector());
+        return;
+    }
+    resetContents(contents, IndexFile::open(IndexFile::pathFor(mFilePath)));
+}
+
+void ToDoList::rekeyLocalItems(quint32 fileNextId)
+{
+    // Ids from mSavedNextId on were handed out here and, independently, by
+    // whoever wrote the file. The file's items keep theirs; the ones added
+    // here move above both counters, along with what refers to them.
+    if (fileNextId <= mSavedNextId || mNextId <= mSavedNextId)
+        return;
+
+    QHash<quint32, quint32> newIds;
+    quint32 nextId = std::max(mNextId, fileNextId);
+    for (const ToDoItem &item : std::as_const(mItems)) {
+        if (item.id >= mSavedNextId)
+            newIds.insert(item.id, nextId++);
+    }
+    mNextId = nextId;
+
+    // Items added and removed again here were never in the file.
+    const QVector<quint32> removedIds = mRemovedIds.toVector();
+    for (const quint32 id : removedIds) {
+        if (id >= mSavedNextId)
+            mRemovedIds.remove(id);
+    }
+    if (newIds.isEmpty())
+        return;
+
+    const auto rekeyed = [&](const ToDoItem &item) {
+        ToDoItem newItem = item;
+        newItem.id = newIds.value(item.id, item.id);
+        newItem.parentId = newIds.value(item.parentId, item.parentId);
+        newItem.seriesId = newIds.value(item.seriesId, item.seriesId);
+        newItem.duplicateOf = newIds.value(item.duplicateOf, item.duplicateOf);
+        return newItem;
+    };
+    const auto affected = [&](int index) {
+        const ToDoItem &item = mItems.at(index);
+        return newIds.contains(item.id) || newIds.contains(item.parentId) || newIds.contains(item.seriesId)
+               || newIds.contains(item.duplicateOf);
+    };
+
+    // Runs of affected rows go out and come back in under their new ids,
+    // so that nothing keyed by id keeps the old one.
+    for (int first = 0; first < mItems.size(); ) {
+        if (!affected(first)) {
+            ++first;
+            continue;
+        }
+        int last = first;
+        while (last + 1 < mItems.size() && affected(last + 1))
+            ++last;
+
+        QVector<ToDoItem> items;
+        QVector<QVariantHash> fields;
+        emit preItemsRemoved(first, last);
+        for (int i = last; i >= first; --i) {
+            const ToDoItem item = mItems.takeAt(i);
+            items.prepend(rekeyed(item));
+            fields.prepend(mCustomFields.fields(item.id));
+            ++mVersion;
+            updateIndexes(&item, nullptr);
+            // Either never saved, or coming right back under the same id.
+            mRemovedIds.remove(item.id);
+        }
+        mIndexByIdDirty = true;
+        emit postItemsRemoved();
+
+        emit preItemsInserted(first, last);
+        for (int i = 0; i < items.size(); ++i) {
+            ToDoItem &item = items[i];
+            item.version = ++mVersion;
+            mItems.insert(first + i, item);
+            mCustomFields.setFields(item.id, fields.at(i));
+            updateIndexes(nullptr, &item);
+        }
+        mIndexByIdDirty = true;
+        emit postItemsInserted();
+
+        first = last + 1;
+    }
+}
+
+bool ToDoList::applyDiff(const ListContents &contents)
+{
+    rekeyLocalItems(contents.nextId);
+
+    const int fieldCount = mCustomFields.fieldNames().size();
+    const RoaringBitmap localIds = mDirtyIds;
+    const RoaringBitmap localRemovedIds = mRemovedIds;
+    QVector<quint32> conflicts;
+    QHash<quint32, int> newIndexById;
+    newIndexById.reserve(contents.items.size());
+    for (int i = 0; i < contents.items.size(); ++i)
+        newIndexById.insert(contents.items.at(i).id, i);
+
+    // Only insertions, removals and edits are applied as ranges; if the
+    // items that were kept changed their order, reset instead.
+    int kept = 0;
+    for (const ToDoItem &item : std::as_const(mItems)) {
+        const int newIndex = newIndexById.value(item.id, -1);
+        if (newIndex < 0)
+            continue;
+        while (kept < contents.items.size() && indexOfId(contents.items.at(kept).id) < 0)
+            ++kept;
+        if (kept != newIndex)
+            return false;
+        ++kept;
+    }
+
+    // Removals, back to front so the ranges stay valid. Items changed here
+    // stay, whether the file removed them or never had them.
+    const auto removed = [&](const ToDoItem &item) {
+        return !newIndexById.contains(item.id) && !localIds.contains(item.id);
+    };
+    for (int last = mItems.size() - 1; last >= 0; ) {
+        if (!removed(mItems.at(last))) {
+            // Ids from before the last save were in the file, so the file
+            // removed an item edited here.
+            if (!newIndexById.contains(mItems.at(last).id) && mItems.at(last).id < mSavedNextId)
+                conflicts.append(mItems.at(last).id);
+            --last;
+            continue;
+        }
+        int first = last;
+        while (first > 0 && removed(mItems.at(first - 1)))
+            --first;
+
+        emit preItemsRemoved(first, last);
+        for (int i = last; i >= first; --i) {
+            const ToDoItem item = mItems.takeAt(i);
+            ++mVersion;
+            updateIndexes(&item, nullptr);
+        }
+        mIndexByIdDirty = true;
+        emit postItemsRemoved();
+
+        last = first - 1;
+    }
+
+    // Tags are interned per list, so the file's tag ids are translated.
+    const auto translated = [&](const ToDoItem &fileItem) {
+        ToDoItem item = fileItem;
+        QStringList names;
+        for (const quint32 tag : fileItem.tags)
+            names.append(contents.tagNames.value(int(tag) - 1));
+        item.tags = internTags(names);
+        std::sort(item.tags.begin(), item.tags.end());
+        item.tags.erase(std::unique(item.tags.begin(), item.tags.end()), item.tags.end());
+        return item;
+    };
+
+    // Edits, except to items changed here.
+    int changedFirst = -1;
+    for (int i = 0; i <= mItems.size(); ++i) {
+        bool changed = false;
+        const int newIndex = i < mItems.size() ? newIndexById.value(mItems.at(i).id, -1) : -1;
+        if (newIndex >= 0) {
+            const ToDoItem &oldItem = mItems.at(i);
+            ToDoItem newItem = translated(contents.items.at(newIndex));
+            const QVariantHash fields = contents.customFields.value(oldItem.id);
+            const bool differs = !sameContents(newItem, oldItem) || newItem.parentId != oldItem.parentId;
+            if (localIds.contains(oldItem.id)) {
+                if (differs || fields != mCustomFields.fields(oldItem.id))
+                    conflicts.append(oldItem.id);
+            } else {
+                changed = mCustomFields.setFields(oldItem.id, fields) || differs;
+            }
+            if (changed) {
+                const ToDoItem previous = oldItem;
+                newItem.version = ++mVersion;
+                mItems[i] = newItem;
+                updateIndexes(&previous, &newItem);
+            }
+        }
+        if (changed && changedFirst < 0) {
+            changedFirst = i;
+        } else if (!changed && changedFirst >= 0) {
+            emit itemsChanged(changedFirst, i - 1);
+            changedFirst = -1;
+        }
+    }
+
+    // Insertions, in runs of items that are new to us, right after the
+    // item before them in the file. Items removed here stay removed.
+    QSet<quint32> present;
+    present.reserve(mItems.size());
+    for (const ToDoItem &item : std::as_const(mItems))
+        present.insert(item.id);
+    const auto inserted = [&](int index) {
+        const quint32 id = contents.items.at(index).id;
+        return !present.contains(id) && !localRemovedIds.contains(id);
+    };
+
+    int position = 0;
+    for (int i = 0; i < contents.items.size(); ) {
+        if (!inserted(i)) {
+            if (present.contains(contents.items.at(i).id)) {
+                while (mItems.at(position).id != contents.items.at(i).id)
+                    ++position;
+                ++position;
+            }
+            ++i;
+            continue;
+        }
+        int last = i;
+        while (last + 1 < contents.items.size() && inserted(last + 1))
+            ++last;
+
+        emit preItemsInserted(position, position + last - i);
+        for (int j = i; j <= last; ++j) {
+            ToDoItem item = translated(contents.items.at(j));
+            item.version = ++mVersion;
+            mItems.insert(position++, item);
+            mCustomFields.setFields(item.id, contents.customFields.value(item.id));
+            updateIndexes(nullptr, &item);
+        }
+        mIndexByIdDirty = true;
+        emit postItemsInserted();
+
+        i = last + 1;
+    }
+
+    mNextId = std::max(mNextId, contents.nextId);
+    if (mCustomFields.fieldNames().size() != fieldCount)
+        emit customFieldsChanged();
+
+    // The file now matches the items apart from the local changes, which
+    // are still unsaved; it has its own tag numbering either way.
+    mDirtyIds = localIds;
+    mRemovedIds = localRemovedIds;
+    mSavedVersion = contents.version;
+    mLayoutDirty = true;
+    if (!conflicts.isEmpty())
+        emit reloadConflicts(conflicts);
+    return true;
+}
+
+void ToDoList::rebuildIndexes(const QSharedPointer<IndexFile> &indexFile)
+{
+    mLiveIds.clear();
+    mDoneIds.clear();
+    mTagIndex.clear();
+    mTextIndex.clear();
+    mCompletions.clear();
+    mCompletionsDirty = true;
+    mDuplicates.clear();
+    mDuplicatesDirty = true;
+
+    // Keys being built in the background belong to the previous items.
+    mCollationWatcher.cancel();
+    mCollationKeys = CollationKeys(mCollationLocale);
+
+    mNextUp.clear();
+    mCreatedIndex.clear();
+    mModifiedIndex.clear();
+    mCompletedIndex.clear();
+    mCalendar.clear();
+    mRecurringIds.clear();
+    mStoredOccurrences.clear();
+    for (const ToDoItem &item : std::as_const(mItems)) {
+        mLiveIds.add(item.id);
+        if (item.done)
+            mDoneIds.add(item.id);
+        else
+            mNextUp.insert(urgencyKey(item));
+        if (item.created)
+            mCreatedIndex.insert(item.created, item.id);
+        if (item.modified)
+            mModifiedIndex.insert(item.modified, item.id);
+        if (item.completed)
+            mCompletedIndex.insert(item.completed, item.id);
+        if (item.due)
+            mCalendar.insert(CalendarIndex::Due, item.id, item.due);
+        if (item.completed)
+            mCalendar.insert(CalendarIndex::Completed, item.id, item.completed);
+        if (!item.done && item.due && item.recurrence.isValid())
+            mRecurringIds.add(item.id);
+        if (item.seriesId)
+            mStoredOccurrences.insert({ item.seriesId, item.occurrence }, item.id);
+    }
+
+    // Postings of items removed or changed after the index was written are
+    // dropped as the bitmaps are loaded; those items are indexed again below.
+    RoaringBitmap staleIds;
+    if (indexFile) {
+        staleIds = indexFile->bitmap(IndexFile::LiveIds, 0).andNot(mLiveIds);
+        for (const ToDoItem &item : std::as_const(mItems)) {
+            if (item.version > indexFile->listVersion())
+                staleIds.add(item.id);
+        }
+        mTagIndex.attach(IndexFile::source(indexFile, IndexFile::Tags), staleIds);
+        mTextIndex.attach(IndexFile::source(indexFile, IndexFile::Text), staleIds);
+    }
+
+    for (const ToDoItem &item : std::as_const(mItems)) {
+        if (indexFile && !staleIds.contains(item.id))
+            continue;
+        for (const quint32 tag : item.tags)
+            mTagIndex.add(tag, item.id);
+        for (const quint32 trigram : Trigrams::of(item.description))
+            mTextIndex.add(trigram, item.id);
+    }
+}
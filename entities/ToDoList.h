@@ -1,26 +1,231 @@
 #ifndef TODOLIST_H
 #define TODOLIST_H
 
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QLocale>
 #include <QObject>
 #include <QVector>
+#include <QHash>
+#include <QStringList>
 #include <QQmlEngine>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QUrl>
+#include <QUuid>
+
+#include "ActivitySeries.h"
+#include "ArchiveFile.h"
+#include "BitmapIndex.h"
+#include "CalendarIndex.h"
+#include "ChangeRing.h"
+#include "CollationKeys.h"
+#include "CompletionTrie.h"
+#include "CustomFieldStore.h"
+#include "DuplicateIndex.h"
+#include "PriorityIndex.h"
+#include "Recurrence.h"
+#include "RoaringBitmap.h"
+#include "TimeIndex.h"
+
+struct ChangeSet;
+class IndexFile;
+class QIODevice;
+struct ListContents;
 
 struct ToDoItem
 {
     bool done;
     QString description;
+    quint32 id = 0;
+    quint32 parentId = 0; // 0 for top-level items
+    QVector<quint32> tags; // sorted ids interned by the owning ToDoList
+    quint64 version = 0; // list version of the last change to this item
+    qint64 due = 0; // ms since the epoch, 0 for none
+    int priority = 0; // higher comes first
+    // Maintained by the owning ToDoList, ms since the epoch.
+    qint64 created = 0;
+    qint64 modified = 0;
+    qint64 completed = 0; // 0 while not done
+    // Recurring items need a due time, the first occurrence. Occurrences are
+    // only stored once completed or edited, as items pointing back at the
+    // series and the occurrence they stand for. The series keeps the times
+    // it stored, sorted, so that removing such an item does not bring the
+    // occurrence back.
+    Recurrence recurrence;
+    quint32 seriesId = 0;
+    qint64 occurrence = 0;
+    QVector<qint64> consumed;
+    QStringList attachments; // hashes in the BlobStore
+    quint32 duplicateOf = 0; // set by ToDoList::FlagDuplicates
+};
+
+struct Occurrence
+{
+    quint32 seriesId = 0;
+    qint64 time = 0;
+    quint32 itemId = 0; // 0 while not stored
 };
 
 class ToDoList : public QObject
 {
     Q_OBJECT
     QML_ELEMENT
+    Q_PROPERTY(QLocale collationLocale READ collationLocale WRITE setCollationLocale NOTIFY collationChanged)
+    Q_PROPERTY(QString archivePath READ archivePath WRITE setArchivePath NOTIFY archivePathChanged)
+    Q_PROPERTY(bool watchFile READ watchFile WRITE setWatchFile NOTIFY watchFileChanged)
+    Q_PROPERTY(DuplicatePolicy duplicatePolicy READ duplicatePolicy WRITE setDuplicatePolicy NOTIFY duplicatePolicyChanged)
 public:
     explicit ToDoList(QObject *parent = nullptr);
 
+    enum TimeField {
+        Created,
+        Modified,
+        Completed
+    };
+    Q_ENUM(TimeField)
+
+    // What appendItems() does with an item whose description matches one in
+    // the list or earlier in the batch, exactly or nearly (see
+    // DuplicateIndex): add it anyway, drop it, fold its tags and attachments
+    // into the existing item, or add it with duplicateOf set.
+    enum DuplicatePolicy {
+        AllowDuplicates,
+        RejectDuplicates,
+        MergeDuplicates,
+        FlagDuplicates
+    };
+    Q_ENUM(DuplicatePolicy)
+
     QVector<ToDoItem> items() const;
 
     bool setItemAt(int index, const ToDoItem &item);
+    // Appends items as one range; ids and versions are assigned here.
+    void appendItems(const QVector<ToDoItem> &items);
+
+    int indexOfId(quint32 id) const;
+
+    // Bumped by every mutation; anything derived from the items can compare
+    // versions to know whether it is still current.
+    quint64 version() const;
+
+    // Net changes after version, per item. Falls back to a snapshot of all
+    // items when the retained history does not reach back that far.
+    ChangeSet changesSince(quint64 version) const;
+    // The same as NDJSON, see ChangeFeed.
+    Q_INVOKABLE QByteArray exportChangesSince(quint64 version) const;
+
+    // Tags are interned per list; ids start at 1.
+    quint32 internTag(const QString &name);
+    QVector<quint32> internTags(const QStringList &names);
+    quint32 tagId(const QString &name) const;
+    QString tagName(quint32 tag) const;
+    QStringList tagNames(const QVector<quint32> &tags) const;
+    Q_INVOKABLE QStringList allTags() const;
+
+    Q_INVOKABLE bool setItemTags(int index, const QStringList &tags);
+
+    // Copies a file into the attachment store on a worker thread and
+    // attaches it to the item once done, or emits attachFailed().
+    Q_INVOKABLE bool attachFile(int index, const QUrl &file);
+    Q_INVOKABLE bool detachFile(int index, const QString &hash);
+
+    // Fields defined by the user rather than the list, see CustomFieldStore.
+    // Setting one counts as an edit of the item; an invalid value removes it.
+    const CustomFieldStore &customFields() const;
+    Q_INVOKABLE QStringList customFieldNames() const;
+    Q_INVOKABLE QVariant customField(int index, const QString &name) const;
+    Q_INVOKABLE bool setCustomField(int index, const QString &name, const QVariant &value);
+
+    // Indexes kept up to date on every mutation.
+    const RoaringBitmap &liveIds() const;
+    const RoaringBitmap &doneIds() const;
+    const BitmapIndex &tagIndex() const;
+    // Trigram postings of the descriptions, see Trigrams.
+    const BitmapIndex &textIndex() const;
+    // Normalized descriptions ranked by how often and how recently they
+    // were used.
+    const CompletionTrie &completions() const;
+    Q_INVOKABLE QStringList complete(const QString &prefix, int limit = 5) const;
+    static QString completionKey(const QString &description);
+
+    // Orders items by description in collationLocale(). Sort keys are
+    // cached per item; after a locale change the old keys stay in use until
+    // the new ones have been built in the background and collationChanged()
+    // is emitted.
+    QLocale collationLocale() const;
+    void setCollationLocale(const QLocale &locale);
+    int compareDescriptions(const ToDoItem &a, const ToDoItem &b) const;
+
+    // Ids of the most urgent open items, see PriorityIndex.
+    QVector<quint32> nextUp(int count) const;
+
+    // Ids of the items whose field falls in [from, to), oldest first, read
+    // off a time-ordered index.
+    QVector<quint32> idsBetween(TimeField field, qint64 from, qint64 to) const;
+    Q_INVOKABLE QList<int> rowsBetween(TimeField field, const QDateTime &from, const QDateTime &to) const;
+
+    // Ids per local day of their due and completion dates. refreshCalendar()
+    // files them again after the system time zone changed; views call it
+    // once per update rather than on every read.
+    const CalendarIndex &calendar() const;
+    void refreshCalendar();
+
+    // Occurrences of all recurring items in [from, to), ordered by time.
+    // Stored occurrences take the place of the generated ones.
+    QVector<Occurrence> occurrences(qint64 from, qint64 to, int limit = 10000) const;
+    // Stores an occurrence as an item copying the series, if it is not
+    // stored yet, and returns its index; -1 if there is no such series.
+    int materializeOccurrence(quint32 seriesId, qint64 time);
+
+    // Created, completed and removed counts over time, saved next to the
+    // list file.
+    const ActivitySeries &activity() const;
+
+    // Ids of the items carrying all of withTags and none of withoutTags,
+    // evaluated on the bitmaps without touching the items.
+    RoaringBitmap filterIds(const QStringList &withTags, const QStringList &withoutTags,
+                            bool includeDone = true) const;
+    Q_INVOKABLE QList<int> filterRows(const QStringList &withTags,
+                                      const QStringList &withoutTags = QStringList(),
+                                      bool includeDone = true) const;
+
+    // The search indexes are stored next to the list file and mapped on
+    // load; only the items changed since they were written are reindexed.
+    Q_INVOKABLE bool load(const QString &filePath);
+    // Saving to the file last loaded or saved only appends the items
+    // changed since then, until the appended records outgrow half the file
+    // and it is compacted.
+    Q_INVOKABLE bool save(const QString &filePath);
+    // Bulk load from a stream in the list file format, indexing everything.
+    bool load(QIODevice *device);
+
+    // See CsvFile. Imported items are appended.
+    Q_INVOKABLE bool importCsv(const QString &filePath);
+    Q_INVOKABLE bool exportCsv(const QString &filePath);
+
+    // Reloads the file last loaded or saved when another process rewrites
+    // it. The file is read on a worker thread and only the items that
+    // differ by id are inserted, removed or changed. Items edited, added or
+    // removed here since the last save keep their local state; the ones
+    // whose copy in the file differs, or that the file removed, are
+    // reported by reloadConflicts(). Items added here move to new ids when
+    // the file added items of its own. A file that was reordered or
+    // replaced by another list is not loaded over local changes; all of
+    // them are reported instead.
+    bool watchFile() const;
+    void setWatchFile(bool watchFile);
+    Q_INVOKABLE QString errorString() const;
+
+    // When set, removeCompletedItems() moves the items to this ArchiveFile
+    // instead of discarding them, and keeps them if the archive cannot be
+    // written.
+    QString archivePath() const;
+    void setArchivePath(const QString &archivePath);
+
+    DuplicatePolicy duplicatePolicy() const;
+    void setDuplicatePolicy(DuplicatePolicy policy);
 
 signals:
     void preItemAppended();
@@ -29,12 +234,115 @@ signals:
     void preItemRemoved(int index);
     void postItemRemoved();
 
+    void itemChanged(int index);
+
+    void preItemsReset();
+    void postItemsReset();
+
+    // Contiguous ranges, used when applying a reloaded file.
+    void preItemsInserted(int first, int last);
+    void postItemsInserted();
+    void preItemsRemoved(int first, int last);
+    void postItemsRemoved();
+    void itemsChanged(int first, int last);
+
+    void collationChanged();
+
+    // A custom field was used for the first time.
+    void customFieldsChanged();
+
+    void archivePathChanged();
+    void itemsArchived();
+
+    void watchFileChanged();
+    void reloadConflicts(const QVector<quint32> &ids);
+
+    void attachFailed(const QUrl &file, const QString &error);
+
+    void duplicatePolicyChanged();
+
 public slots:
     void appendItem();
+    void appendSubItem(int parentIndex);
     void removeCompletedItems();
 
 private:
+    void addItem(ToDoItem item);
+    quint32 findDuplicate(const DuplicateIndex::Key &key, const QString &description,
+                          const DuplicateIndex &batch, const QVector<ToDoItem> &batchItems) const;
+    void updateDuplicates();
+    void updateIndexes(const ToDoItem *oldItem, const ToDoItem *newItem);
+    bool load(QIODevice *device, const QString &indexFilePath);
+    void resetContents(const ListContents &contents, QSharedPointer<IndexFile> indexFile);
+    void setFilePath(const QString &filePath);
+    void updateWatchedFile();
+    void startReload();
+    void applyReload(const ListContents &contents);
+    bool applyDiff(const ListContents &contents);
+    void rekeyLocalItems(quint32 fileNextId);
+    bool saveChanges(const QString &filePath);
+    bool saveAll(const QString &filePath);
+    void markSaved(quint64 fileVersion);
+    void rebuildIndexes(const QSharedPointer<IndexFile> &indexFile);
+
     QVector<ToDoItem> mItems;
+    quint32 mNextId = 1;
+    quint64 mVersion = 0;
+    ChangeRing mChanges;
+    QUuid mIdentity;
+    QString mErrorString;
+    QString mArchivePath;
+    ArchiveFile mArchive;
+
+    QString mFilePath;
+
+    // Changes not yet in mFilePath, by id. The layout flag is set when rows
+    // moved or tag ids were renumbered, which appending cannot express.
+    RoaringBitmap mDirtyIds;
+    RoaringBitmap mRemovedIds;
+    bool mLayoutDirty = true;
+    int mSavedTagCount = 0;
+    quint64 mSavedVersion = 0;
+    quint32 mSavedNextId = 1;
+    bool mWatchFile = false;
+    QFileSystemWatcher mFileWatcher;
+    QTimer mReloadTimer; // debounces bursts of change notifications
+    QFutureWatcher<ListContents> *mReloadWatcher;
+
+    // Rebuilt lazily after removals shift the indexes.
+    mutable QHash<quint32, int> mIndexById;
+    mutable bool mIndexByIdDirty = false;
+
+    QStringList mTagNames; // tag id - 1 -> name
+    QHash<QString, quint32> mTagIds;
+
+    RoaringBitmap mLiveIds;
+    RoaringBitmap mDoneIds;
+    BitmapIndex mTagIndex;
+    BitmapIndex mTextIndex;
+    PriorityIndex mNextUp;
+    TimeIndex mCreatedIndex;
+    TimeIndex mModifiedIndex;
+    TimeIndex mCompletedIndex;
+    CalendarIndex mCalendar;
+    RoaringBitmap mRecurringIds;
+    // (series id, occurrence time) to the id of the stored item.
+    QHash<QPair<quint32, qint64>, quint32> mStoredOccurrences;
+    CustomFieldStore mCustomFields;
+    ActivitySeries mActivity;
+    bool mActivityDirty = false;
+    // Rebuilt on first use after a load.
+    mutable CompletionTrie mCompletions;
+    mutable bool mCompletionsDirty = false;
+    // Only kept up to date while a policy needs it.
+    DuplicateIndex mDuplicates;
+    bool mDuplicatesDirty = true;
+    DuplicatePolicy mDuplicatePolicy = AllowDuplicates;
+
+    mutable CollationKeys mCollationKeys;
+    QLocale mCollationLocale;
+    QFutureWatcher<CollationKeys> mCollationWatcher;
+    quint64 mCollationVersion = 0; // list version the pending keys are built from
 };
 
 #endif // TODOLIST_H
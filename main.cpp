@@ -1,11 +1,18 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QQmlExtensionPlugin>
+
+#include "ThumbnailProvider.h"
+
+Q_IMPORT_QML_PLUGIN(QT_Quick_ModelViewPlugin)
 
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
 
     QQmlApplicationEngine engine;
+    // The engine takes ownership.
+    engine.addImageProvider(QStringLiteral("thumbnails"), new ThumbnailProvider);
     QObject::connect(
         &engine,
         &QQmlApplicationEngine::objectCreationFailed,
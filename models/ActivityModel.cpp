@@ -0,0 +1,202 @@
+#include "ActivityModel.h"
+#include "ToDoList.h"
+
+#include <QTimeZone>
+#include <QTimer>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+ActivityModel::ActivityModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mResolution(Day)
+    , mUpdatePending(false)
+    , mResetPending(false)
+{
+}
+
+int ActivityModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mPoints.size();
+}
+
+QVariant ActivityModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mPoints.size())
+        return QVariant();
+
+    const ActivitySeries::Point &point = mPoints.at(index.row());
+    switch(role){
+    case TimeRole:
+        return QVariant(QDateTime::fromMSecsSinceEpoch(point.time, QTimeZone::UTC));
+    case CreatedRole:
+        return QVariant(point.counts[ActivitySeries::Created]);
+    case CompletedRole:
+        return QVariant(point.counts[ActivitySeries::Completed]);
+    case RemovedRole:
+        return QVariant(point.counts[ActivitySeries::Removed]);
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> ActivityModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[TimeRole] = "time";
+    names[CreatedRole] = "created";
+    names[CompletedRole] = "completed";
+    names[RemovedRole] = "removed";
+    return names;
+}
+
+ToDoList *ActivityModel::list() const
+{
+    return mList;
+}
+
+void ActivityModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, &ActivityModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemRemoved, this, &ActivityModel::scheduleUpdate);
+        connect(mList, &ToDoList::itemChanged, this, &ActivityModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsInserted, this, &ActivityModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsRemoved, this, &ActivityModel::scheduleUpdate);
+        // A loaded file brings its own activity, set after the items.
+        connect(mList, &ToDoList::postItemsReset, this, &ActivityModel::scheduleReset);
+    }
+
+    emit listChanged();
+    update();
+}
+
+ActivityModel::Resolution ActivityModel::resolution() const
+{
+    return mResolution;
+}
+
+void ActivityModel::setResolution(Resolution resolution)
+{
+    if (mResolution == resolution)
+        return;
+
+    mResolution = resolution;
+    emit resolutionChanged();
+    update();
+}
+
+QDateTime ActivityModel::from() const
+{
+    return mFrom;
+}
+
+void ActivityModel::setFrom(const QDateTime &from)
+{
+    if (mFrom == from)
+        return;
+
+    mFrom = from;
+    emit rangeChanged();
+    update();
+}
+
+QDateTime ActivityModel::to() const
+{
+    return mTo;
+}
+
+void ActivityModel::setTo(const QDateTime &to)
+{
+    if (mTo == to)
+        return;
+
+    mTo = to;
+    emit rangeChanged();
+    update();
+}
+
+void ActivityModel::scheduleUpdate()
+{
+    if (mUpdatePending)
+        return;
+
+    mUpdatePending = true;
+    QTimer::singleShot(0, this, [=]() {
+        mUpdatePending = false;
+        if (mResetPending)
+            update();
+        else
+            updateTail();
+    });
+}
+
+void ActivityModel::scheduleReset()
+{
+    mResetPending = true;
+    scheduleUpdate();
+}
+
+void ActivityModel::update()
+{
+    mResetPending = false;
+    beginResetModel();
+
+    if (mList) {
+        const qint64 from = mFrom.isValid() ? mFrom.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+        const qint64 to = mTo.isValid() ? mTo.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+        mPoints = mList->activity().points(ActivitySeries::Resolution(mResolution), from, to);
+    } else {
+        mPoints.clear();
+    }
+
+    endResetModel();
+}
+
+void ActivityModel::updateTail()
+{
+    if (!mList)
+        return;
+
+    // Recording only counts into the open bucket of each resolution, which
+    // is the last row, or closes it and opens a later one. So only the
+    // buckets from the last row on are read again.
+    const qint64 from = mFrom.isValid() ? mFrom.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    const qint64 to = mTo.isValid() ? mTo.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+    const qint64 first = mPoints.isEmpty() ? from : mPoints.last().time;
+    const QVector<ActivitySeries::Point> tail = mList->activity().points(ActivitySeries::Resolution(mResolution), first, to);
+
+    int next = 0;
+    if (!mPoints.isEmpty()) {
+        if (tail.isEmpty() || tail.first().time != first) {
+            update();
+            return;
+        }
+        ActivitySeries::Point &last = mPoints.last();
+        if (!std::equal(std::begin(last.counts), std::end(last.counts), std::begin(tail.first().counts))) {
+            last = tail.first();
+            const QModelIndex changed = index(mPoints.size() - 1);
+            emit dataChanged(changed, changed, QVector<int>() << CreatedRole << CompletedRole << RemovedRole);
+        }
+        next = 1;
+    }
+
+    if (next < tail.size()) {
+        beginInsertRows(QModelIndex(), mPoints.size(), mPoints.size() + tail.size() - next - 1);
+        mPoints.append(tail.mid(next));
+        endInsertRows();
+    }
+}
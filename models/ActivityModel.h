@@ -0,0 +1,79 @@
+#ifndef ACTIVITYMODEL_H
+#define ACTIVITYMODEL_H
+
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QQmlEngine>
+
+#include "ActivitySeries.h"
+
+class ToDoList;
+
+// Activity of a ToDoList for charts: one row per minute, hour or day with
+// any activity between from and to (open ended when invalid), read from
+// the list's rollups.
+class ActivityModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(Resolution resolution READ resolution WRITE setResolution NOTIFY resolutionChanged)
+    Q_PROPERTY(QDateTime from READ from WRITE setFrom NOTIFY rangeChanged)
+    Q_PROPERTY(QDateTime to READ to WRITE setTo NOTIFY rangeChanged)
+
+public:
+    explicit ActivityModel(QObject *parent = nullptr);
+
+    enum Resolution {
+        Minute = ActivitySeries::Minute,
+        Hour = ActivitySeries::Hour,
+        Day = ActivitySeries::Day
+    };
+    Q_ENUM(Resolution)
+
+    enum {
+        TimeRole = Qt::UserRole,
+        CreatedRole,
+        CompletedRole,
+        RemovedRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    Resolution resolution() const;
+    void setResolution(Resolution resolution);
+
+    QDateTime from() const;
+    void setFrom(const QDateTime &from);
+
+    QDateTime to() const;
+    void setTo(const QDateTime &to);
+
+signals:
+    void listChanged();
+    void resolutionChanged();
+    void rangeChanged();
+
+private:
+    void scheduleUpdate();
+    void scheduleReset();
+    void update();
+    void updateTail();
+
+    ToDoList* mList;
+    Resolution mResolution;
+    QDateTime mFrom;
+    QDateTime mTo;
+    bool mUpdatePending;
+    bool mResetPending;
+    QVector<ActivitySeries::Point> mPoints;
+};
+
+#endif // ACTIVITYMODEL_H
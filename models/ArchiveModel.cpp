@@ -0,0 +1,175 @@
+#include "ArchiveModel.h"
+#include "ToDoList.h"
+
+ArchiveModel::ArchiveModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mPageSize(100)
+    , mNextBlock(-1)
+{
+}
+
+int ArchiveModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mEntries.size();
+}
+
+QVariant ArchiveModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mEntries.size())
+        return QVariant();
+
+    const ArchiveFile::Entry &entry = mEntries.at(index.row());
+    switch(role){
+    case DoneRole:
+        return QVariant(entry.done);
+    case DescriptionRole:
+        return QVariant(entry.description);
+    case TagsRole:
+        return QVariant(entry.tags);
+    case ArchivedAtRole:
+        return QVariant(entry.archivedAt);
+    case ItemIdRole:
+        return QVariant(entry.id);
+    case DueRole:
+        return entry.due ? QVariant(QDateTime::fromMSecsSinceEpoch(entry.due)) : QVariant();
+    case PriorityRole:
+        return QVariant(entry.priority);
+    case RecurrenceRole:
+        return QVariant(entry.recurrence);
+    case AttachmentsRole:
+        return QVariant(entry.attachments);
+    case CreatedRole:
+        return entry.created ? QVariant(QDateTime::fromMSecsSinceEpoch(entry.created)) : QVariant();
+    case ModifiedRole:
+        return entry.modified ? QVariant(QDateTime::fromMSecsSinceEpoch(entry.modified)) : QVariant();
+    case CompletedRole:
+        return entry.completed ? QVariant(QDateTime::fromMSecsSinceEpoch(entry.completed)) : QVariant();
+    case CustomFieldsRole:
+        return QVariant(entry.customFields);
+    }
+
+    return QVariant();
+}
+
+bool ArchiveModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && mNextBlock >= 0;
+}
+
+void ArchiveModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid())
+        return;
+
+    QVector<ArchiveFile::Entry> page;
+    while (mNextBlock >= 0 && page.size() < mPageSize) {
+        const int block = mNextBlock--;
+        if (!mArchive.mayContain(block, mWords))
+            continue;
+
+        const QVector<ArchiveFile::Entry> entries = mArchive.readBlock(block);
+        for (auto it = entries.crbegin(); it != entries.crend(); ++it) {
+            if (ArchiveFile::matches(*it, mWords))
+                page.append(*it);
+        }
+    }
+
+    if (page.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), mEntries.size(), mEntries.size() + page.size() - 1);
+    mEntries += page;
+    endInsertRows();
+}
+
+QHash<int, QByteArray> ArchiveModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DoneRole] = "done";
+    names[DescriptionRole] = "description";
+    names[TagsRole] = "tags";
+    names[ArchivedAtRole] = "archivedAt";
+    names[ItemIdRole] = "itemId";
+    names[DueRole] = "due";
+    names[PriorityRole] = "priority";
+    names[RecurrenceRole] = "recurrence";
+    names[AttachmentsRole] = "attachments";
+    names[CreatedRole] = "created";
+    names[ModifiedRole] = "modified";
+    names[CompletedRole] = "completed";
+    names[CustomFieldsRole] = "customFields";
+    return names;
+}
+
+ToDoList *ArchiveModel::list() const
+{
+    return mList;
+}
+
+void ArchiveModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+
+    if (mList) {
+        connect(mList, &ToDoList::archivePathChanged, this, &ArchiveModel::reload);
+        connect(mList, &ToDoList::itemsArchived, this, &ArchiveModel::reload);
+    }
+
+    emit listChanged();
+    reload();
+}
+
+QString ArchiveModel::query() const
+{
+    return mQuery;
+}
+
+void ArchiveModel::setQuery(const QString &query)
+{
+    if (query == mQuery)
+        return;
+
+    mQuery = query;
+    mWords = ArchiveFile::words(query);
+    emit queryChanged();
+
+    reload();
+}
+
+int ArchiveModel::pageSize() const
+{
+    return mPageSize;
+}
+
+void ArchiveModel::setPageSize(int pageSize)
+{
+    if (pageSize == mPageSize || pageSize <= 0)
+        return;
+
+    mPageSize = pageSize;
+    emit pageSizeChanged();
+}
+
+void ArchiveModel::reload()
+{
+    beginResetModel();
+
+    mEntries.clear();
+    mArchive = ArchiveFile(mList ? mList->archivePath() : QString());
+    if (mArchive.filePath().isEmpty() || !mArchive.open())
+        mNextBlock = -1;
+    else
+        mNextBlock = mArchive.blockCount() - 1;
+
+    endResetModel();
+}
@@ -0,0 +1,78 @@
+#ifndef ARCHIVEMODEL_H
+#define ARCHIVEMODEL_H
+
+#include <QAbstractListModel>
+#include <QQmlEngine>
+
+#include "ArchiveFile.h"
+
+class ToDoList;
+
+// Read-only view of the archive of a ToDoList, newest first. Blocks are
+// decompressed a page at a time as the view asks for more rows; with a
+// query set, blocks whose bloom filter rules out one of its words are
+// skipped without being read.
+class ArchiveModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+
+public:
+    explicit ArchiveModel(QObject *parent = nullptr);
+
+    enum {
+        DoneRole = Qt::UserRole,
+        DescriptionRole,
+        TagsRole,
+        ArchivedAtRole,
+        ItemIdRole,
+        DueRole,
+        PriorityRole,
+        RecurrenceRole,
+        AttachmentsRole,
+        CreatedRole,
+        ModifiedRole,
+        CompletedRole,
+        CustomFieldsRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    QString query() const;
+    void setQuery(const QString &query);
+
+    int pageSize() const;
+    void setPageSize(int pageSize);
+
+    Q_INVOKABLE void reload();
+
+signals:
+    void listChanged();
+    void queryChanged();
+    void pageSizeChanged();
+
+private:
+    ToDoList* mList;
+    QString mQuery;
+    QStringList mWords;
+    int mPageSize;
+
+    ArchiveFile mArchive;
+    int mNextBlock; // counts down, blocks are read newest first
+    QVector<ArchiveFile::Entry> mEntries;
+};
+
+#endif // ARCHIVEMODEL_H
@@ -0,0 +1,161 @@
+#include "CalendarModel.h"
+#include "ToDoList.h"
+
+#include <QCoreApplication>
+#include <QTimer>
+
+CalendarModel::CalendarModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mUpdatePending(false)
+{
+    // The application hears about time zone changes on the platforms that
+    // report them; elsewhere the next list update picks them up.
+    if (QCoreApplication::instance())
+        QCoreApplication::instance()->installEventFilter(this);
+}
+
+int CalendarModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !mFrom.isValid() || !mTo.isValid() || mTo < mFrom)
+        return 0;
+
+    return int(mFrom.daysTo(mTo)) + 1;
+}
+
+QVariant CalendarModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return QVariant();
+
+    const QDate date = mFrom.addDays(index.row());
+    if (role == DateRole)
+        return QVariant(date);
+    if (!mList)
+        return QVariant();
+
+    const CalendarIndex &calendar = mList->calendar();
+    const auto rows = [&](CalendarIndex::Kind kind) {
+        QVariantList rows;
+        calendar.ids(kind, date.toJulianDay()).forEach([&](quint32 id) {
+            rows.append(mList->indexOfId(id));
+        });
+        return rows;
+    };
+
+    switch(role){
+    case DueCountRole:
+        return QVariant(calendar.count(CalendarIndex::Due, date.toJulianDay()));
+    case CompletedCountRole:
+        return QVariant(calendar.count(CalendarIndex::Completed, date.toJulianDay()));
+    case DueRowsRole:
+        return rows(CalendarIndex::Due);
+    case CompletedRowsRole:
+        return rows(CalendarIndex::Completed);
+    }
+
+    return QVariant();
+}
+
+bool CalendarModel::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::TimeZoneChange && watched == QCoreApplication::instance())
+        scheduleUpdate();
+    return QAbstractListModel::eventFilter(watched, event);
+}
+
+QHash<int, QByteArray> CalendarModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DateRole] = "date";
+    names[DueCountRole] = "dueCount";
+    names[CompletedCountRole] = "completedCount";
+    names[DueRowsRole] = "dueRows";
+    names[CompletedRowsRole] = "completedRows";
+    return names;
+}
+
+ToDoList *CalendarModel::list() const
+{
+    return mList;
+}
+
+void CalendarModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    beginResetModel();
+    mList = list;
+    if (mList)
+        mList->refreshCalendar();
+    endResetModel();
+
+    // Removals shift list indexes, so they refresh the rows as well.
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, &CalendarModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemRemoved, this, &CalendarModel::scheduleUpdate);
+        connect(mList, &ToDoList::itemChanged, this, &CalendarModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsReset, this, &CalendarModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsInserted, this, &CalendarModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsRemoved, this, &CalendarModel::scheduleUpdate);
+        connect(mList, &ToDoList::itemsChanged, this, &CalendarModel::scheduleUpdate);
+    }
+
+    emit listChanged();
+}
+
+QDate CalendarModel::from() const
+{
+    return mFrom;
+}
+
+void CalendarModel::setFrom(const QDate &from)
+{
+    setRange(from, mTo);
+}
+
+QDate CalendarModel::to() const
+{
+    return mTo;
+}
+
+void CalendarModel::setTo(const QDate &to)
+{
+    setRange(mFrom, to);
+}
+
+void CalendarModel::scheduleUpdate()
+{
+    if (mUpdatePending)
+        return;
+
+    // The days stay the same; only what is on them changes.
+    mUpdatePending = true;
+    QTimer::singleShot(0, this, [=]() {
+        mUpdatePending = false;
+        if (mList)
+            mList->refreshCalendar();
+        if (rowCount() > 0)
+            emit dataChanged(index(0), index(rowCount() - 1),
+                             { DueCountRole, CompletedCountRole, DueRowsRole, CompletedRowsRole });
+    });
+}
+
+void CalendarModel::setRange(const QDate &from, const QDate &to)
+{
+    if (mFrom == from && mTo == to)
+        return;
+
+    beginResetModel();
+    mFrom = from;
+    mTo = to;
+    if (mList)
+        mList->refreshCalendar();
+    endResetModel();
+
+    emit rangeChanged();
+}
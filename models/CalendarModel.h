@@ -0,0 +1,64 @@
+#ifndef CALENDARMODEL_H
+#define CALENDARMODEL_H
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QQmlEngine>
+
+class ToDoList;
+
+// One row per day from from to to, inclusive, for a calendar view. Counts
+// and items are read from the list's per-day buckets, so the row count is
+// the number of visible days whatever the size of the list.
+class CalendarModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(QDate from READ from WRITE setFrom NOTIFY rangeChanged)
+    Q_PROPERTY(QDate to READ to WRITE setTo NOTIFY rangeChanged)
+
+public:
+    explicit CalendarModel(QObject *parent = nullptr);
+
+    enum {
+        DateRole = Qt::UserRole,
+        DueCountRole,
+        CompletedCountRole,
+        // List indexes of the items, for delegates that show them.
+        DueRowsRole,
+        CompletedRowsRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    QDate from() const;
+    void setFrom(const QDate &from);
+
+    QDate to() const;
+    void setTo(const QDate &to);
+
+signals:
+    void listChanged();
+    void rangeChanged();
+
+private:
+    void scheduleUpdate();
+    void setRange(const QDate &from, const QDate &to);
+
+    ToDoList* mList;
+    QDate mFrom;
+    QDate mTo;
+    bool mUpdatePending;
+};
+
+#endif // CALENDARMODEL_H
@@ -0,0 +1,113 @@
+#include "CompletionModel.h"
+#include "ToDoList.h"
+
+CompletionModel::CompletionModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mLimit(5)
+{
+}
+
+int CompletionModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mCompletions.size();
+}
+
+QVariant CompletionModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mCompletions.size())
+        return QVariant();
+
+    const CompletionTrie::Completion &completion = mCompletions.at(index.row());
+    switch(role){
+    case TextRole:
+        return QVariant(completion.text);
+    case CountRole:
+        return QVariant(completion.count);
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> CompletionModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[TextRole] = "text";
+    names[CountRole] = "count";
+    return names;
+}
+
+ToDoList *CompletionModel::list() const
+{
+    return mList;
+}
+
+void CompletionModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, &CompletionModel::update);
+        connect(mList, &ToDoList::itemChanged, this, &CompletionModel::update);
+        connect(mList, &ToDoList::postItemRemoved, this, &CompletionModel::update);
+        connect(mList, &ToDoList::postItemsReset, this, &CompletionModel::update);
+        connect(mList, &ToDoList::postItemsInserted, this, &CompletionModel::update);
+        connect(mList, &ToDoList::postItemsRemoved, this, &CompletionModel::update);
+        connect(mList, &ToDoList::itemsChanged, this, &CompletionModel::update);
+    }
+
+    emit listChanged();
+    update();
+}
+
+QString CompletionModel::prefix() const
+{
+    return mPrefix;
+}
+
+void CompletionModel::setPrefix(const QString &prefix)
+{
+    if (mPrefix == prefix)
+        return;
+
+    mPrefix = prefix;
+    emit prefixChanged();
+    update();
+}
+
+int CompletionModel::limit() const
+{
+    return mLimit;
+}
+
+void CompletionModel::setLimit(int limit)
+{
+    if (mLimit == limit)
+        return;
+
+    mLimit = limit;
+    emit limitChanged();
+    update();
+}
+
+void CompletionModel::update()
+{
+    beginResetModel();
+
+    const QString key = ToDoList::completionKey(mPrefix);
+    if (mList && !key.isEmpty())
+        mCompletions = mList->completions().complete(key, mLimit);
+    else
+        mCompletions.clear();
+
+    endResetModel();
+}
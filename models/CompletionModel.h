@@ -0,0 +1,58 @@
+#ifndef COMPLETIONMODEL_H
+#define COMPLETIONMODEL_H
+
+#include <QAbstractListModel>
+#include <QQmlEngine>
+
+#include "CompletionTrie.h"
+
+class ToDoList;
+
+// Suggestions for the description being typed: existing descriptions of a
+// ToDoList starting with prefix, most frequently and recently used first.
+class CompletionModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(QString prefix READ prefix WRITE setPrefix NOTIFY prefixChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+
+public:
+    explicit CompletionModel(QObject *parent = nullptr);
+
+    enum {
+        TextRole = Qt::UserRole,
+        CountRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    QString prefix() const;
+    void setPrefix(const QString &prefix);
+
+    int limit() const;
+    void setLimit(int limit);
+
+signals:
+    void listChanged();
+    void prefixChanged();
+    void limitChanged();
+
+private:
+    void update();
+
+    ToDoList* mList;
+    QString mPrefix;
+    int mLimit;
+    QVector<CompletionTrie::Completion> mCompletions;
+};
+
+#endif // COMPLETIONMODEL_H
@@ -0,0 +1,205 @@
+#include "FuzzyResultModel.h"
+
+#include <QTimer>
+
+FuzzyResultModel::FuzzyResultModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mLimit(50)
+    , mMatcherDirty(true)
+    , mRefreshPending(false)
+{
+}
+
+int FuzzyResultModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mMatches.size();
+}
+
+QVariant FuzzyResultModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mMatches.size())
+        return QVariant();
+
+    const FuzzyMatch &match = mMatches.at(index.row());
+    const int listIndex = mList ? mList->indexOfId(match.id) : -1;
+    if (listIndex < 0)
+        return QVariant();
+
+    const ToDoItem item = mList->items().at(listIndex);
+    switch(role){
+    case DoneRole:
+        return QVariant(item.done);
+    case DescriptionRole:
+        return QVariant(item.description);
+    case ScoreRole:
+        return QVariant(match.score);
+    case PositionsRole: {
+        QVariantList positions;
+        positions.reserve(match.positions.size());
+        for (const int position : match.positions)
+            positions.append(position);
+        return positions;
+    }
+    case ListIndexRole:
+        return QVariant(listIndex);
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> FuzzyResultModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DoneRole] = "done";
+    names[DescriptionRole] = "description";
+    names[ScoreRole] = "score";
+    names[PositionsRole] = "positions";
+    names[ListIndexRole] = "listIndex";
+    return names;
+}
+
+ToDoList *FuzzyResultModel::list() const
+{
+    return mList;
+}
+
+void FuzzyResultModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+    mMatcherDirty = true;
+
+    if (mList) {
+        // Until the matcher is first needed, or after a reset, it is built
+        // from scratch by the next refresh and item changes can wait.
+        connect(mList, &ToDoList::postItemAppended, this, [=]() {
+            if (!mMatcherDirty)
+                mMatcher.insertItems(mList->items().size() - 1, { mList->items().last() });
+            scheduleRefresh();
+        });
+        connect(mList, &ToDoList::preItemRemoved, this, [=](int index) {
+            if (!mMatcherDirty)
+                mMatcher.removeItems(index, index);
+            scheduleRefresh();
+        });
+        connect(mList, &ToDoList::itemChanged, this, [=](int index) {
+            // Matches only depend on descriptions.
+            const ToDoItem item = mList->items().at(index);
+            if (mMatcherDirty || mMatcher.updateItem(index, item))
+                scheduleRefresh();
+            else
+                emitMatchChanged(item.id);
+        });
+        connect(mList, &ToDoList::postItemsReset, this, [=]() {
+            mMatcherDirty = true;
+            scheduleRefresh();
+        });
+        connect(mList, &ToDoList::preItemsInserted, this, [=](int first, int last) {
+            mInsertFirst = first;
+            mInsertLast = last;
+        });
+        connect(mList, &ToDoList::postItemsInserted, this, [=]() {
+            if (!mMatcherDirty)
+                mMatcher.insertItems(mInsertFirst, mList->items().mid(mInsertFirst, mInsertLast - mInsertFirst + 1));
+            scheduleRefresh();
+        });
+        connect(mList, &ToDoList::preItemsRemoved, this, [=](int first, int last) {
+            if (!mMatcherDirty)
+                mMatcher.removeItems(first, last);
+            scheduleRefresh();
+        });
+        connect(mList, &ToDoList::itemsChanged, this, [=](int first, int last) {
+            const QVector<ToDoItem> items = mList->items();
+            bool matched = mMatcherDirty;
+            for (int index = first; index <= last; ++index) {
+                if (mMatcherDirty || mMatcher.updateItem(index, items.at(index)))
+                    matched = true;
+                else
+                    emitMatchChanged(items.at(index).id);
+            }
+            if (matched)
+                scheduleRefresh();
+        });
+    }
+
+    emit listChanged();
+    refresh();
+}
+
+QString FuzzyResultModel::query() const
+{
+    return mQuery;
+}
+
+void FuzzyResultModel::setQuery(const QString &query)
+{
+    if (mQuery == query)
+        return;
+
+    mQuery = query;
+    emit queryChanged();
+    refresh();
+}
+
+int FuzzyResultModel::limit() const
+{
+    return mLimit;
+}
+
+void FuzzyResultModel::setLimit(int limit)
+{
+    if (mLimit == limit)
+        return;
+
+    mLimit = limit;
+    emit limitChanged();
+    refresh();
+}
+
+void FuzzyResultModel::scheduleRefresh()
+{
+    // Coalesce bursts of list mutations into one rebuild.
+    if (mRefreshPending)
+        return;
+
+    mRefreshPending = true;
+    QTimer::singleShot(0, this, [=]() {
+        mRefreshPending = false;
+        refresh();
+    });
+}
+
+void FuzzyResultModel::refresh()
+{
+    beginResetModel();
+
+    mMatches.clear();
+    if (mList && !mQuery.trimmed().isEmpty()) {
+        if (mMatcherDirty) {
+            mMatcher.setItems(mList->items());
+            mMatcherDirty = false;
+        }
+        mMatches = mMatcher.match(mQuery, mLimit);
+    }
+
+    endResetModel();
+}
+
+void FuzzyResultModel::emitMatchChanged(quint32 id)
+{
+    for (int row = 0; row < mMatches.size(); ++row) {
+        if (mMatches.at(row).id == id) {
+            const QModelIndex changed = index(row);
+            emit dataChanged(changed, changed);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef FUZZYRESULTMODEL_H
+#define FUZZYRESULTMODEL_H
+
+#include <QAbstractListModel>
+#include <QQmlEngine>
+
+#include "FuzzyMatcher.h"
+#include "ToDoList.h"
+
+// Ranked fuzzy matches of query over the descriptions of a ToDoList, for a
+// quick-switcher. The matcher follows the list item by item and is only
+// built from scratch after a reset; matches refer to items by id.
+class FuzzyResultModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+
+public:
+    explicit FuzzyResultModel(QObject *parent = nullptr);
+
+    enum {
+        DoneRole = Qt::UserRole,
+        DescriptionRole,
+        ScoreRole,
+        PositionsRole,
+        ListIndexRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    QString query() const;
+    void setQuery(const QString &query);
+
+    int limit() const;
+    void setLimit(int limit);
+
+signals:
+    void listChanged();
+    void queryChanged();
+    void limitChanged();
+
+private:
+    void scheduleRefresh();
+    void refresh();
+    void emitMatchChanged(quint32 id);
+
+    ToDoList* mList;
+    QString mQuery;
+    int mLimit;
+
+    FuzzyMatcher mMatcher;
+    bool mMatcherDirty;
+    bool mRefreshPending;
+    int mInsertFirst = 0;
+    int mInsertLast = -1;
+
+    QVector<FuzzyMatch> mMatches;
+};
+
+#endif // FUZZYRESULTMODEL_H
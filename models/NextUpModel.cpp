@@ -0,0 +1,159 @@
+#include "NextUpModel.h"
+
+#include <QDateTime>
+#include <QSet>
+#include <QTimer>
+
+NextUpModel::NextUpModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mLimit(10)
+    , mUpdatePending(false)
+{
+}
+
+int NextUpModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mItems.size();
+}
+
+QVariant NextUpModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mItems.size())
+        return QVariant();
+
+    const ToDoItem &item = mItems.at(index.row());
+    switch(role){
+    case DoneRole:
+        return QVariant(item.done);
+    case DescriptionRole:
+        return QVariant(item.description);
+    case PriorityRole:
+        return QVariant(item.priority);
+    case DueRole:
+        return item.due ? QVariant(QDateTime::fromMSecsSinceEpoch(item.due)) : QVariant();
+    case ListIndexRole:
+        return QVariant(mList ? mList->indexOfId(item.id) : -1);
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> NextUpModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DoneRole] = "done";
+    names[DescriptionRole] = "description";
+    names[PriorityRole] = "priority";
+    names[DueRole] = "due";
+    names[ListIndexRole] = "listIndex";
+    return names;
+}
+
+ToDoList *NextUpModel::list() const
+{
+    return mList;
+}
+
+void NextUpModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, &NextUpModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemRemoved, this, &NextUpModel::scheduleUpdate);
+        connect(mList, &ToDoList::itemChanged, this, &NextUpModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsReset, this, &NextUpModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsInserted, this, &NextUpModel::scheduleUpdate);
+        connect(mList, &ToDoList::postItemsRemoved, this, &NextUpModel::scheduleUpdate);
+        connect(mList, &ToDoList::itemsChanged, this, &NextUpModel::scheduleUpdate);
+    }
+
+    emit listChanged();
+    update();
+}
+
+int NextUpModel::limit() const
+{
+    return mLimit;
+}
+
+void NextUpModel::setLimit(int limit)
+{
+    if (mLimit == limit)
+        return;
+
+    mLimit = limit;
+    emit limitChanged();
+    update();
+}
+
+void NextUpModel::scheduleUpdate()
+{
+    if (mUpdatePending)
+        return;
+
+    mUpdatePending = true;
+    QTimer::singleShot(0, this, [=]() {
+        mUpdatePending = false;
+        update();
+    });
+}
+
+void NextUpModel::update()
+{
+    QVector<ToDoItem> items;
+    if (mList) {
+        const QVector<ToDoItem> all = mList->items();
+        for (const quint32 id : mList->nextUp(mLimit))
+            items.append(all.at(mList->indexOfId(id)));
+    }
+
+    QSet<quint32> ids;
+    for (const ToDoItem &item : std::as_const(items))
+        ids.insert(item.id);
+
+    // Drop rows that left the top first, then bring the rest into order
+    // one position at a time, moving rows that are further down and
+    // inserting the ones that are new.
+    for (int row = mItems.size() - 1; row >= 0; --row) {
+        if (!ids.contains(mItems.at(row).id)) {
+            beginRemoveRows(QModelIndex(), row, row);
+            mItems.remove(row);
+            endRemoveRows();
+        }
+    }
+
+    for (int row = 0; row < items.size(); ++row) {
+        const ToDoItem &item = items.at(row);
+        int from = row;
+        while (from < mItems.size() && mItems.at(from).id != item.id)
+            ++from;
+
+        if (from == mItems.size()) {
+            beginInsertRows(QModelIndex(), row, row);
+            mItems.insert(row, item);
+            endInsertRows();
+            continue;
+        }
+
+        if (from != row) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), row);
+            mItems.move(from, row);
+            endMoveRows();
+        }
+        if (mItems.at(row).version != item.version) {
+            mItems[row] = item;
+            emit dataChanged(index(row), index(row));
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef NEXTUPMODEL_H
+#define NEXTUPMODEL_H
+
+#include <QAbstractListModel>
+#include <QQmlEngine>
+
+#include "ToDoList.h"
+
+// The limit most urgent open items of a ToDoList: highest priority first,
+// then earliest due. Rows are read off the list's priority index after every
+// change and applied as moves, insertions and removals so views animate
+// items climbing or dropping out of the list.
+class NextUpModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+
+public:
+    explicit NextUpModel(QObject *parent = nullptr);
+
+    enum {
+        DoneRole = Qt::UserRole,
+        DescriptionRole,
+        PriorityRole,
+        DueRole,
+        ListIndexRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    int limit() const;
+    void setLimit(int limit);
+
+signals:
+    void listChanged();
+    void limitChanged();
+
+private:
+    void scheduleUpdate();
+    void update();
+
+    ToDoList* mList;
+    int mLimit;
+    bool mUpdatePending;
+    QVector<ToDoItem> mItems;
+};
+
+#endif // NEXTUPMODEL_H
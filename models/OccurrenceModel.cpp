@@ -0,0 +1,328 @@
+#include "OccurrenceModel.h"
+
+#include <QTimer>
+
+#include <algorithm>
+
+OccurrenceModel::OccurrenceModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mUpdatePending(false)
+    , mResetPending(false)
+    , mIndexesMoved(false)
+    , mInsertFirst(0)
+    , mInsertLast(-1)
+{
+}
+
+int OccurrenceModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mOccurrences.size();
+}
+
+QVariant OccurrenceModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mOccurrences.size())
+        return QVariant();
+
+    const Occurrence &occurrence = mOccurrences.at(index.row());
+    const ToDoItem *item = itemFor(occurrence);
+    switch(role){
+    case DoneRole:
+        return QVariant(item && item->done && occurrence.itemId);
+    case DescriptionRole:
+        return item ? QVariant(item->description) : QVariant();
+    case TimeRole: {
+        const qint64 time = occurrence.itemId && item && item->due ? item->due : occurrence.time;
+        return QVariant(QDateTime::fromMSecsSinceEpoch(time));
+    }
+    case StoredRole:
+        return QVariant(occurrence.itemId != 0);
+    case SeriesIndexRole:
+        return QVariant(mList ? mList->indexOfId(occurrence.seriesId) : -1);
+    case ListIndexRole:
+        return QVariant(mList && occurrence.itemId ? mList->indexOfId(occurrence.itemId) : -1);
+    }
+
+    return QVariant();
+}
+
+bool OccurrenceModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!mList || !index.isValid() || index.row() >= mOccurrences.size())
+        return false;
+    if (role != DoneRole && role != DescriptionRole)
+        return false;
+
+    const Occurrence occurrence = mOccurrences.at(index.row());
+    const int row = mList->materializeOccurrence(occurrence.seriesId, occurrence.time);
+    if (row < 0)
+        return false;
+
+    ToDoItem item = mList->items().at(row);
+    if (role == DoneRole)
+        item.done = value.toBool();
+    else
+        item.description = value.toString();
+
+    // The rows are refreshed from the list's signals.
+    mList->setItemAt(row, item);
+    return true;
+}
+
+Qt::ItemFlags OccurrenceModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    return Qt::ItemIsEditable;
+}
+
+QHash<int, QByteArray> OccurrenceModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DoneRole] = "done";
+    names[DescriptionRole] = "description";
+    names[TimeRole] = "time";
+    names[StoredRole] = "stored";
+    names[SeriesIndexRole] = "seriesIndex";
+    names[ListIndexRole] = "listIndex";
+    return names;
+}
+
+ToDoList *OccurrenceModel::list() const
+{
+    return mList;
+}
+
+void OccurrenceModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+    mCache.clear();
+    mKnownIds.clear();
+    mChangedIds.clear();
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, [=]() {
+            itemsTouched(mList->items().size() - 1, mList->items().size() - 1);
+        });
+        // Removals are looked at while the items are still there.
+        connect(mList, &ToDoList::preItemRemoved, this, [=](int index) {
+            mIndexesMoved = true;
+            itemsTouched(index, index);
+        });
+        connect(mList, &ToDoList::itemChanged, this, [=](int index) {
+            itemsTouched(index, index);
+        });
+        connect(mList, &ToDoList::preItemsInserted, this, [=](int first, int last) {
+            mInsertFirst = first;
+            mInsertLast = last;
+        });
+        connect(mList, &ToDoList::postItemsInserted, this, [=]() {
+            mIndexesMoved = true;
+            itemsTouched(mInsertFirst, mInsertLast);
+        });
+        connect(mList, &ToDoList::preItemsRemoved, this, [=](int first, int last) {
+            mIndexesMoved = true;
+            itemsTouched(first, last);
+        });
+        connect(mList, &ToDoList::itemsChanged, this, &OccurrenceModel::itemsTouched);
+        connect(mList, &ToDoList::postItemsReset, this, [=]() {
+            mResetPending = true;
+            scheduleUpdate();
+        });
+    }
+
+    emit listChanged();
+    update();
+}
+
+QDateTime OccurrenceModel::from() const
+{
+    return mFrom;
+}
+
+void OccurrenceModel::setFrom(const QDateTime &from)
+{
+    if (mFrom == from)
+        return;
+
+    mFrom = from;
+    emit rangeChanged();
+    update();
+}
+
+QDateTime OccurrenceModel::to() const
+{
+    return mTo;
+}
+
+void OccurrenceModel::setTo(const QDateTime &to)
+{
+    if (mTo == to)
+        return;
+
+    mTo = to;
+    emit rangeChanged();
+    update();
+}
+
+void OccurrenceModel::itemsTouched(int first, int last)
+{
+    // Only series, stored occurrences and items that used to be one of
+    // them affect the occurrences; other items at most move the indexes.
+    const QVector<ToDoItem> items = mList->items();
+    for (int index = first; index <= last; ++index) {
+        const ToDoItem &item = items.at(index);
+        if ((item.due && item.recurrence.isValid()) || item.seriesId || mKnownIds.contains(item.id))
+            mChangedIds.insert(item.id);
+    }
+    scheduleUpdate();
+}
+
+void OccurrenceModel::scheduleUpdate()
+{
+    if (mUpdatePending)
+        return;
+
+    mUpdatePending = true;
+    QTimer::singleShot(0, this, [=]() {
+        mUpdatePending = false;
+        refresh();
+    });
+}
+
+void OccurrenceModel::refresh()
+{
+    if (mResetPending || !mList || !mFrom.isValid() || !mTo.isValid()) {
+        update();
+        return;
+    }
+
+    mSnapshot = mList->items();
+    if (!mChangedIds.isEmpty()) {
+        mCache.clear();
+        mKnownIds.clear();
+        applyOccurrences(lookup(mFrom.toMSecsSinceEpoch(), mTo.toMSecsSinceEpoch()));
+        mChangedIds.clear();
+    }
+    if (mIndexesMoved && !mOccurrences.isEmpty()) {
+        emit dataChanged(index(0), index(mOccurrences.size() - 1),
+                         QVector<int>() << SeriesIndexRole << ListIndexRole);
+    }
+    mIndexesMoved = false;
+}
+
+void OccurrenceModel::applyOccurrences(const QVector<Occurrence> &occurrences)
+{
+    // Both lists are ordered by time and series, so a merge finds the rows
+    // that went away, the new ones and the ones whose items changed.
+    const auto before = [](const Occurrence &a, const Occurrence &b) {
+        return a.time != b.time ? a.time < b.time : a.seriesId < b.seriesId;
+    };
+
+    int row = 0;
+    int i = 0;
+    while (row < mOccurrences.size() || i < occurrences.size()) {
+        if (i == occurrences.size() || (row < mOccurrences.size() && before(mOccurrences.at(row), occurrences.at(i)))) {
+            int last = row;
+            while (last + 1 < mOccurrences.size()
+                   && (i == occurrences.size() || before(mOccurrences.at(last + 1), occurrences.at(i))))
+                ++last;
+            beginRemoveRows(QModelIndex(), row, last);
+            mOccurrences.remove(row, last - row + 1);
+            endRemoveRows();
+        } else if (row == mOccurrences.size() || before(occurrences.at(i), mOccurrences.at(row))) {
+            int last = i;
+            while (last + 1 < occurrences.size()
+                   && (row == mOccurrences.size() || before(occurrences.at(last + 1), mOccurrences.at(row))))
+                ++last;
+            beginInsertRows(QModelIndex(), row, row + last - i);
+            mOccurrences.insert(row, last - i + 1, Occurrence());
+            std::copy(occurrences.cbegin() + i, occurrences.cbegin() + last + 1, mOccurrences.begin() + row);
+            endInsertRows();
+            row += last - i + 1;
+            i = last + 1;
+        } else {
+            const Occurrence &old = mOccurrences.at(row);
+            const Occurrence &occurrence = occurrences.at(i);
+            const bool changed = old.itemId != occurrence.itemId || mChangedIds.contains(occurrence.seriesId)
+                                 || mChangedIds.contains(old.itemId) || mChangedIds.contains(occurrence.itemId);
+            mOccurrences[row] = occurrence;
+            if (changed) {
+                const QModelIndex changedIndex = index(row);
+                emit dataChanged(changedIndex, changedIndex);
+            }
+            ++row;
+            ++i;
+        }
+    }
+}
+
+void OccurrenceModel::update()
+{
+    // Moving the window keeps the cache, unless it is out of date.
+    if (mResetPending || !mChangedIds.isEmpty()) {
+        mCache.clear();
+        mKnownIds.clear();
+    }
+    mResetPending = false;
+    mIndexesMoved = false;
+    mChangedIds.clear();
+    beginResetModel();
+
+    // Both ends are needed; an unbounded window would never end.
+    if (mList && mFrom.isValid() && mTo.isValid()) {
+        mSnapshot = mList->items();
+        mOccurrences = lookup(mFrom.toMSecsSinceEpoch(), mTo.toMSecsSinceEpoch());
+    } else {
+        mSnapshot.clear();
+        mOccurrences.clear();
+    }
+
+    endResetModel();
+}
+
+QVector<Occurrence> OccurrenceModel::lookup(qint64 from, qint64 to)
+{
+    for (int i = 0; i < mCache.size(); ++i) {
+        if (mCache.at(i).from == from && mCache.at(i).to == to) {
+            mCache.move(i, 0);
+            return mCache.first().occurrences;
+        }
+    }
+
+    CachedWindow window;
+    window.from = from;
+    window.to = to;
+    window.occurrences = mList->occurrences(from, to);
+    for (const Occurrence &occurrence : std::as_const(window.occurrences)) {
+        mKnownIds.insert(occurrence.seriesId);
+        if (occurrence.itemId)
+            mKnownIds.insert(occurrence.itemId);
+    }
+
+    mCache.prepend(window);
+    while (mCache.size() > CacheSize)
+        mCache.removeLast();
+    return window.occurrences;
+}
+
+const ToDoItem *OccurrenceModel::itemFor(const Occurrence &occurrence) const
+{
+    // A stored occurrence shows its own item, otherwise the series.
+    const quint32 id = occurrence.itemId ? occurrence.itemId : occurrence.seriesId;
+    const int row = mList ? mList->indexOfId(id) : -1;
+    if (row < 0 || row >= mSnapshot.size() || mSnapshot.at(row).id != id)
+        return nullptr;
+    return &mSnapshot.at(row);
+}
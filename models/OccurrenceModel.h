@@ -0,0 +1,100 @@
+#ifndef OCCURRENCEMODEL_H
+#define OCCURRENCEMODEL_H
+
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QQmlEngine>
+#include <QSet>
+
+#include "ToDoList.h"
+
+// Occurrences of the recurring items of a ToDoList between from and to, for
+// a ListView or calendar showing that window. Occurrences are generated for
+// the window only and cached per window, so paging back and forth does not
+// generate them again. Only changes to recurring items and stored
+// occurrences drop the cache; the rows are then updated one by one. Editing
+// or completing an occurrence stores it as a real item first.
+class OccurrenceModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(QDateTime from READ from WRITE setFrom NOTIFY rangeChanged)
+    Q_PROPERTY(QDateTime to READ to WRITE setTo NOTIFY rangeChanged)
+
+public:
+    explicit OccurrenceModel(QObject *parent = nullptr);
+
+    enum {
+        DoneRole = Qt::UserRole,
+        DescriptionRole,
+        TimeRole,
+        // Whether the occurrence is stored as an item.
+        StoredRole,
+        SeriesIndexRole,
+        // -1 while not stored.
+        ListIndexRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    QDateTime from() const;
+    void setFrom(const QDateTime &from);
+
+    QDateTime to() const;
+    void setTo(const QDateTime &to);
+
+signals:
+    void listChanged();
+    void rangeChanged();
+
+private:
+    struct CachedWindow
+    {
+        qint64 from = 0;
+        qint64 to = 0;
+        QVector<Occurrence> occurrences;
+    };
+
+    static constexpr int CacheSize = 4;
+
+    void itemsTouched(int first, int last);
+    void scheduleUpdate();
+    void update();
+    void refresh();
+    void applyOccurrences(const QVector<Occurrence> &occurrences);
+    QVector<Occurrence> lookup(qint64 from, qint64 to);
+    const ToDoItem *itemFor(const Occurrence &occurrence) const;
+
+    ToDoList* mList;
+    QDateTime mFrom;
+    QDateTime mTo;
+    bool mUpdatePending;
+    bool mResetPending;
+    bool mIndexesMoved;
+    int mInsertFirst;
+    int mInsertLast;
+
+    // Series and stored occurrences changed since the last refresh, and
+    // the ids the cached windows depend on.
+    QSet<quint32> mChangedIds;
+    QSet<quint32> mKnownIds;
+
+    QVector<ToDoItem> mSnapshot;
+    QVector<Occurrence> mOccurrences;
+    // Most recently used first.
+    QList<CachedWindow> mCache;
+};
+
+#endif // OCCURRENCEMODEL_H
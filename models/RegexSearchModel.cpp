@@ -0,0 +1,218 @@
+#include "RegexSearchModel.h"
+
+#include <QTimer>
+#include <QtConcurrent>
+
+namespace {
+
+constexpr int ChunkRows = 8192;
+
+}
+
+RegexSearchModel::RegexSearchModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mCaseSensitive(false)
+    , mSearchPending(false)
+    , mNextChunk(0)
+{
+    connect(&mWatcher, &QFutureWatcher<QVector<int>>::resultReadyAt, this, &RegexSearchModel::takeChunk);
+    connect(&mWatcher, &QFutureWatcher<QVector<int>>::finished, this, &RegexSearchModel::busyChanged);
+}
+
+RegexSearchModel::~RegexSearchModel()
+{
+    cancel();
+}
+
+int RegexSearchModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mRows.size();
+}
+
+QVariant RegexSearchModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mRows.size())
+        return QVariant();
+
+    const int row = mRows.at(index.row());
+    const ToDoItem &item = mSnapshot.at(row);
+    switch(role){
+    case DoneRole:
+        return QVariant(item.done);
+    case DescriptionRole:
+        return QVariant(item.description);
+    case ListIndexRole:
+        return QVariant(row);
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> RegexSearchModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DoneRole] = "done";
+    names[DescriptionRole] = "description";
+    names[ListIndexRole] = "listIndex";
+    return names;
+}
+
+ToDoList *RegexSearchModel::list() const
+{
+    return mList;
+}
+
+void RegexSearchModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, &RegexSearchModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemRemoved, this, &RegexSearchModel::scheduleSearch);
+        connect(mList, &ToDoList::itemChanged, this, &RegexSearchModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemsReset, this, &RegexSearchModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemsInserted, this, &RegexSearchModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemsRemoved, this, &RegexSearchModel::scheduleSearch);
+        connect(mList, &ToDoList::itemsChanged, this, &RegexSearchModel::scheduleSearch);
+    }
+
+    emit listChanged();
+    search();
+}
+
+QString RegexSearchModel::pattern() const
+{
+    return mPattern;
+}
+
+void RegexSearchModel::setPattern(const QString &pattern)
+{
+    if (mPattern == pattern)
+        return;
+
+    mPattern = pattern;
+    search();
+    emit patternChanged();
+}
+
+bool RegexSearchModel::caseSensitive() const
+{
+    return mCaseSensitive;
+}
+
+void RegexSearchModel::setCaseSensitive(bool caseSensitive)
+{
+    if (mCaseSensitive == caseSensitive)
+        return;
+
+    mCaseSensitive = caseSensitive;
+    emit caseSensitiveChanged();
+    search();
+}
+
+QString RegexSearchModel::error() const
+{
+    return mError;
+}
+
+bool RegexSearchModel::busy() const
+{
+    return mWatcher.isRunning();
+}
+
+void RegexSearchModel::scheduleSearch()
+{
+    // Coalesce bursts of list mutations into one search.
+    if (mSearchPending)
+        return;
+
+    mSearchPending = true;
+    QTimer::singleShot(0, this, [=]() {
+        mSearchPending = false;
+        search();
+    });
+}
+
+void RegexSearchModel::search()
+{
+    cancel();
+
+    beginResetModel();
+    mRows.clear();
+    mPendingChunks.clear();
+    mNextChunk = 0;
+    mSnapshot = mList ? mList->items() : QVector<ToDoItem>();
+    endResetModel();
+
+    // Detaching from the cancelled future drops its queued results.
+    mWatcher.setFuture(QFuture<QVector<int>>());
+
+    mError.clear();
+    if (!mList || mPattern.isEmpty())
+        return;
+
+    QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
+    if (!mCaseSensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+    QRegularExpression expression(mPattern, options);
+    if (!expression.isValid()) {
+        mError = expression.errorString();
+        return;
+    }
+    // Compile and JIT-compile now rather than racing on it in every worker.
+    expression.optimize();
+
+    QVector<int> chunks;
+    for (int row = 0; row < mSnapshot.size(); row += ChunkRows)
+        chunks.append(row);
+
+    const QVector<ToDoItem> snapshot = mSnapshot;
+    mWatcher.setFuture(QtConcurrent::mapped(chunks, [snapshot, expression](int firstRow) {
+        QVector<int> rows;
+        const int end = std::min(firstRow + ChunkRows, int(snapshot.size()));
+        for (int row = firstRow; row < end; ++row) {
+            if (expression.match(snapshot.at(row).description).hasMatch())
+                rows.append(row);
+        }
+        return rows;
+    }));
+    emit busyChanged();
+}
+
+void RegexSearchModel::cancel()
+{
+    if (!mWatcher.isRunning())
+        return;
+
+    mWatcher.cancel();
+    mWatcher.waitForFinished();
+}
+
+void RegexSearchModel::takeChunk(int chunk)
+{
+    if (mWatcher.isCanceled())
+        return;
+
+    mPendingChunks.insert(chunk, mWatcher.resultAt(chunk));
+
+    // Chunks finish in any order; append them in list order.
+    while (!mPendingChunks.isEmpty() && mPendingChunks.firstKey() == mNextChunk) {
+        const QVector<int> rows = mPendingChunks.take(mNextChunk++);
+        if (rows.isEmpty())
+            continue;
+
+        beginInsertRows(QModelIndex(), mRows.size(), mRows.size() + rows.size() - 1);
+        mRows += rows;
+        endInsertRows();
+    }
+}
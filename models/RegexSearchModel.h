@@ -0,0 +1,82 @@
+#ifndef REGEXSEARCHMODEL_H
+#define REGEXSEARCHMODEL_H
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QMap>
+#include <QQmlEngine>
+#include <QRegularExpression>
+
+#include "ToDoList.h"
+
+// Items of a ToDoList whose description matches a regular expression. The
+// pattern is compiled (and JIT-compiled) once, then chunks of a snapshot of
+// the list are matched on the thread pool. Matching rows are appended in list
+// order as soon as the chunks before them have finished, so the first
+// results show up while the rest of a large list is still being searched.
+class RegexSearchModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(QString pattern READ pattern WRITE setPattern NOTIFY patternChanged)
+    Q_PROPERTY(bool caseSensitive READ caseSensitive WRITE setCaseSensitive NOTIFY caseSensitiveChanged)
+    Q_PROPERTY(QString error READ error NOTIFY patternChanged)
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+
+public:
+    explicit RegexSearchModel(QObject *parent = nullptr);
+    ~RegexSearchModel() override;
+
+    enum {
+        DoneRole = Qt::UserRole,
+        DescriptionRole,
+        ListIndexRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    QString pattern() const;
+    void setPattern(const QString &pattern);
+
+    bool caseSensitive() const;
+    void setCaseSensitive(bool caseSensitive);
+
+    QString error() const;
+    bool busy() const;
+
+signals:
+    void listChanged();
+    void patternChanged();
+    void caseSensitiveChanged();
+    void busyChanged();
+
+private:
+    void scheduleSearch();
+    void search();
+    void cancel();
+    void takeChunk(int chunk);
+
+    ToDoList* mList;
+    QString mPattern;
+    bool mCaseSensitive;
+    QString mError;
+    bool mSearchPending;
+
+    QVector<ToDoItem> mSnapshot;
+    QFutureWatcher<QVector<int>> mWatcher;
+    // Finished chunks that wait for an earlier chunk before being shown.
+    QMap<int, QVector<int>> mPendingChunks;
+    int mNextChunk;
+
+    QVector<int> mRows;
+};
+
+#endif // REGEXSEARCHMODEL_H
@@ -0,0 +1,246 @@
+#include "SearchResultModel.h"
+#include "Trigrams.h"
+
+#include <QTimer>
+
+#include <algorithm>
+
+SearchResultModel::SearchResultModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+    , mSearchPending(false)
+{
+}
+
+int SearchResultModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return mRows.size();
+}
+
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= mRows.size())
+        return QVariant();
+
+    const int row = mRows.at(index.row());
+    const ToDoItem &item = mSnapshot.at(row);
+    switch(role){
+    case DoneRole:
+        return QVariant(item.done);
+    case DescriptionRole:
+        return QVariant(item.description);
+    case ListIndexRole:
+        return QVariant(row);
+    case HighlightsRole: {
+        // Only computed for rows a delegate actually asks about.
+        auto it = mHighlights.find(row);
+        if (it == mHighlights.end()) {
+            QVariantList ranges;
+            const QString needle = mQuery.trimmed();
+            for (int from = item.description.indexOf(needle, 0, Qt::CaseInsensitive); from >= 0;
+                 from = item.description.indexOf(needle, from + needle.size(), Qt::CaseInsensitive)) {
+                QVariantMap range;
+                range.insert(QStringLiteral("start"), from);
+                range.insert(QStringLiteral("length"), int(needle.size()));
+                ranges.append(range);
+            }
+            it = mHighlights.insert(row, ranges);
+        }
+        return *it;
+    }
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> SearchResultModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DoneRole] = "done";
+    names[DescriptionRole] = "description";
+    names[ListIndexRole] = "listIndex";
+    names[HighlightsRole] = "highlights";
+    return names;
+}
+
+ToDoList *SearchResultModel::list() const
+{
+    return mList;
+}
+
+void SearchResultModel::setList(ToDoList *list)
+{
+    if (mList == list)
+        return;
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+    mCache.clear();
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, &SearchResultModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemRemoved, this, &SearchResultModel::scheduleSearch);
+        connect(mList, &ToDoList::itemChanged, this, &SearchResultModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemsReset, this, &SearchResultModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemsInserted, this, &SearchResultModel::scheduleSearch);
+        connect(mList, &ToDoList::postItemsRemoved, this, &SearchResultModel::scheduleSearch);
+        connect(mList, &ToDoList::itemsChanged, this, &SearchResultModel::scheduleSearch);
+    }
+
+    emit listChanged();
+    search();
+}
+
+QString SearchResultModel::query() const
+{
+    return mQuery;
+}
+
+void SearchResultModel::setQuery(const QString &query)
+{
+    if (mQuery == query)
+        return;
+
+    mQuery = query;
+    emit queryChanged();
+    search();
+}
+
+void SearchResultModel::scheduleSearch()
+{
+    if (mSearchPending)
+        return;
+
+    mSearchPending = true;
+    QTimer::singleShot(0, this, [=]() {
+        mSearchPending = false;
+        search();
+    });
+}
+
+void SearchResultModel::search()
+{
+    const QString folded = mQuery.trimmed().toCaseFolded();
+    if (!mList || folded.isEmpty()) {
+        beginResetModel();
+        mRows.clear();
+        mHighlights.clear();
+        endResetModel();
+        return;
+    }
+
+    const bool sameSnapshot = !mCache.isEmpty() && mCache.first().version == mList->version();
+    const QVector<int> rows = lookup(folded);
+    mHighlights.clear();
+
+    if (sameSnapshot && std::includes(mRows.cbegin(), mRows.cend(), rows.cbegin(), rows.cend())) {
+        // A refinement only drops rows; remove them in runs so views keep
+        // the delegates of the rows that stay.
+        applyRows(rows);
+    } else {
+        beginResetModel();
+        mSnapshot = mList->items();
+        mRows = rows;
+        endResetModel();
+    }
+}
+
+QVector<int> SearchResultModel::lookup(const QString &folded)
+{
+    const quint64 version = mList->version();
+    mCache.erase(std::remove_if(mCache.begin(), mCache.end(), [version](const CachedResult &cached) {
+        return cached.version != version;
+    }), mCache.end());
+
+    // The longest cached query contained in this one has the smallest
+    // superset of its matches.
+    int best = -1;
+    for (int i = 0; i < mCache.size(); ++i) {
+        const QString &cached = mCache.at(i).query;
+        if (folded.contains(cached) && (best < 0 || cached.size() > mCache.at(best).query.size()))
+            best = i;
+    }
+
+    CachedResult result;
+    result.query = folded;
+    result.version = version;
+    if (best >= 0 && mCache.at(best).query == folded) {
+        result = mCache.takeAt(best);
+    } else if (best >= 0) {
+        const QVector<ToDoItem> items = mList->items();
+        for (const int row : mCache.at(best).rows) {
+            if (items.at(row).description.contains(folded, Qt::CaseInsensitive))
+                result.rows.append(row);
+        }
+    } else {
+        result.rows = scan(folded);
+    }
+
+    mCache.prepend(result);
+    while (mCache.size() > CacheSize)
+        mCache.removeLast();
+    return result.rows;
+}
+
+QVector<int> SearchResultModel::scan(const QString &folded) const
+{
+    const QVector<ToDoItem> items = mList->items();
+    QVector<int> rows;
+
+    // Long enough queries start from the trigram postings of the list.
+    const QVector<quint32> trigrams = Trigrams::of(folded);
+    if (!trigrams.isEmpty()) {
+        RoaringBitmap candidates = mList->liveIds();
+        for (const quint32 trigram : trigrams) {
+            candidates = candidates & mList->textIndex().bitmap(trigram);
+            if (candidates.isEmpty())
+                return rows;
+        }
+        candidates.forEach([&](quint32 id) {
+            const int row = mList->indexOfId(id);
+            if (row >= 0 && items.at(row).description.contains(folded, Qt::CaseInsensitive))
+                rows.append(row);
+        });
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    for (int row = 0; row < items.size(); ++row) {
+        if (items.at(row).description.contains(folded, Qt::CaseInsensitive))
+            rows.append(row);
+    }
+    return rows;
+}
+
+void SearchResultModel::applyRows(const QVector<int> &rows)
+{
+    // rows is a sorted subset of mRows; walk backwards so earlier positions
+    // stay valid while later runs are removed.
+    int keep = rows.size() - 1;
+    int last = mRows.size() - 1;
+    while (last >= 0) {
+        if (keep >= 0 && rows.at(keep) == mRows.at(last)) {
+            --keep;
+            --last;
+            continue;
+        }
+
+        int first = last;
+        while (first > 0 && (keep < 0 || rows.at(keep) != mRows.at(first - 1)))
+            --first;
+
+        beginRemoveRows(QModelIndex(), first, last);
+        mRows.remove(first, last - first + 1);
+        endRemoveRows();
+        last = first - 1;
+    }
+
+    // The highlighted ranges change with the query even for kept rows.
+    if (!mRows.isEmpty())
+        emit dataChanged(index(0), index(mRows.size() - 1), QVector<int>() << HighlightsRole);
+}
@@ -0,0 +1,76 @@
+#ifndef SEARCHRESULTMODEL_H
+#define SEARCHRESULTMODEL_H
+
+#include <QAbstractListModel>
+#include <QQmlEngine>
+
+#include "ToDoList.h"
+
+// As-you-type substring search over the descriptions of a ToDoList.
+//
+// Result sets are cached per query together with the list version they were
+// computed at. When a query contains a cached one ("sin" -> "sink"), only
+// the cached rows are re-checked instead of the whole list; any mutation
+// bumps the list version and retires the cache.
+class SearchResultModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+
+public:
+    explicit SearchResultModel(QObject *parent = nullptr);
+
+    enum {
+        DoneRole = Qt::UserRole,
+        DescriptionRole,
+        ListIndexRole,
+        // List of { start, length } ranges of the query in the description.
+        HighlightsRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    QString query() const;
+    void setQuery(const QString &query);
+
+signals:
+    void listChanged();
+    void queryChanged();
+
+private:
+    struct CachedResult
+    {
+        QString query;
+        quint64 version = 0;
+        QVector<int> rows;
+    };
+
+    static constexpr int CacheSize = 16;
+
+    void scheduleSearch();
+    void search();
+    QVector<int> lookup(const QString &folded);
+    QVector<int> scan(const QString &folded) const;
+    void applyRows(const QVector<int> &rows);
+
+    ToDoList* mList;
+    QString mQuery;
+    bool mSearchPending;
+
+    QVector<ToDoItem> mSnapshot;
+    QVector<int> mRows;
+    // Most recently used first.
+    QList<CachedResult> mCache;
+    mutable QHash<int, QVariantList> mHighlights;
+};
+
+#endif // SEARCHRESULTMODEL_H
@@ -0,0 +1,139 @@
+#include "ToDoFilterModel.h"
+#include "ToDoModel.h"
+#include "ToDoList.h"
+
+ToDoFilterModel::ToDoFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+{
+}
+
+void ToDoFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    for (const QMetaObject::Connection &connection : std::as_const(mSourceConnections))
+        disconnect(connection);
+    mSourceConnections.clear();
+
+    // Connected before the base class connects its own handlers, so the
+    // match set is up to date by the time it re-filters the affected rows.
+    if (sourceModel) {
+        mSourceConnections << connect(sourceModel, &QAbstractItemModel::dataChanged, this,
+                                      [=](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+            updateRows(topLeft.row(), bottomRight.row());
+        });
+        mSourceConnections << connect(sourceModel, &QAbstractItemModel::rowsInserted, this,
+                                      [=](const QModelIndex &, int first, int last) {
+            updateRows(first, last);
+        });
+        // The base class re-filters everything after a reset by itself.
+        mSourceConnections << connect(sourceModel, &QAbstractItemModel::modelReset, this, [=]() {
+            connectList();
+            updateMatches();
+        });
+    }
+
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+    connectList();
+    refilter();
+}
+
+QString ToDoFilterModel::query() const
+{
+    return mQuery.text();
+}
+
+void ToDoFilterModel::setQuery(const QString &query)
+{
+    if (query == mQuery.text())
+        return;
+
+    mQuery = Query::parse(query);
+    emit queryChanged();
+
+    refilter();
+}
+
+QString ToDoFilterModel::error() const
+{
+    return mQuery.errorString();
+}
+
+QString ToDoFilterModel::plan() const
+{
+    return mPlan.explain();
+}
+
+bool ToDoFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (sourceParent.isValid())
+        return false;
+
+    ToDoList *todoList = list();
+    if (!todoList || !mQuery.root())
+        return mQuery.isValid();
+
+    return mMatches.contains(todoList->items().at(sourceRow).id);
+}
+
+bool ToDoFilterModel::lessThan(const QModelIndex &sourceLeft, const QModelIndex &sourceRight) const
+{
+    ToDoList *todoList = list();
+    if (!todoList || sortRole() != ToDoModel::DescriptionRole)
+        return QSortFilterProxyModel::lessThan(sourceLeft, sourceRight);
+
+    const QVector<ToDoItem> items = todoList->items();
+    return todoList->compareDescriptions(items.at(sourceLeft.row()), items.at(sourceRight.row())) < 0;
+}
+
+ToDoList *ToDoFilterModel::list() const
+{
+    ToDoModel *model = qobject_cast<ToDoModel *>(sourceModel());
+    return model ? model->list() : nullptr;
+}
+
+void ToDoFilterModel::connectList()
+{
+    disconnect(mListConnection);
+
+    // New collation keys change the order without changing any data.
+    if (ToDoList *todoList = list())
+        mListConnection = connect(todoList, &ToDoList::collationChanged, this, [=]() {
+            invalidate();
+        });
+}
+
+void ToDoFilterModel::refilter()
+{
+    updateMatches();
+    invalidateFilter();
+}
+
+void ToDoFilterModel::updateMatches()
+{
+    ToDoList *todoList = list();
+    if (todoList) {
+        mPlan = QueryPlan::compile(mQuery, *todoList);
+        mMatches = mPlan.execute(*todoList);
+    } else {
+        mPlan = QueryPlan();
+        mMatches.clear();
+    }
+
+    emit planChanged();
+}
+
+void ToDoFilterModel::updateRows(int first, int last)
+{
+    ToDoList *todoList = list();
+    if (!todoList || !mQuery.root())
+        return;
+
+    // Ids of removed items are never reused, so stale entries are harmless.
+    const QVector<ToDoItem> items = todoList->items();
+    for (int row = first; row <= last && row < items.size(); ++row) {
+        const ToDoItem &item = items.at(row);
+        if (mQuery.matches(item, *todoList))
+            mMatches.add(item.id);
+        else
+            mMatches.remove(item.id);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef TODOFILTERMODEL_H
+#define TODOFILTERMODEL_H
+
+#include <QSortFilterProxyModel>
+#include <QQmlEngine>
+
+#include "Query.h"
+#include "QueryPlan.h"
+#include "RoaringBitmap.h"
+
+class ToDoList;
+
+// Filters a ToDoModel with a Query. The query is compiled into a QueryPlan
+// once and executed against the list indexes; the resulting id set answers
+// filterAcceptsRow(). Edits and insertions re-evaluate only the rows they
+// touch. Sorting by description compares the list's cached collation keys.
+class ToDoFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(QString error READ error NOTIFY queryChanged)
+    Q_PROPERTY(QString plan READ plan NOTIFY planChanged)
+
+public:
+    explicit ToDoFilterModel(QObject *parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+
+    QString query() const;
+    void setQuery(const QString &query);
+
+    QString error() const;
+    QString plan() const;
+
+signals:
+    void queryChanged();
+    void planChanged();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+    bool lessThan(const QModelIndex &sourceLeft, const QModelIndex &sourceRight) const override;
+
+private:
+    ToDoList *list() const;
+    void connectList();
+    void refilter();
+    void updateMatches();
+    void updateRows(int first, int last);
+
+    Query mQuery;
+    QueryPlan mPlan;
+    RoaringBitmap mMatches;
+    QList<QMetaObject::Connection> mSourceConnections;
+    QMetaObject::Connection mListConnection;
+};
+
+#endif // TODOFILTERMODEL_H
@@ -1,10 +1,87 @@
 #include "ToDoModel.h"
 #include "ToDoList.h"
 
+#include <QDateTime>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr qint64 Day = 24 * 60 * 60 * 1000;
+constexpr qint64 Forever = std::numeric_limits<qint64>::max();
+
+// The source roles of each computed role. A change to any of them drops the
+// cached value and is reported for the computed role as well.
+const QHash<int, QList<int>> &dependencies()
+{
+    static const QHash<int, QList<int>> table {
+        { ToDoModel::UrgencyRole, { ToDoModel::DoneRole, ToDoModel::PriorityRole, ToDoModel::DueRole } },
+        { ToDoModel::WordCountRole, { ToDoModel::DescriptionRole } },
+        { ToDoModel::OverdueRole, { ToDoModel::DoneRole, ToDoModel::DueRole } }
+    };
+    return table;
+}
+
+// Source roles whose fields are not kept with the computed roles, so a
+// change always reports them.
+const QList<int> &untrackedRoles()
+{
+    static const QList<int> roles {
+        ToDoModel::TagsRole, ToDoModel::RecurrenceRole, ToDoModel::AttachmentsRole,
+        ToDoModel::DuplicateOfRole, ToDoModel::CreatedRole, ToDoModel::ModifiedRole,
+        ToDoModel::CompletedRole
+    };
+    return roles;
+}
+
+qint64 floorDiv(qint64 value, qint64 divisor)
+{
+    const qint64 quotient = value / divisor;
+    return quotient * divisor > value ? quotient - 1 : quotient;
+}
+
+// A computed role of an item at time now, and until when it holds.
+QVariant compute(const ToDoItem &item, int role, qint64 now, qint64 *validUntil)
+{
+    *validUntil = Forever;
+    switch(role){
+    case ToDoModel::UrgencyRole: {
+        // The priority, plus a point per day for the last week before the
+        // due time and for the first week after it.
+        if (item.done)
+            return QVariant(0);
+        if (!item.due)
+            return QVariant(item.priority);
+        const qint64 days = floorDiv(item.due - now, Day);
+        if (days > -7)
+            *validUntil = item.due - std::min<qint64>(days, 7) * Day + 1;
+        return QVariant(item.priority + int(std::clamp<qint64>(7 - days, 0, 14)));
+    }
+    case ToDoModel::WordCountRole: {
+        const QString words = item.description.simplified();
+        return QVariant(words.isEmpty() ? 0 : int(words.count(u' ')) + 1);
+    }
+    case ToDoModel::OverdueRole:
+        if (item.done || !item.due)
+            return QVariant(false);
+        if (item.due >= now)
+            *validUntil = item.due + 1;
+        return QVariant(item.due < now);
+    }
+
+    return QVariant();
+}
+
+}
+
 ToDoModel::ToDoModel(QObject *parent)
     : QAbstractListModel(parent)
     , mList(nullptr)
+    , mNextExpiry(Forever)
 {
+    mExpiryTimer.setSingleShot(true);
+    connect(&mExpiryTimer, &QTimer::timeout, this, &ToDoModel::expireComputed);
 }
 
 int ToDoModel::rowCount(const QModelIndex &parent) const
@@ -33,11 +110,34 @@ QVariant ToDoModel::data(const QModelIndex &index, int role) const
     // }
 
     const ToDoItem item = mList->items().at(index.row());
+    if (role >= CustomFieldRole)
+        return mList->customFields().value(item.id, role - CustomFieldRole);
+    if (role >= UrgencyRole && role <= OverdueRole)
+        return computedData(item, role);
+
     switch(role){
     case DoneRole:
         return QVariant(item.done);
     case DescriptionRole:
         return QVariant(item.description);
+    case TagsRole:
+        return QVariant(mList->tagNames(item.tags));
+    case DueRole:
+        return item.due ? QVariant(QDateTime::fromMSecsSinceEpoch(item.due)) : QVariant();
+    case PriorityRole:
+        return QVariant(item.priority);
+    case RecurrenceRole:
+        return QVariant(item.recurrence.toString());
+    case AttachmentsRole:
+        return QVariant(item.attachments);
+    case DuplicateOfRole:
+        return QVariant(item.duplicateOf ? mList->indexOfId(item.duplicateOf) : -1);
+    case CreatedRole:
+        return QVariant(QDateTime::fromMSecsSinceEpoch(item.created));
+    case ModifiedRole:
+        return QVariant(QDateTime::fromMSecsSinceEpoch(item.modified));
+    case CompletedRole:
+        return item.completed ? QVariant(QDateTime::fromMSecsSinceEpoch(item.completed)) : QVariant();
     }
 
     return QVariant();
@@ -48,6 +148,11 @@ bool ToDoModel::setData(const QModelIndex &index, const QVariant &value, int rol
     if(!mList)
         return false;
 
+    if (role >= UrgencyRole && role <= OverdueRole)
+        return false;
+    if (role >= CustomFieldRole)
+        return mList->setCustomField(index.row(), mList->customFieldNames().value(role - CustomFieldRole), value);
+
     ToDoItem item = mList->items().at(index.row());
     switch(role){
     case DoneRole:
@@ -56,14 +161,25 @@ bool ToDoModel::setData(const QModelIndex &index, const QVariant &value, int rol
     case DescriptionRole:
         item.description = value.toString();
         break;
+    case TagsRole:
+        item.tags = mList->internTags(value.toStringList());
+        break;
+    case DueRole: {
+        const QDateTime due = value.toDateTime();
+        item.due = due.isValid() ? due.toMSecsSinceEpoch() : 0;
+        break;
     }
-
-    if(mList->setItemAt(index.row(), item)) {
-        emit dataChanged(index, index, QVector<int>() << role);
-        return true;
+    case PriorityRole:
+        item.priority = value.toInt();
+        break;
+    case RecurrenceRole:
+        item.recurrence = Recurrence::parse(value.toString());
+        break;
     }
 
-    return false;
+    // dataChanged() is emitted from the list's itemChanged() signal, so edits
+    // made through other models over the same list show up here as well.
+    return mList->setItemAt(index.row(), item);
 }
 
 Qt::ItemFlags ToDoModel::flags(const QModelIndex &index) const
@@ -79,6 +195,28 @@ QHash<int, QByteArray> ToDoModel::roleNames() const
     QHash<int, QByteArray> names;
     names[DoneRole] = "done";
     names[DescriptionRole] = "description";
+    names[TagsRole] = "tags";
+    names[DueRole] = "due";
+    names[PriorityRole] = "priority";
+    names[RecurrenceRole] = "recurrence";
+    names[AttachmentsRole] = "attachments";
+    names[DuplicateOfRole] = "duplicateOf";
+    names[CreatedRole] = "created";
+    names[ModifiedRole] = "modified";
+    names[CompletedRole] = "completed";
+    names[UrgencyRole] = "urgency";
+    names[WordCountRole] = "wordCount";
+    names[OverdueRole] = "overdue";
+
+    // Fields named like a built-in role are left to the built-in one.
+    if (mList) {
+        const QStringList fields = mList->customFieldNames();
+        for (int i = 0; i < fields.size(); ++i) {
+            const QByteArray name = fields.at(i).toUtf8();
+            if (!names.values().contains(name))
+                names[CustomFieldRole + i] = name;
+        }
+    }
     return names;
 }
 
@@ -95,6 +233,10 @@ void ToDoModel::setList(ToDoList *list)
         mList->disconnect(this);
 
     mList = list;
+    mComputed.clear();
+    mExpiries.clear();
+    mExpiryTimer.stop();
+    mNextExpiry = Forever;
 
     emit listChanged();
 
@@ -109,11 +251,174 @@ void ToDoModel::setList(ToDoList *list)
 
         connect(mList, &ToDoList::preItemRemoved, this, [=](int index) {
             beginRemoveRows(QModelIndex(), index, index);
+            forget(mList->items().at(index).id);
         });
         connect(mList, &ToDoList::postItemRemoved, this, [=]() {
             endRemoveRows();
         });
+
+        connect(mList, &ToDoList::itemChanged, this, [=](int row) {
+            const QModelIndex changed = index(row);
+            emit dataChanged(changed, changed, changedRoles(mList->items().at(row)));
+        });
+
+        connect(mList, &ToDoList::preItemsInserted, this, [=](int first, int last) {
+            beginInsertRows(QModelIndex(), first, last);
+        });
+        connect(mList, &ToDoList::postItemsInserted, this, [=]() {
+            endInsertRows();
+        });
+        connect(mList, &ToDoList::preItemsRemoved, this, [=](int first, int last) {
+            beginRemoveRows(QModelIndex(), first, last);
+            const QVector<ToDoItem> items = mList->items();
+            for (int row = first; row <= last; ++row)
+                forget(items.at(row).id);
+        });
+        connect(mList, &ToDoList::postItemsRemoved, this, [=]() {
+            endRemoveRows();
+        });
+        connect(mList, &ToDoList::itemsChanged, this, [=](int first, int last) {
+            const QVector<ToDoItem> items = mList->items();
+            QList<int> roles;
+            bool all = false;
+            for (int row = first; row <= last; ++row) {
+                const QList<int> changed = changedRoles(items.at(row));
+                all = all || changed.isEmpty();
+                for (int role : changed) {
+                    if (!roles.contains(role))
+                        roles.append(role);
+                }
+            }
+            emit dataChanged(index(first), index(last), all ? QList<int>() : roles);
+        });
+
+        // Views only pick up new role names on a reset.
+        connect(mList, &ToDoList::customFieldsChanged, this, [=]() {
+            beginResetModel();
+            endResetModel();
+        });
+
+        connect(mList, &ToDoList::preItemsReset, this, [=]() {
+            beginResetModel();
+            mComputed.clear();
+            mExpiries.clear();
+        });
+        connect(mList, &ToDoList::postItemsReset, this, [=]() {
+            endResetModel();
+        });
     }
 
     endResetModel();
 }
+
+QList<int> ToDoModel::refresh(Computed &computed, const ToDoItem &item) const
+{
+    QList<int> roles;
+    if (computed.done != item.done)
+        roles.append(DoneRole);
+    if (computed.description != item.description)
+        roles.append(DescriptionRole);
+    if (computed.due != item.due)
+        roles.append(DueRole);
+    if (computed.priority != item.priority)
+        roles.append(PriorityRole);
+
+    const QHash<int, QList<int>> &table = dependencies();
+    for (auto it = table.cbegin(); it != table.cend(); ++it) {
+        const bool stale = std::any_of(it.value().cbegin(), it.value().cend(), [&](int source) {
+            return roles.contains(source);
+        });
+        if (stale) {
+            invalidate(item.id, computed, it.key() - UrgencyRole);
+            roles.append(it.key());
+        }
+    }
+
+    computed.done = item.done;
+    computed.description = item.description;
+    computed.due = item.due;
+    computed.priority = item.priority;
+    return roles;
+}
+
+QList<int> ToDoModel::changedRoles(const ToDoItem &item) const
+{
+    // Nothing was computed for an item no view has read, so there is no
+    // telling what changed: all of its roles did.
+    auto computed = mComputed.find(item.id);
+    if (computed == mComputed.end())
+        return QList<int>();
+
+    // Custom fields are not part of the item, so their roles are always
+    // included.
+    QList<int> roles = untrackedRoles() + refresh(*computed, item);
+    for (int i = 0; i < mList->customFieldNames().size(); ++i)
+        roles.append(CustomFieldRole + i);
+    return roles;
+}
+
+QVariant ToDoModel::computedData(const ToDoItem &item, int role) const
+{
+    auto computed = mComputed.find(item.id);
+    if (computed == mComputed.end()) {
+        computed = mComputed.insert(item.id, Computed());
+        refresh(*computed, item);
+    }
+
+    const int slot = role - UrgencyRole;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 &validUntil = computed->validUntil[slot];
+    if (now >= validUntil) {
+        invalidate(item.id, *computed, slot);
+        computed->values[slot] = compute(item, role, now, &validUntil);
+        if (validUntil != Forever) {
+            mExpiries.insert(validUntil, { item.id, slot });
+            if (validUntil < mNextExpiry) {
+                mNextExpiry = validUntil;
+                mExpiryTimer.start(int(std::min<qint64>(mNextExpiry - now, std::numeric_limits<int>::max())));
+            }
+        }
+    }
+    return computed->values[slot];
+}
+
+void ToDoModel::invalidate(quint32 id, Computed &computed, int slot) const
+{
+    qint64 &validUntil = computed.validUntil[slot];
+    if (validUntil && validUntil != Forever)
+        mExpiries.remove(validUntil, { id, slot });
+    validUntil = 0;
+}
+
+void ToDoModel::forget(quint32 id)
+{
+    auto computed = mComputed.find(id);
+    if (computed == mComputed.end())
+        return;
+    for (int slot = 0; slot < ComputedRoleCount; ++slot)
+        invalidate(id, *computed, slot);
+    mComputed.erase(computed);
+}
+
+void ToDoModel::expireComputed()
+{
+    // Values that depend on the clock, such as overdue, are reported as
+    // changed once they run out and computed again when next read. Only
+    // those that ran out are visited, in the order they do.
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QHash<quint32, QList<int>> expired;
+    while (!mExpiries.isEmpty() && mExpiries.firstKey() <= now) {
+        const auto [id, slot] = mExpiries.first();
+        mExpiries.erase(mExpiries.begin());
+        mComputed[id].validUntil[slot] = 0;
+        expired[id].append(UrgencyRole + slot);
+    }
+
+    mNextExpiry = mExpiries.isEmpty() ? Forever : mExpiries.firstKey();
+    if (mNextExpiry != Forever)
+        mExpiryTimer.start(int(std::min<qint64>(mNextExpiry - now, std::numeric_limits<int>::max())));
+    for (auto it = expired.cbegin(); it != expired.cend(); ++it) {
+        const QModelIndex changed = index(mList->indexOfId(it.key()));
+        emit dataChanged(changed, changed, it.value());
+    }
+}
@@ -2,9 +2,11 @@
 #define TODOMODEL_H
 
 #include <QAbstractListModel>
+#include <QMultiMap>
 #include <QQmlEngine>
+#include <QTimer>
 
-class ToDoList;
+#include "ToDoList.h"
 
 class ToDoModel : public QAbstractListModel
 {
@@ -17,7 +19,28 @@ public:
 
     enum {
         DoneRole = Qt::UserRole,
-        DescriptionRole
+        DescriptionRole,
+        TagsRole,
+        DueRole,
+        PriorityRole,
+        // RRULE text, see Recurrence.
+        RecurrenceRole,
+        // Hashes, see BlobStore.
+        AttachmentsRole,
+        // Index of the item this one was flagged as a duplicate of, or -1.
+        DuplicateOfRole,
+        // Read-only, maintained by the list.
+        CreatedRole,
+        ModifiedRole,
+        CompletedRole,
+        // Read-only, derived from other roles and cached per item, see
+        // dependencies() in ToDoModel.cpp.
+        UrgencyRole,
+        WordCountRole,
+        OverdueRole,
+        // One role per custom field of the list, in the order of
+        // ToDoList::customFieldNames(), named after the field.
+        CustomFieldRole = Qt::UserRole + 100
     };
 
     // Basic functionality:
@@ -40,7 +63,37 @@ signals:
     void listChanged();
 
 private:
+    static constexpr int ComputedRoleCount = OverdueRole - UrgencyRole + 1;
+
+    // Computed roles of an item, filled in when a view first reads one, with
+    // the source fields they were computed from so that a change can be
+    // reported with the roles it touched. A value is valid while the current
+    // time is before its validUntil, which is 0 once one of its source
+    // fields changed and the end of time unless it also depends on the clock.
+    struct Computed
+    {
+        bool done = false;
+        QString description;
+        qint64 due = 0;
+        int priority = 0;
+        QVariant values[ComputedRoleCount];
+        qint64 validUntil[ComputedRoleCount] = {};
+    };
+
+    QList<int> refresh(Computed &computed, const ToDoItem &item) const;
+    QList<int> changedRoles(const ToDoItem &item) const;
+    QVariant computedData(const ToDoItem &item, int role) const;
+    void invalidate(quint32 id, Computed &computed, int slot) const;
+    void forget(quint32 id);
+    void expireComputed();
+
     ToDoList* mList;
+    mutable QHash<quint32, Computed> mComputed;
+    // Computed values that depend on the clock by the time they run out,
+    // as item id and role slot.
+    mutable QMultiMap<qint64, QPair<quint32, int>> mExpiries;
+    mutable QTimer mExpiryTimer;
+    mutable qint64 mNextExpiry;
 };
 
 #endif // TODOMODEL_H
@@ -0,0 +1,694 @@
+#include "ToDoTreeModel.h"
+#include "ToDoList.h"
+
+#include <iterator>
+
+namespace {
+
+// Splices folded into the positions hash at once, which bounds the work of
+// every lookup.
+constexpr int MaxShifts = 64;
+
+// Subtree sizes and child counts of a preorder run, from its depths.
+void measure(const QVector<int> &depths, QVector<int> &sizes, QVector<int> &childCounts)
+{
+    sizes.fill(1, depths.size());
+    childCounts.fill(0, depths.size());
+    QVector<int> open;
+    for (int p = 0; p < depths.size(); ++p) {
+        while (!open.isEmpty() && depths.at(open.last()) >= depths.at(p)) {
+            const int top = open.takeLast();
+            sizes[top] = p - top;
+        }
+        if (!open.isEmpty())
+            ++childCounts[open.last()];
+        open.append(p);
+    }
+    for (const int top : std::as_const(open))
+        sizes[top] = depths.size() - top;
+}
+
+// Inserts runs before ascending positions in a single pass; a single run
+// only moves what comes after it.
+template<typename T>
+void splice(QVector<T> &values, const QVector<int> &positions, const QVector<QVector<T>> &runs)
+{
+    if (positions.size() == 1) {
+        values.insert(positions.first(), runs.first().size(), T());
+        std::copy(runs.first().cbegin(), runs.first().cend(), values.begin() + positions.first());
+        return;
+    }
+
+    QVector<T> spliced;
+    int count = values.size();
+    for (const QVector<T> &run : runs)
+        count += run.size();
+    spliced.reserve(count);
+    int from = 0;
+    for (int i = 0; i < positions.size(); ++i) {
+        std::copy(values.cbegin() + from, values.cbegin() + positions.at(i), std::back_inserter(spliced));
+        spliced += runs.at(i);
+        from = positions.at(i);
+    }
+    std::copy(values.cbegin() + from, values.cend(), std::back_inserter(spliced));
+    values = spliced;
+}
+
+}
+
+ToDoTreeModel::ToDoTreeModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , mList(nullptr)
+{
+}
+
+int ToDoTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !mList)
+        return 0;
+
+    return mVisible.visibleCount();
+}
+
+QVariant ToDoTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || !mList)
+        return QVariant();
+
+    const int position = mVisible.select(index.row());
+    if (position < 0)
+        return QVariant();
+
+    const ToDoItem item = mList->items().at(mList->indexOfId(mIds.at(position)));
+    switch(role){
+    case DoneRole:
+        return QVariant(item.done);
+    case DescriptionRole:
+        return QVariant(item.description);
+    case DepthRole:
+        return QVariant(mDepths.at(position));
+    case HasChildrenRole:
+        return QVariant(mChildCounts.at(position) > 0);
+    case ExpandedRole:
+        return QVariant(!mCollapsedIds.contains(item.id));
+    }
+
+    return QVariant();
+}
+bool ToDoTreeModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || !mList)
+        return false;
+
+    if (role == ExpandedRole) {
+        if (value.toBool())
+            expand(index.row());
+        else
+            collapse(index.row());
+        return true;
+    }
+
+    const int row = listIndex(index.row());
+    ToDoItem item = mList->items().at(row);
+    switch(role){
+    case DoneRole:
+        item.done = value.toBool();
+        break;
+    case DescriptionRole:
+        item.description = value.toString();
+        break;
+    }
+
+    return mList->setItemAt(row, item);
+}
+
+Qt::ItemFlags ToDoTreeModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    return Qt::ItemIsEditable;
+}
+
+QHash<int, QByteArray> ToDoTreeModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    names[DoneRole] = "done";
+    names[DescriptionRole] = "description";
+    names[DepthRole] = "depth";
+    names[HasChildrenRole] = "hasChildren";
+    names[ExpandedRole] = "expanded";
+    return names;
+}
+
+ToDoList *ToDoTreeModel::list() const
+{
+    return mList;
+}
+
+void ToDoTreeModel::setList(ToDoList *list)
+{
+    beginResetModel();
+
+    if (mList)
+        mList->disconnect(this);
+
+    mList = list;
+    mCollapsedIds.clear();
+    rebuild();
+
+    emit listChanged();
+
+    if (mList) {
+        connect(mList, &ToDoList::postItemAppended, this, [=]() {
+            insertItem(mList->items().size() - 1);
+        });
+
+        // The item is still in the list, so its subtree can be looked up.
+        connect(mList, &ToDoList::preItemRemoved, this, [=](int index) {
+            removeItem(mList->items().at(index).id);
+        });
+        connect(mList, &ToDoList::postItemRemoved, this, [=]() {
+            relayoutIfPending();
+        });
+
+        connect(mList, &ToDoList::itemChanged, this, [=](int index) {
+            const int position = this->position(mList->items().at(index).id);
+            if (!mVisible.isVisible(position))
+                return;
+            const QModelIndex changed = this->index(mVisible.rank(position));
+            emit dataChanged(changed, changed);
+        });
+
+        // Ranges arrive when a reloaded file is applied.
+        connect(mList, &ToDoList::preItemsInserted, this, [=](int first, int last) {
+            mInsertFirst = first;
+            mInsertLast = last;
+        });
+        connect(mList, &ToDoList::postItemsInserted, this, [=]() {
+            const QVector<ToDoItem> items = mList->items();
+            for (int index = mInsertFirst; index <= mInsertLast; ++index)
+                insertItem(index);
+            for (int index = mInsertFirst; index <= mInsertLast && !mRelayoutPending; ++index)
+                mRelayoutPending = position(items.at(index).id) < 0;
+
+            // A reloaded item can also be the parent of items shown at the
+            // top level so far, or come after its own children; only then
+            // is the tree laid out again.
+            for (int position = 0; position < mIds.size() && !mRelayoutPending; position += mSubtreeSizes.at(position)) {
+                if (!mIds.at(position))
+                    continue;
+                const ToDoItem &item = items.at(mList->indexOfId(mIds.at(position)));
+                mRelayoutPending = item.parentId && item.parentId != item.id && mList->indexOfId(item.parentId) >= 0;
+            }
+            relayoutIfPending();
+        });
+        connect(mList, &ToDoList::preItemsRemoved, this, [=](int first, int last) {
+            const QVector<ToDoItem> items = mList->items();
+            for (int index = first; index <= last; ++index)
+                removeItem(items.at(index).id);
+        });
+        connect(mList, &ToDoList::postItemsRemoved, this, [=]() {
+            relayoutIfPending();
+        });
+        connect(mList, &ToDoList::itemsChanged, this, [=](int first, int last) {
+            for (int index = first; index <= last; ++index)
+                moveItem(index);
+            relayoutIfPending();
+        });
+
+        connect(mList, &ToDoList::preItemsReset, this, [=]() {
+            beginResetModel();
+        });
+        connect(mList, &ToDoList::postItemsReset, this, [=]() {
+            mCollapsedIds.clear();
+            mRelayoutPending = false;
+            rebuild();
+            endResetModel();
+        });
+    }
+
+    endResetModel();
+}
+
+int ToDoTreeModel::listIndex(int row) const
+{
+    const int position = mVisible.select(row);
+    return position < 0 ? -1 : mList->indexOfId(mIds.at(position));
+}
+
+void ToDoTreeModel::expand(int row)
+{
+    const int position = mVisible.select(row);
+    if (position < 0)
+        return;
+
+    const quint32 id = mIds.at(position);
+    if (!mCollapsedIds.contains(id))
+        return;
+
+    const int first = position + 1;
+    const int last = position + mSubtreeSizes.at(position) - 1;
+
+    // Nested collapsed nodes keep their own descendants hidden, so measure
+    // what actually becomes visible before announcing the insertion.
+    mVisible.show(first, last);
+    const int shown = mVisible.countVisible(first, last);
+    mVisible.hide(first, last);
+
+    if (shown > 0)
+        beginInsertRows(QModelIndex(), row + 1, row + shown);
+    mVisible.show(first, last);
+    mCollapsedIds.remove(id);
+    if (shown > 0)
+        endInsertRows();
+
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, QVector<int>() << ExpandedRole);
+}
+
+void ToDoTreeModel::collapse(int row)
+{
+    const int position = mVisible.select(row);
+    if (position < 0 || mChildCounts.at(position) == 0)
+        return;
+
+    const quint32 id = mIds.at(position);
+    if (mCollapsedIds.contains(id))
+        return;
+
+    const int first = position + 1;
+    const int last = position + mSubtreeSizes.at(position) - 1;
+    const int hidden = mVisible.countVisible(first, last);
+
+    if (hidden > 0)
+        beginRemoveRows(QModelIndex(), row + 1, row + hidden);
+    mVisible.hide(first, last);
+    mCollapsedIds.insert(id);
+    if (hidden > 0)
+        endRemoveRows();
+
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, QVector<int>() << ExpandedRole);
+}
+
+void ToDoTreeModel::toggle(int row)
+{
+    if (data(index(row), ExpandedRole).toBool())
+        collapse(row);
+    else
+        expand(row);
+}
+
+void ToDoTreeModel::rebuild()
+{
+    mIds.clear();
+    mParentIds.clear();
+    mDepths.clear();
+    mTombstones = 0;
+
+    if (!mList) {
+        relayout();
+        return;
+    }
+
+    const QVector<ToDoItem> items = mList->items();
+    const int count = items.size();
+
+    // Items whose parent no longer exists are shown at the top level.
+    QVector<int> parents(count, -1);
+    QVector<QVector<int>> children(count);
+    QVector<int> roots;
+    for (int i = 0; i < count; ++i) {
+        const int parent = items.at(i).parentId ? mList->indexOfId(items.at(i).parentId) : -1;
+        if (parent < 0 || parent == i) {
+            roots.append(i);
+        } else {
+            parents[i] = parent;
+            children[parent].append(i);
+        }
+    }
+
+    // Iterative preorder walk; the sizes follow from the depths.
+    mIds.reserve(count);
+    mParentIds.reserve(count);
+    mDepths.reserve(count);
+    QVector<QPair<int, int>> stack;
+    for (int r = roots.size() - 1; r >= 0; --r)
+        stack.append({ roots.at(r), 0 });
+    while (!stack.isEmpty()) {
+        const auto [index, depth] = stack.takeLast();
+        mIds.append(items.at(index).id);
+        mParentIds.append(parents.at(index) >= 0 ? items.at(parents.at(index)).id : 0);
+        mDepths.append(depth);
+
+        const QVector<int> &kids = children.at(index);
+        for (int k = kids.size() - 1; k >= 0; --k)
+            stack.append({ kids.at(k), depth + 1 });
+    }
+
+    relayout();
+}
+
+void ToDoTreeModel::relayout()
+{
+    // Drops the tombstones, then derives the subtree sizes and child counts
+    // from the depths.
+    QVector<quint32> ids;
+    QVector<quint32> parentIds;
+    QVector<int> depths;
+    const int count = mIds.size() - mTombstones;
+    ids.reserve(count);
+    parentIds.reserve(count);
+    depths.reserve(count);
+    for (int p = 0; p < mIds.size(); ++p) {
+        if (mIds.at(p)) {
+            ids.append(mIds.at(p));
+            parentIds.append(mParentIds.at(p));
+            depths.append(mDepths.at(p));
+        }
+    }
+
+    mIds = ids;
+    mParentIds = parentIds;
+    mDepths = depths;
+    mTombstones = 0;
+    measure(mDepths, mSubtreeSizes, mChildCounts);
+
+    foldPositions();
+    resetVisibility();
+}
+
+void ToDoTreeModel::resetVisibility()
+{
+    mVisible.reset(mIds.size());
+    for (int position = 0; position < mIds.size(); ++position) {
+        if (!mIds.at(position))
+            mVisible.hide(position, position);
+        else if (mChildCounts.at(position) > 0 && mCollapsedIds.contains(mIds.at(position)))
+            mVisible.hide(position + 1, position + mSubtreeSizes.at(position) - 1);
+    }
+}
+
+void ToDoTreeModel::foldPositions()
+{
+    mPositions.clear();
+    mPositions.reserve(mIds.size() - mTombstones);
+    for (int p = 0; p < mIds.size(); ++p) {
+        if (mIds.at(p))
+            mPositions.insert(mIds.at(p), p);
+    }
+    mInsertedPositions.clear();
+    mShifts.clear();
+}
+
+int ToDoTreeModel::position(quint32 id) const
+{
+    if (!id)
+        return -1;
+
+    int position = -1;
+    int applied = 0;
+    const auto inserted = mInsertedPositions.constFind(id);
+    if (inserted != mInsertedPositions.cend()) {
+        position = inserted->first;
+        applied = inserted->second;
+    } else {
+        position = mPositions.value(id, -1);
+        if (position < 0)
+            return -1;
+    }
+
+    for (int i = applied; i < mShifts.size(); ++i) {
+        if (mShifts.at(i).first <= position)
+            position += mShifts.at(i).second;
+    }
+    return position;
+}
+
+int ToDoTreeModel::insertPosition(int parentPosition, int listIndex) const
+{
+    // Children, and top-level items, are ordered by their index in the list.
+    const int first = parentPosition < 0 ? 0 : parentPosition + 1;
+    const int end = parentPosition < 0 ? mIds.size() : parentPosition + mSubtreeSizes.at(parentPosition);
+    for (int p = first; p < end; p += mSubtreeSizes.at(p)) {
+        if (mIds.at(p) && mList->indexOfId(mIds.at(p)) > listIndex)
+            return p;
+    }
+    return end;
+}
+
+void ToDoTreeModel::insertItem(int listIndex)
+{
+    const ToDoItem item = mList->items().at(listIndex);
+    const int parentPosition = item.parentId != item.id ? position(item.parentId) : -1;
+
+    // Below an item that is left out of the tree, as rebuild() does.
+    if (parentPosition < 0 && item.parentId && item.parentId != item.id && mList->indexOfId(item.parentId) >= 0)
+        return;
+
+    // A top-level item appended to the list lands at the end of the
+    // preorder, without a walk over the other top-level items.
+    const bool appended = parentPosition < 0 && listIndex == mList->items().size() - 1;
+
+    Insertion insertion;
+    insertion.position = appended ? mIds.size() : insertPosition(parentPosition, listIndex);
+    insertion.parentPosition = parentPosition;
+    insertion.block.ids.append(item.id);
+    insertion.block.parentIds.append(0);
+    insertion.block.depths.append(0);
+    insertBlocks({ insertion });
+}
+
+void ToDoTreeModel::insertBlocks(QVector<Insertion> insertions)
+{
+    // The insertions come in ascending positions; every position below is
+    // taken before the splice until it is moved past the earlier blocks.
+    QVector<int> positions;
+    QVector<QVector<quint32>> ids;
+    QVector<QVector<quint32>> parentIds;
+    QVector<QVector<int>> depths;
+    QVector<QVector<int>> sizes;
+    QVector<QVector<int>> childCounts;
+    QVector<int> covers;
+    QVector<quint32> parents;
+    for (Insertion &insertion : insertions) {
+        Block &block = insertion.block;
+        const quint32 parentId = insertion.parentPosition < 0 ? 0 : mIds.at(insertion.parentPosition);
+        const int depth = insertion.parentPosition < 0 ? 0 : mDepths.at(insertion.parentPosition) + 1;
+        block.parentIds[0] = parentId;
+        for (int &d : block.depths)
+            d += depth;
+
+        // The ancestors span the block from now on, and each collapsed one
+        // covers it, as resetVisibility() would have it.
+        int cover = 0;
+        for (int p = insertion.parentPosition; p >= 0; p = position(mParentIds.at(p))) {
+            mSubtreeSizes[p] += block.ids.size();
+            if (mCollapsedIds.contains(mIds.at(p)))
+                ++cover;
+        }
+        if (insertion.parentPosition >= 0)
+            ++mChildCounts[insertion.parentPosition];
+
+        positions.append(insertion.position);
+        ids.append(block.ids);
+        parentIds.append(block.parentIds);
+        depths.append(block.depths);
+        sizes.append(QVector<int>());
+        childCounts.append(QVector<int>());
+        measure(block.depths, sizes.last(), childCounts.last());
+        covers.append(cover);
+        parents.append(parentId);
+    }
+
+    const int end = mIds.size();
+    splice(mIds, positions, ids);
+    splice(mParentIds, positions, parentIds);
+    splice(mDepths, positions, depths);
+    splice(mSubtreeSizes, positions, sizes);
+    splice(mChildCounts, positions, childCounts);
+
+    // From here on positions are taken after the splice. Appending at the
+    // end moves nothing, so it needs no shift.
+    int shift = 0;
+    for (int i = 0; i < positions.size(); ++i) {
+        if (positions.at(i) < end)
+            mShifts.append({ positions.at(i) + shift, ids.at(i).size() });
+        positions[i] += shift;
+        shift += ids.at(i).size();
+    }
+    for (int i = 0; i < positions.size(); ++i) {
+        for (int j = 0; j < ids.at(i).size(); ++j)
+            mInsertedPositions.insert(ids.at(i).at(j), { positions.at(i) + j, mShifts.size() });
+    }
+    if (mShifts.size() > MaxShifts)
+        foldPositions();
+
+    // Every block goes into the visibility tree hidden once more than it
+    // ends up, so the rows stay put until each one is announced.
+    for (int i = 0; i < positions.size(); ++i) {
+        const int first = positions.at(i);
+        const int last = first + ids.at(i).size() - 1;
+        mVisible.insert(first, ids.at(i).size());
+        for (int c = 0; c <= covers.at(i); ++c)
+            mVisible.hide(first, last);
+        for (int j = 0; j < ids.at(i).size(); ++j) {
+            if (childCounts.at(i).at(j) > 0 && mCollapsedIds.contains(ids.at(i).at(j)))
+                mVisible.hide(first + j + 1, first + j + sizes.at(i).at(j) - 1);
+        }
+    }
+    for (int i = 0; i < positions.size(); ++i) {
+        const int first = positions.at(i);
+        const int last = first + ids.at(i).size() - 1;
+        mVisible.show(first, last);
+        const int shown = mVisible.countVisible(first, last);
+        mVisible.hide(first, last);
+
+        const int row = mVisible.rank(first);
+        if (shown > 0)
+            beginInsertRows(QModelIndex(), row, row + shown - 1);
+        mVisible.show(first, last);
+        if (shown > 0)
+            endInsertRows();
+    }
+
+    for (const quint32 parentId : std::as_const(parents)) {
+        if (parentId && mChildCounts.at(position(parentId)) == 1)
+            emitHasChildrenChanged(parentId);
+    }
+}
+
+ToDoTreeModel::Block ToDoTreeModel::takeSubtree(int position)
+{
+    const int last = position + mSubtreeSizes.at(position) - 1;
+    const int row = mVisible.rank(position);
+    const int hidden = mVisible.countVisible(position, last);
+    const quint32 parentId = mParentIds.at(position);
+
+    Block block;
+    for (int p = position; p <= last; ++p) {
+        if (!mIds.at(p))
+            continue;
+        block.ids.append(mIds.at(p));
+        block.parentIds.append(p == position ? 0 : mParentIds.at(p));
+        block.depths.append(mDepths.at(p) - mDepths.at(position));
+    }
+
+    if (hidden > 0)
+        beginRemoveRows(QModelIndex(), row, row + hidden - 1);
+    for (int p = position; p <= last; ++p) {
+        if (!mIds.at(p))
+            continue;
+        mPositions.remove(mIds.at(p));
+        mInsertedPositions.remove(mIds.at(p));
+        mIds[p] = 0;
+        mSubtreeSizes[p] = 1;
+        mChildCounts[p] = 0;
+        ++mTombstones;
+    }
+    mVisible.hide(position, last);
+    if (hidden > 0)
+        endRemoveRows();
+
+    const int parentPosition = this->position(parentId);
+    if (parentPosition >= 0 && --mChildCounts[parentPosition] == 0)
+        emitHasChildrenChanged(parentId);
+    return block;
+}
+
+void ToDoTreeModel::removeItem(quint32 id)
+{
+    const int position = this->position(id);
+    if (position < 0) {
+        // Items whose parents form a cycle are left out of the tree;
+        // removing one of them can let the others in.
+        mRelayoutPending = true;
+        return;
+    }
+
+    const Block subtree = takeSubtree(position);
+    mCollapsedIds.remove(id);
+
+    // The children lose their parent and move to the top level, each with
+    // its own subtree. They come in list order, so one walk over the
+    // top-level items places them all.
+    QVector<Insertion> orphans;
+    for (int i = 1; i < subtree.ids.size(); ++i) {
+        if (subtree.depths.at(i) == 1)
+            orphans.append({ -1, -1, Block() });
+        Block &orphan = orphans.last().block;
+        orphan.ids.append(subtree.ids.at(i));
+        orphan.parentIds.append(subtree.depths.at(i) == 1 ? 0 : subtree.parentIds.at(i));
+        orphan.depths.append(subtree.depths.at(i) - 1);
+    }
+    int p = 0;
+    for (Insertion &orphan : orphans) {
+        const int listIndex = mList->indexOfId(orphan.block.ids.first());
+        while (p < mIds.size() && !(mIds.at(p) && mList->indexOfId(mIds.at(p)) > listIndex))
+            p += mSubtreeSizes.at(p);
+        orphan.position = p;
+    }
+    if (!orphans.isEmpty())
+        insertBlocks(orphans);
+
+    // Tombstones are dropped once they make up half of the positions; rows
+    // do not change.
+    if (mTombstones > mIds.size() / 2)
+        relayout();
+}
+
+void ToDoTreeModel::moveItem(int listIndex)
+{
+    const ToDoItem item = mList->items().at(listIndex);
+    const int position = this->position(item.id);
+    if (position < 0) {
+        mRelayoutPending = true;
+        return;
+    }
+
+    const int parentPosition = item.parentId != item.id ? this->position(item.parentId) : -1;
+    const quint32 parentId = parentPosition < 0 ? 0 : item.parentId;
+    if (parentPosition < 0 && item.parentId && item.parentId != item.id && mList->indexOfId(item.parentId) >= 0) {
+        takeSubtree(position);
+        return;
+    }
+    if (parentId == mParentIds.at(position)) {
+        if (mVisible.isVisible(position)) {
+            const QModelIndex changed = index(mVisible.rank(position));
+            emit dataChanged(changed, changed);
+        }
+        return;
+    }
+
+    // A parent inside the item's own subtree makes a cycle, which leaves
+    // the whole subtree out of the tree.
+    if (parentPosition >= position && parentPosition < position + mSubtreeSizes.at(position)) {
+        takeSubtree(position);
+        return;
+    }
+
+    const Block subtree = takeSubtree(position);
+    const int newParentPosition = this->position(parentId);
+    insertBlocks({ { insertPosition(newParentPosition, listIndex), newParentPosition, subtree } });
+}
+
+void ToDoTreeModel::relayoutIfPending()
+{
+    if (!mRelayoutPending)
+        return;
+
+    mRelayoutPending = false;
+    beginResetModel();
+    rebuild();
+    endResetModel();
+}
+
+void ToDoTreeModel::emitHasChildrenChanged(quint32 id)
+{
+    const int position = this->position(id);
+    if (!mVisible.isVisible(position))
+        return;
+    const QModelIndex changed = index(mVisible.rank(position));
+    emit dataChanged(changed, changed, QVector<int>() << HasChildrenRole);
+}
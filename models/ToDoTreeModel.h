@@ -0,0 +1,124 @@
+#ifndef TODOTREEMODEL_H
+#define TODOTREEMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QQmlEngine>
+#include <QSet>
+
+#include "VisibleRangeTree.h"
+
+class ToDoList;
+
+// Flattens the subtask tree of a ToDoList into the visible rows of a list
+// model. Items are kept in preorder so that every subtree is a contiguous
+// range of positions; collapsing a node hides that range in a
+// VisibleRangeTree, which makes expand/collapse O(log n) plus a single row
+// range notification, whatever the size of the subtree.
+//
+// Removing an item hides its range as tombstones, so no position moves, and
+// announces one row removal; its children become top-level items and are
+// spliced in again where they belong, all in one pass. Inserting splices the
+// positions in, grows the ancestors' subtrees and inserts the range into the
+// VisibleRangeTree without relinearizing the tree; tombstones are dropped
+// once they make up half of the positions.
+class ToDoTreeModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(ToDoList* list READ list WRITE setList NOTIFY listChanged)
+
+public:
+    explicit ToDoTreeModel(QObject *parent = nullptr);
+
+    enum {
+        DoneRole = Qt::UserRole,
+        DescriptionRole,
+        DepthRole,
+        HasChildrenRole,
+        ExpandedRole
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    bool setData(const QModelIndex &index, const QVariant &value,
+                 int role = Qt::EditRole) override;
+
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    ToDoList* list() const;
+    void setList(ToDoList* list);
+
+    // Index of the row's item in the list, for calls such as appendSubItem().
+    Q_INVOKABLE int listIndex(int row) const;
+
+    Q_INVOKABLE void expand(int row);
+    Q_INVOKABLE void collapse(int row);
+    Q_INVOKABLE void toggle(int row);
+
+signals:
+    void listChanged();
+
+private:
+    // A preorder run of positions cut out of the tree or about to be put in;
+    // depths are relative to the first position.
+    struct Block
+    {
+        QVector<quint32> ids;
+        QVector<quint32> parentIds;
+        QVector<int> depths;
+    };
+
+    // A block to splice in before position, below the item at
+    // parentPosition or at the top level for -1.
+    struct Insertion
+    {
+        int position;
+        int parentPosition;
+        Block block;
+    };
+
+    void rebuild();
+    void resetVisibility();
+    void relayout();
+    void foldPositions();
+    int position(quint32 id) const;
+    int insertPosition(int parentPosition, int listIndex) const;
+    void insertItem(int listIndex);
+    void insertBlocks(QVector<Insertion> insertions);
+    Block takeSubtree(int position);
+    void removeItem(quint32 id);
+    void moveItem(int listIndex);
+    void relayoutIfPending();
+    void emitHasChildrenChanged(quint32 id);
+
+    ToDoList* mList;
+
+    // Indexed by preorder position. Removed items leave hidden tombstones
+    // with id 0 behind until the next relayout.
+    QVector<quint32> mIds;
+    QVector<quint32> mParentIds; // 0 for top-level items
+    QVector<int> mSubtreeSizes;  // positions spanned, tombstones included
+    QVector<int> mChildCounts;
+    QVector<int> mDepths;
+    int mTombstones = 0;
+
+    // Positions as of the last fold, and those of the ids inserted since
+    // with the number of splices already applied to them. Every splice
+    // shifts the positions at or after its own by its size.
+    QHash<quint32, int> mPositions;
+    QHash<quint32, QPair<int, int>> mInsertedPositions;
+    QVector<QPair<int, int>> mShifts; // position, count
+    int mInsertFirst = 0;
+    int mInsertLast = -1;
+    bool mRelayoutPending = false;
+
+    QSet<quint32> mCollapsedIds;
+    VisibleRangeTree mVisible;
+};
+
+#endif // TODOTREEMODEL_H
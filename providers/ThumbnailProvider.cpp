@@ -0,0 +1,125 @@
+#include "ThumbnailProvider.h"
+
+#include <QImageReader>
+#include <QMutexLocker>
+
+#include <atomic>
+#include <memory>
+
+namespace {
+
+class ThumbnailResponse : public QQuickImageResponse
+{
+public:
+    ThumbnailResponse(ThumbnailProvider *provider, QThreadPool *pool, const QString &hash, const QSize &size)
+        : mState(std::make_shared<State>())
+    {
+        mState->response = this;
+        const std::shared_ptr<State> state = mState;
+        pool->start([=]() {
+            QString error;
+            const QImage image = state->cancelled ? QImage() : provider->thumbnail(hash, size, &error);
+
+            // Posted while the response is known to be alive; events for an
+            // object deleted before they are delivered are dropped.
+            QMutexLocker locker(&state->mutex);
+            if (ThumbnailResponse *response = state->response) {
+                QMetaObject::invokeMethod(response, [=]() {
+                    response->mImage = image;
+                    response->mError = error;
+                    emit response->finished();
+                }, Qt::QueuedConnection);
+            }
+        });
+    }
+
+    ~ThumbnailResponse() override
+    {
+        QMutexLocker locker(&mState->mutex);
+        mState->response = nullptr;
+    }
+
+    QQuickTextureFactory *textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(mImage);
+    }
+
+    QString errorString() const override
+    {
+        return mError;
+    }
+
+    void cancel() override
+    {
+        mState->cancelled = true;
+    }
+
+private:
+    struct State
+    {
+        QMutex mutex;
+        ThumbnailResponse *response = nullptr;
+        std::atomic_bool cancelled { false };
+    };
+
+    std::shared_ptr<State> mState;
+    QImage mImage;
+    QString mError;
+};
+
+}
+
+ThumbnailProvider::ThumbnailProvider(const QString &blobDirectory)
+    : mStore(blobDirectory)
+    , mCache(CacheKilobytes)
+{
+}
+
+ThumbnailProvider::~ThumbnailProvider()
+{
+    mPool.clear();
+    mPool.waitForDone();
+}
+
+QQuickImageResponse *ThumbnailProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    return new ThumbnailResponse(this, &mPool, id, requestedSize);
+}
+
+QImage ThumbnailProvider::thumbnail(const QString &hash, const QSize &size, QString *error)
+{
+    const QSize bounds(size.width() > 0 ? size.width() : DefaultSize,
+                       size.height() > 0 ? size.height() : DefaultSize);
+    const QString key = QStringLiteral("%1@%2x%3").arg(hash).arg(bounds.width()).arg(bounds.height());
+    {
+        QMutexLocker locker(&mCacheMutex);
+        if (const QImage *image = mCache.object(key))
+            return *image;
+    }
+
+    const QString path = mStore.path(hash);
+    if (path.isEmpty()) {
+        *error = QStringLiteral("Not an attachment: %1").arg(hash);
+        return QImage();
+    }
+
+    // Formats that support it (JPEG in particular) decode straight to the
+    // smaller size instead of decoding everything and scaling afterwards.
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+    const QSize original = reader.size();
+    if (original.isValid() && (original.width() > bounds.width() || original.height() > bounds.height()))
+        reader.setScaledSize(original.scaled(bounds, Qt::KeepAspectRatio));
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        *error = reader.errorString();
+        return QImage();
+    }
+    if (image.width() > bounds.width() || image.height() > bounds.height())
+        image = image.scaled(bounds, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    QMutexLocker locker(&mCacheMutex);
+    mCache.insert(key, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+    return image;
+}
@@ -0,0 +1,37 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+
+#include "BlobStore.h"
+
+// Thumbnails of attachments for "image://thumbnails/<hash>". Images are
+// decoded on the provider's own thread pool, scaled while decoding where the
+// format allows, and kept in a cache bounded by their size in memory, so
+// rows scrolling back into view do not decode again.
+class ThumbnailProvider : public QQuickAsyncImageProvider
+{
+public:
+    explicit ThumbnailProvider(const QString &blobDirectory = BlobStore::defaultDirectory());
+    ~ThumbnailProvider() override;
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+    // Decodes or looks up a thumbnail; called on the worker threads.
+    QImage thumbnail(const QString &hash, const QSize &size, QString *error);
+
+private:
+    static constexpr int DefaultSize = 128;
+    static constexpr int CacheKilobytes = 32 * 1024;
+
+    BlobStore mStore;
+    QThreadPool mPool;
+    QMutex mCacheMutex;
+    QCache<QString, QImage> mCache;
+};
+
+#endif // THUMBNAILPROVIDER_H
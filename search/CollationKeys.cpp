@@ -0,0 +1,116 @@
+#include "CollationKeys.h"
+#include "ToDoList.h"
+
+#include <QCollator>
+#include <QtConcurrent>
+
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int ChunkSize = 4096;
+
+using KeyedChunk = std::vector<std::pair<quint32, QCollatorSortKey>>;
+
+// QCollator shares its backend state between copies, so each chunk gets its
+// own instance.
+KeyedChunk sortKeys(const QLocale &locale, const QVector<const ToDoItem *> &items, qsizetype first, qsizetype count)
+{
+    QCollator collator(locale);
+    KeyedChunk keys;
+    keys.reserve(size_t(count));
+    for (qsizetype i = first; i < first + count; ++i)
+        keys.emplace_back(items.at(i)->id, collator.sortKey(items.at(i)->description));
+    return keys;
+}
+
+} // namespace
+
+CollationKeys::CollationKeys(const QLocale &locale)
+    : mLocale(locale)
+{
+}
+
+QLocale CollationKeys::locale() const
+{
+    return mLocale;
+}
+
+bool CollationKeys::isComplete() const
+{
+    return mComplete;
+}
+
+bool CollationKeys::contains(quint32 id) const
+{
+    return mKeys.contains(id);
+}
+
+void CollationKeys::invalidate(quint32 id)
+{
+    mKeys.remove(id);
+    mComplete = false;
+}
+
+void CollationKeys::remove(quint32 id)
+{
+    mKeys.remove(id);
+}
+
+void CollationKeys::clear()
+{
+    mKeys.clear();
+    mComplete = false;
+}
+
+void CollationKeys::update(const QVector<ToDoItem> &items)
+{
+    if (mComplete)
+        return;
+
+    QVector<const ToDoItem *> missing;
+    for (const ToDoItem &item : items) {
+        if (!mKeys.contains(item.id))
+            missing.append(&item);
+    }
+
+    if (missing.size() <= ChunkSize) {
+        for (auto &entry : sortKeys(mLocale, missing, 0, missing.size()))
+            mKeys.insert(entry.first, std::move(entry.second));
+    } else {
+        QVector<qsizetype> firsts;
+        for (qsizetype first = 0; first < missing.size(); first += ChunkSize)
+            firsts.append(first);
+
+        const QLocale locale = mLocale;
+        const QVector<KeyedChunk> chunks = QtConcurrent::blockingMapped<QVector<KeyedChunk>>(
+            firsts, [&](qsizetype first) {
+                return sortKeys(locale, missing, first, std::min<qsizetype>(ChunkSize, missing.size() - first));
+            });
+
+        mKeys.reserve(items.size());
+        for (const KeyedChunk &chunk : chunks) {
+            for (const auto &entry : chunk)
+                mKeys.insert(entry.first, entry.second);
+        }
+    }
+
+    mComplete = true;
+}
+
+int CollationKeys::compare(const ToDoItem &a, const ToDoItem &b) const
+{
+    const auto keyA = mKeys.constFind(a.id);
+    const auto keyB = mKeys.constFind(b.id);
+    if (keyA == mKeys.cend() || keyB == mKeys.cend())
+        return QCollator(mLocale).compare(a.description, b.description);
+    return keyA->compare(*keyB);
+}
+
+CollationKeys CollationKeys::build(const QLocale &locale, const QVector<ToDoItem> &items)
+{
+    CollationKeys keys(locale);
+    keys.update(items);
+    return keys;
+}
@@ -0,0 +1,43 @@
+#ifndef COLLATIONKEYS_H
+#define COLLATIONKEYS_H
+
+#include <QCollatorSortKey>
+#include <QHash>
+#include <QLocale>
+#include <QVector>
+
+struct ToDoItem;
+
+// Locale sort keys of item descriptions, keyed by item id. Comparing two
+// keys is a plain byte comparison, so sorting by description does not go
+// through QCollator::compare() for every pair.
+class CollationKeys
+{
+public:
+    explicit CollationKeys(const QLocale &locale = QLocale());
+
+    QLocale locale() const;
+
+    bool isComplete() const;
+    bool contains(quint32 id) const;
+    void invalidate(quint32 id);
+    void remove(quint32 id);
+    void clear();
+
+    // Computes the missing keys of items, in parallel when there are many.
+    void update(const QVector<ToDoItem> &items);
+
+    // Compares the descriptions with QCollator::compare() instead when a
+    // key is missing.
+    int compare(const ToDoItem &a, const ToDoItem &b) const;
+
+    // Keys of all items for locale; meant to run on a worker thread.
+    static CollationKeys build(const QLocale &locale, const QVector<ToDoItem> &items);
+
+private:
+    QLocale mLocale;
+    QHash<quint32, QCollatorSortKey> mKeys;
+    bool mComplete = false;
+};
+
+#endif // COLLATIONKEYS_H
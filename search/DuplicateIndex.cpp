@@ -0,0 +1,182 @@
+#include "DuplicateIndex.h"
+#include "Trigrams.h"
+
+#include <QSet>
+
+namespace {
+
+constexpr int RowsPerBand = DuplicateIndex::SignatureSize / DuplicateIndex::Bands;
+
+quint64 mix(quint64 value)
+{
+    // splitmix64 finalizer
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+// Multipliers and offsets of the hash functions, fixed so signatures stay
+// comparable across runs.
+struct HashFunctions
+{
+    std::array<quint64, DuplicateIndex::SignatureSize> a {};
+    std::array<quint64, DuplicateIndex::SignatureSize> b {};
+
+    HashFunctions()
+    {
+        quint64 state = 0x9e3779b97f4a7c15ull;
+        for (int i = 0; i < DuplicateIndex::SignatureSize; ++i) {
+            a[i] = mix(state += 0x9e3779b97f4a7c15ull) | 1;
+            b[i] = mix(state += 0x9e3779b97f4a7c15ull);
+        }
+    }
+};
+
+const HashFunctions &hashFunctions()
+{
+    static const HashFunctions functions;
+    return functions;
+}
+
+}
+
+QString DuplicateIndex::normalized(const QString &description)
+{
+    return description.simplified().toCaseFolded();
+}
+
+DuplicateIndex::Key DuplicateIndex::keyOf(const QString &description)
+{
+    Key key;
+    const QString text = normalized(description);
+    if (text.isEmpty())
+        return key;
+
+    quint64 hash = 14695981039346656037ull;
+    for (const QChar c : text)
+        hash = (hash ^ c.unicode()) * 1099511628211ull;
+    key.hash = hash ? hash : 1;
+
+    // Texts too short for a trigram are only ever exact duplicates.
+    QVector<quint32> shingles = Trigrams::of(text);
+    if (shingles.isEmpty())
+        return key;
+
+    const HashFunctions &functions = hashFunctions();
+    key.hasSignature = true;
+    key.signature.fill(~quint32(0));
+    for (const quint32 shingle : std::as_const(shingles)) {
+        const quint64 base = mix(shingle);
+        for (int i = 0; i < SignatureSize; ++i) {
+            const quint32 value = quint32((base * functions.a[i] + functions.b[i]) >> 32);
+            if (value < key.signature[i])
+                key.signature[i] = value;
+        }
+    }
+    return key;
+}
+
+void DuplicateIndex::insert(quint32 id, const Key &key)
+{
+    if (!key.hash)
+        return;
+
+    mKeys.insert(id, key);
+    mByHash.insert(key.hash, id);
+    if (!mRepresentatives.contains(key.hash)) {
+        mRepresentatives.insert(key.hash, id);
+        addToBuckets(id, key);
+    }
+}
+
+void DuplicateIndex::insert(const DuplicateIndex &other)
+{
+    for (auto it = other.mKeys.cbegin(); it != other.mKeys.cend(); ++it)
+        insert(it.key(), it.value());
+}
+
+void DuplicateIndex::remove(quint32 id)
+{
+    const auto it = mKeys.constFind(id);
+    if (it == mKeys.constEnd())
+        return;
+
+    const Key key = *it;
+    mKeys.erase(it);
+    mByHash.remove(key.hash, id);
+    if (mRepresentatives.value(key.hash) != id)
+        return;
+
+    // Another item with the same text takes over the buckets.
+    removeFromBuckets(id, key);
+    const auto next = mByHash.constFind(key.hash);
+    if (next == mByHash.constEnd()) {
+        mRepresentatives.remove(key.hash);
+    } else {
+        mRepresentatives.insert(key.hash, next.value());
+        addToBuckets(next.value(), mKeys.value(next.value()));
+    }
+}
+
+void DuplicateIndex::clear()
+{
+    mKeys.clear();
+    mByHash.clear();
+    mRepresentatives.clear();
+    mBuckets.clear();
+}
+
+quint32 DuplicateIndex::nearDuplicate(const Key &key) const
+{
+    if (!key.hasSignature)
+        return 0;
+
+    QSet<quint32> seen;
+    quint32 best = 0;
+    int bestAgreement = int(Threshold * SignatureSize + 0.5) - 1;
+    for (int band = 0; band < Bands; ++band) {
+        const quint64 bucket = bandKey(key, band);
+        const auto [first, last] = mBuckets.equal_range(bucket);
+        int scanned = 0;
+        for (auto it = first; it != last && scanned < MaxBucketScan; ++it, ++scanned) {
+            const quint32 id = it.value();
+            if (seen.contains(id))
+                continue;
+            seen.insert(id);
+
+            const Key &other = *mKeys.constFind(id);
+            int agreement = 0;
+            for (int i = 0; i < SignatureSize; ++i)
+                agreement += key.signature[i] == other.signature[i];
+            if (agreement > bestAgreement) {
+                best = id;
+                bestAgreement = agreement;
+            }
+        }
+    }
+    return best;
+}
+
+void DuplicateIndex::addToBuckets(quint32 id, const Key &key)
+{
+    if (!key.hasSignature)
+        return;
+    for (int band = 0; band < Bands; ++band)
+        mBuckets.insert(bandKey(key, band), id);
+}
+
+void DuplicateIndex::removeFromBuckets(quint32 id, const Key &key)
+{
+    if (!key.hasSignature)
+        return;
+    for (int band = 0; band < Bands; ++band)
+        mBuckets.remove(bandKey(key, band), id);
+}
+
+quint64 DuplicateIndex::bandKey(const Key &key, int band)
+{
+    quint64 hash = mix(quint64(band) + 1);
+    for (int row = band * RowsPerBand; row < (band + 1) * RowsPerBand; ++row)
+        hash = mix(hash ^ key.signature[row]);
+    return hash;
+}
@@ -0,0 +1,84 @@
+#ifndef DUPLICATEINDEX_H
+#define DUPLICATEINDEX_H
+
+#include <QHash>
+#include <QMultiHash>
+#include <QString>
+#include <QVector>
+
+#include <array>
+
+// Finds items with the same or nearly the same description without
+// comparing pairs.
+//
+// Exact duplicates share a 64-bit hash of the normalized description. Near
+// duplicates are found with MinHash over the description trigrams: each
+// description gets a signature of SignatureSize minimums under different
+// hash functions, whose agreement estimates the Jaccard similarity of the
+// trigram sets. Signatures are cut into Bands bands that are hashed into
+// buckets (locality-sensitive hashing); only items sharing a bucket are
+// compared, and only by their signatures.
+//
+// Items with the same hash have the same signature, so only the first of
+// them goes into the buckets. A bucket can still fill up with many near
+// copies of one text; at most MaxBucketScan entries of it are compared.
+class DuplicateIndex
+{
+public:
+    static constexpr int SignatureSize = 64;
+    static constexpr int Bands = 8;
+    // Estimated similarity from which descriptions count as near duplicates.
+    static constexpr double Threshold = 0.8;
+    static constexpr int MaxBucketScan = 64;
+
+    struct Key
+    {
+        quint64 hash = 0; // 0 for an empty description
+        bool hasSignature = false; // false below three characters
+        std::array<quint32, SignatureSize> signature {};
+    };
+
+    static Key keyOf(const QString &description);
+    // What exact duplicates have in common.
+    static QString normalized(const QString &description);
+
+    void insert(quint32 id, const Key &key);
+    void insert(const DuplicateIndex &other);
+    void remove(quint32 id);
+    void clear();
+
+    // The first id with the same hash for which matches(id) holds, 0 if
+    // there is none; the predicate compares the descriptions.
+    template<typename Predicate>
+    quint32 exactDuplicate(const Key &key, Predicate matches) const;
+    // The most similar item at or above Threshold, 0 if there is none.
+    quint32 nearDuplicate(const Key &key) const;
+
+private:
+    static quint64 bandKey(const Key &key, int band);
+
+    void addToBuckets(quint32 id, const Key &key);
+    void removeFromBuckets(quint32 id, const Key &key);
+
+    QHash<quint32, Key> mKeys;
+    QMultiHash<quint64, quint32> mByHash;
+    QHash<quint64, quint32> mRepresentatives; // by hash, the id in the buckets
+    QMultiHash<quint64, quint32> mBuckets;
+};
+
+template<typename Predicate>
+quint32 DuplicateIndex::exactDuplicate(const Key &key, Predicate matches) const
+{
+    if (!key.hash)
+        return 0;
+
+    // Walks the ids in place; values() would copy all of them on every call.
+    const auto [first, last] = mByHash.equal_range(key.hash);
+    for (auto it = first; it != last; ++it) {
+        if (matches(it.value()))
+            return it.value();
+    }
+    return 0;
+}
+
+#endif // DUPLICATEINDEX_H
@@ -0,0 +1,397 @@
+#include "FuzzyMatcher.h"
+#include "ToDoList.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define TODO_FUZZY_SSE2
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int ChunkRows = 16384;
+
+// Scoring in the spirit of fzf v1: every matched character scores, matches
+// at word boundaries and runs of consecutive matches earn bonuses, gaps cost.
+constexpr int ScoreMatch = 16;
+constexpr int ScoreGapStart = -3;
+constexpr int ScoreGapExtension = -1;
+constexpr int BonusBoundary = 8;
+constexpr int BonusCamelCase = 7;
+constexpr int BonusConsecutive = 4;
+constexpr int BonusFirstCharMultiplier = 2;
+
+const char *findByte(const char *from, const char *end, char needle)
+{
+#ifdef TODO_FUZZY_SSE2
+    const __m128i pattern = _mm_set1_epi8(needle);
+    while (end - from >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+        if (mask)
+            return from + qCountTrailingZeroBits(quint32(mask));
+        from += 16;
+    }
+#endif
+    for (; from < end; ++from) {
+        if (*from == needle)
+            return from;
+    }
+    return nullptr;
+}
+
+bool isSubsequence(const char *text, const char *end, const QByteArray &query)
+{
+    for (const char c : query) {
+        text = findByte(text, end, c);
+        if (!text)
+            return false;
+        ++text;
+    }
+    return true;
+}
+
+int boundaryBonus(QChar previous, QChar current)
+{
+    if (previous.isNull() || (!previous.isLetterOrNumber() && current.isLetterOrNumber()))
+        return BonusBoundary;
+    if (previous.isLower() && current.isUpper())
+        return BonusCamelCase;
+    if (!previous.isDigit() && current.isDigit())
+        return BonusCamelCase;
+    return 0;
+}
+
+bool lessRelevant(const FuzzyMatch &a, const FuzzyMatch &b)
+{
+    if (a.score != b.score)
+        return a.score < b.score;
+    return a.row > b.row;
+}
+
+} // namespace
+
+void FuzzyMatcher::setItems(const QVector<ToDoItem> &items)
+{
+    mRowCount = items.size();
+
+    QVector<int> firstRows;
+    for (int row = 0; row < items.size(); row += ChunkRows)
+        firstRows.append(row);
+
+    mChunks = QtConcurrent::blockingMapped<QVector<Chunk>>(firstRows, [&items](int firstRow) {
+        return buildChunk(items, firstRow, std::min(ChunkRows, int(items.size()) - firstRow));
+    });
+}
+
+bool FuzzyMatcher::isEmpty() const
+{
+    return mRowCount == 0;
+}
+
+void FuzzyMatcher::insertItems(int row, const QVector<ToDoItem> &items)
+{
+    if (items.isEmpty())
+        return;
+
+    if (mChunks.isEmpty()) {
+        mChunks.append(Chunk());
+        mChunks.last().offsets.append(0);
+    }
+
+    const int index = chunkOf(row);
+    Chunk &chunk = mChunks[index];
+    const int at = row - chunk.firstRow;
+    QVector<quint32> ids = chunk.ids.mid(0, at);
+    QVector<QString> descriptions = chunk.descriptions.mid(0, at);
+    for (const ToDoItem &item : items) {
+        ids.append(item.id);
+        descriptions.append(item.description);
+    }
+    ids += chunk.ids.mid(at);
+    descriptions += chunk.descriptions.mid(at);
+    chunk.ids = ids;
+    chunk.descriptions = descriptions;
+    foldRows(chunk, at, items.size());
+
+    mRowCount += items.size();
+    splitChunk(index);
+    renumber(index);
+}
+
+void FuzzyMatcher::removeItems(int first, int last)
+{
+    int index = chunkOf(first);
+    const int firstChunk = index;
+    int at = first - mChunks.at(index).firstRow;
+    int count = last - first + 1;
+    mRowCount -= count;
+    while (count > 0 && index < mChunks.size()) {
+        Chunk &chunk = mChunks[index];
+        const int removed = std::min(count, int(chunk.ids.size()) - at);
+        unfoldRows(chunk, at, removed);
+        chunk.ids.remove(at, removed);
+        chunk.descriptions.remove(at, removed);
+        count -= removed;
+        at = 0;
+        if (chunk.ids.isEmpty())
+            mChunks.removeAt(index);
+        else
+            ++index;
+    }
+    renumber(firstChunk);
+}
+
+bool FuzzyMatcher::updateItem(int row, const ToDoItem &item)
+{
+    Chunk &chunk = mChunks[chunkOf(row)];
+    const int at = row - chunk.firstRow;
+    chunk.ids[at] = item.id;
+    if (chunk.descriptions.at(at) == item.description)
+        return false;
+
+    unfoldRows(chunk, at, 1);
+    chunk.descriptions[at] = item.description;
+    foldRows(chunk, at, 1);
+    return true;
+}
+
+QVector<FuzzyMatch> FuzzyMatcher::match(const QString &query, int limit) const
+{
+    const QString trimmed = query.trimmed();
+    if (trimmed.isEmpty() || limit <= 0)
+        return {};
+
+    const QString foldedQuery = trimmed.toCaseFolded();
+    QByteArray queryBytes;
+    quint64 queryMask = 0;
+    for (const QChar c : foldedQuery) {
+        if (c.isSpace())
+            continue;
+        queryBytes.append(foldByte(c));
+        queryMask |= maskBit(queryBytes.back());
+    }
+
+    const QVector<QVector<FuzzyMatch>> partial = QtConcurrent::blockingMapped<QVector<QVector<FuzzyMatch>>>(
+        mChunks, [&](const Chunk &chunk) {
+            return matchChunk(chunk, foldedQuery, queryBytes, queryMask, limit);
+        });
+
+    QVector<FuzzyMatch> matches;
+    for (const QVector<FuzzyMatch> &chunkMatches : partial)
+        matches += chunkMatches;
+
+    const int count = std::min(limit, int(matches.size()));
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(),
+                      [](const FuzzyMatch &a, const FuzzyMatch &b) { return lessRelevant(b, a); });
+    matches.resize(count);
+    return matches;
+}
+
+bool FuzzyMatcher::score(const QString &text, const QString &foldedQuery, FuzzyMatch *match)
+{
+    QString pattern = foldedQuery;
+    pattern.remove(QLatin1Char(' '));
+    if (pattern.isEmpty())
+        return false;
+
+    // Forward pass: the earliest position where the whole pattern has been
+    // seen.
+    int p = 0;
+    int end = -1;
+    for (int i = 0; i < text.size(); ++i) {
+        if (text.at(i).toCaseFolded() == pattern.at(p) && ++p == pattern.size()) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0)
+        return false;
+
+    // Backward pass: the latest start that still matches, i.e. the shortest
+    // window ending at end.
+    int start = end;
+    p = pattern.size() - 1;
+    for (int i = end; i >= 0; --i) {
+        if (text.at(i).toCaseFolded() == pattern.at(p)) {
+            start = i;
+            if (--p < 0)
+                break;
+        }
+    }
+
+    int score = 0;
+    int consecutive = 0;
+    bool inGap = false;
+    p = 0;
+    match->positions.clear();
+    for (int i = start; i <= end && p < pattern.size(); ++i) {
+        if (text.at(i).toCaseFolded() == pattern.at(p)) {
+            int bonus = boundaryBonus(i > 0 ? text.at(i - 1) : QChar(), text.at(i));
+            if (consecutive > 0)
+                bonus = std::max(bonus, BonusConsecutive);
+            if (p == 0)
+                bonus *= BonusFirstCharMultiplier;
+            score += ScoreMatch + bonus;
+            match->positions.append(i);
+            ++consecutive;
+            inGap = false;
+            ++p;
+        } else {
+            score += inGap ? ScoreGapExtension : ScoreGapStart;
+            consecutive = 0;
+            inGap = true;
+        }
+    }
+
+    match->score = score;
+    return true;
+}
+
+char FuzzyMatcher::foldByte(QChar c)
+{
+    // Non-ASCII characters collapse into one byte: the prefilter can then
+    // only let too many rows through, never reject a match.
+    const char16_t folded = c.toCaseFolded().unicode();
+    return folded < 0x80 ? char(folded) : char(0x80);
+}
+
+quint64 FuzzyMatcher::maskBit(char c)
+{
+    const uchar u = uchar(c);
+    if (u >= 'a' && u <= 'z')
+        return quint64(1) << (u - 'a');
+    if (u >= '0' && u <= '9')
+        return quint64(1) << (26 + u - '0');
+    return quint64(1) << (36 + u % 28);
+}
+
+FuzzyMatcher::Chunk FuzzyMatcher::buildChunk(const QVector<ToDoItem> &items, int firstRow, int rowCount)
+{
+    Chunk chunk;
+    chunk.firstRow = firstRow;
+    chunk.ids.reserve(rowCount);
+    chunk.descriptions.reserve(rowCount);
+    for (int row = firstRow; row < firstRow + rowCount; ++row) {
+        chunk.ids.append(items.at(row).id);
+        chunk.descriptions.append(items.at(row).description);
+    }
+    chunk.offsets.append(0);
+    foldRows(chunk, 0, rowCount);
+    return chunk;
+}
+
+void FuzzyMatcher::foldRows(Chunk &chunk, int first, int count)
+{
+    // The descriptions are in already; their folded bytes, offsets and
+    // masks go in before those of row first.
+    QByteArray folded;
+    QVector<int> offsets;
+    QVector<quint64> masks;
+    offsets.reserve(count);
+    masks.reserve(count);
+    const int start = chunk.offsets.at(first);
+    for (int row = first; row < first + count; ++row) {
+        offsets.append(start + folded.size());
+        quint64 mask = 0;
+        for (const QChar c : chunk.descriptions.at(row)) {
+            const char byte = foldByte(c);
+            folded.append(byte);
+            mask |= maskBit(byte);
+        }
+        masks.append(mask);
+    }
+
+    chunk.folded.insert(start, folded);
+    for (int i = first; i < chunk.offsets.size(); ++i)
+        chunk.offsets[i] += folded.size();
+    chunk.offsets.insert(first, count, 0);
+    std::copy(offsets.cbegin(), offsets.cend(), chunk.offsets.begin() + first);
+    chunk.masks.insert(first, count, 0);
+    std::copy(masks.cbegin(), masks.cend(), chunk.masks.begin() + first);
+}
+
+void FuzzyMatcher::unfoldRows(Chunk &chunk, int first, int count)
+{
+    const int start = chunk.offsets.at(first);
+    const int length = chunk.offsets.at(first + count) - start;
+    chunk.folded.remove(start, length);
+    chunk.offsets.remove(first, count);
+    for (int i = first; i < chunk.offsets.size(); ++i)
+        chunk.offsets[i] -= length;
+    chunk.masks.remove(first, count);
+}
+
+int FuzzyMatcher::chunkOf(int row) const
+{
+    // The last chunk whose first row is at or before row; appending goes
+    // into the last chunk.
+    const auto after = std::upper_bound(mChunks.cbegin(), mChunks.cend(), row, [](int row, const Chunk &chunk) {
+        return row < chunk.firstRow;
+    });
+    return std::max(0, int(after - mChunks.cbegin()) - 1);
+}
+
+void FuzzyMatcher::splitChunk(int index)
+{
+    // Chunks that grew to twice their size are cut back into full ones, so
+    // matching stays spread over the cores.
+    if (mChunks.at(index).ids.size() < 2 * ChunkRows)
+        return;
+
+    const Chunk chunk = mChunks.takeAt(index);
+    QVector<Chunk> pieces;
+    for (int first = 0; first < chunk.ids.size(); first += ChunkRows) {
+        Chunk piece;
+        piece.ids = chunk.ids.mid(first, ChunkRows);
+        piece.descriptions = chunk.descriptions.mid(first, ChunkRows);
+        piece.offsets.append(0);
+        foldRows(piece, 0, piece.ids.size());
+        pieces.append(piece);
+    }
+    for (int i = 0; i < pieces.size(); ++i)
+        mChunks.insert(index + i, pieces.at(i));
+}
+
+void FuzzyMatcher::renumber(int fromChunk)
+{
+    for (int i = std::max(fromChunk, 0); i < mChunks.size(); ++i)
+        mChunks[i].firstRow = i == 0 ? 0 : mChunks.at(i - 1).firstRow + mChunks.at(i - 1).ids.size();
+}
+
+QVector<FuzzyMatch> FuzzyMatcher::matchChunk(const Chunk &chunk, const QString &foldedQuery,
+                                             const QByteArray &queryBytes, quint64 queryMask,
+                                             int limit) const
+{
+    // Keeps the best limit matches of the chunk as a min-heap on relevance.
+    const auto moreRelevant = [](const FuzzyMatch &a, const FuzzyMatch &b) { return lessRelevant(b, a); };
+
+    QVector<FuzzyMatch> best;
+    const char *data = chunk.folded.constData();
+    for (int i = 0; i < chunk.masks.size(); ++i) {
+        if ((chunk.masks.at(i) & queryMask) != queryMask)
+            continue;
+        if (!isSubsequence(data + chunk.offsets.at(i), data + chunk.offsets.at(i + 1), queryBytes))
+            continue;
+
+        FuzzyMatch match;
+        match.row = chunk.firstRow + i;
+        match.id = chunk.ids.at(i);
+        if (!score(chunk.descriptions.at(i), foldedQuery, &match))
+            continue;
+
+        if (best.size() < limit) {
+            best.append(match);
+            std::push_heap(best.begin(), best.end(), moreRelevant);
+        } else if (lessRelevant(best.first(), match)) {
+            std::pop_heap(best.begin(), best.end(), moreRelevant);
+            best.last() = match;
+            std::push_heap(best.begin(), best.end(), moreRelevant);
+        }
+    }
+    return best;
+}
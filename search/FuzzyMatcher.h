@@ -0,0 +1,72 @@
+#ifndef FUZZYMATCHER_H
+#define FUZZYMATCHER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+struct ToDoItem;
+
+struct FuzzyMatch
+{
+    int row = -1;
+    quint32 id = 0;
+    int score = 0;
+    QVector<int> positions; // indexes into the description
+};
+
+// fzf-style fuzzy subsequence matcher over a snapshot of item descriptions.
+//
+// The snapshot keeps a case-folded one-byte-per-character copy of every
+// description plus a 64-bit mask of the characters it contains. A row is
+// rejected when the query characters are missing from its mask, or when an
+// SSE2 scan of its folded bytes cannot find them in order; only the rows
+// left are scored. Chunks of rows are matched in parallel and reduced to the
+// best matches.
+//
+// Rows follow the list: inserting, removing or changing items only folds
+// the chunks they fall in again.
+class FuzzyMatcher
+{
+public:
+    void setItems(const QVector<ToDoItem> &items);
+    bool isEmpty() const;
+
+    // items go in before row.
+    void insertItems(int row, const QVector<ToDoItem> &items);
+    void removeItems(int first, int last);
+    // Returns false when the description, all that is matched, is the same.
+    bool updateItem(int row, const ToDoItem &item);
+
+    QVector<FuzzyMatch> match(const QString &query, int limit) const;
+
+    // Scores a single text; returns false when query is not a subsequence.
+    static bool score(const QString &text, const QString &foldedQuery, FuzzyMatch *match);
+
+private:
+    struct Chunk
+    {
+        int firstRow = 0;
+        QVector<quint32> ids;
+        QVector<QString> descriptions;
+        QByteArray folded;
+        QVector<int> offsets; // offsets.size() == rows + 1
+        QVector<quint64> masks;
+    };
+
+    static char foldByte(QChar c);
+    static quint64 maskBit(char c);
+    static Chunk buildChunk(const QVector<ToDoItem> &items, int firstRow, int rowCount);
+    static void foldRows(Chunk &chunk, int first, int count);
+    static void unfoldRows(Chunk &chunk, int first, int count);
+    int chunkOf(int row) const;
+    void splitChunk(int index);
+    void renumber(int fromChunk);
+    QVector<FuzzyMatch> matchChunk(const Chunk &chunk, const QString &foldedQuery,
+                                   const QByteArray &queryBytes, quint64 queryMask, int limit) const;
+
+    int mRowCount = 0;
+    QVector<Chunk> mChunks;
+};
+
+#endif // FUZZYMATCHER_H
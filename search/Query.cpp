@@ -0,0 +1,408 @@
+#include "Query.h"
+#include "ToDoList.h"
+
+#include <QStringList>
+
+#include <algorithm>
+
+namespace {
+
+// Deepest nesting of parentheses and "not" the parser recurses into.
+constexpr int MaxDepth = 64;
+
+struct Token
+{
+    enum Type { Word, String, Operator, End };
+
+    Type type = End;
+    QString text;
+    int position = 0;
+};
+
+QVector<Token> tokenize(const QString &text, QString *error)
+{
+    QVector<Token> tokens;
+    int i = 0;
+    while (i < text.size()) {
+        const QChar c = text.at(i);
+        if (c.isSpace()) {
+            ++i;
+            continue;
+        }
+
+        Token token;
+        token.position = i;
+        if (c == u'"') {
+            token.type = Token::String;
+            ++i;
+            while (i < text.size() && text.at(i) != u'"') {
+                if (text.at(i) == u'\\' && i + 1 < text.size())
+                    ++i;
+                token.text.append(text.at(i++));
+            }
+            if (i >= text.size()) {
+                *error = QStringLiteral("Unterminated string at %1").arg(token.position);
+                return {};
+            }
+            ++i;
+        } else if (c.isLetterOrNumber() || c == u'_') {
+            token.type = Token::Word;
+            while (i < text.size() && (text.at(i).isLetterOrNumber() || text.at(i) == u'_'
+                                       || text.at(i) == u'-' || text.at(i) == u'.'))
+                token.text.append(text.at(i++));
+        } else {
+            token.type = Token::Operator;
+            const QString pair = text.mid(i, 2);
+            if (pair == QLatin1String("!=") || pair == QLatin1String("&&")
+                || pair == QLatin1String("||")) {
+                token.text = pair;
+                i += 2;
+            } else if (QStringLiteral("=~():!").contains(c)) {
+                token.text = c;
+                ++i;
+            } else {
+                *error = QStringLiteral("Unexpected '%1' at %2").arg(c).arg(i);
+                return {};
+            }
+        }
+        tokens.append(token);
+    }
+
+    Token end;
+    end.position = text.size();
+    tokens.append(end);
+    return tokens;
+}
+
+class Parser
+{
+public:
+    explicit Parser(const QVector<Token> &tokens) : mTokens(tokens) {}
+
+    QSharedPointer<const Query::Node> parse(QString *error)
+    {
+        QSharedPointer<const Query::Node> node = parseOr();
+        if (node && peek().type != Token::End)
+            fail(QStringLiteral("Unexpected '%1'").arg(peek().text));
+        if (!mError.isEmpty()) {
+            *error = mError;
+            return {};
+        }
+        return node;
+    }
+
+private:
+    using NodePointer = QSharedPointer<const Query::Node>;
+
+    const Token &peek() const { return mTokens.at(mPosition); }
+    const Token &next() { return mTokens.at(mPosition < mTokens.size() - 1 ? mPosition++ : mPosition); }
+
+    bool isKeyword(const char *keyword) const
+    {
+        return peek().type == Token::Word && peek().text.compare(QLatin1String(keyword), Qt::CaseInsensitive) == 0;
+    }
+    bool isOperator(const char *op) const
+    {
+        return peek().type == Token::Operator && peek().text == QLatin1String(op);
+    }
+
+    NodePointer fail(const QString &message)
+    {
+        if (mError.isEmpty())
+            mError = QStringLiteral("%1 at %2").arg(message).arg(peek().position);
+        return {};
+    }
+
+    NodePointer combine(Query::Node::Type type, const QVector<NodePointer> &children)
+    {
+        if (children.size() == 1)
+            return children.first();
+        auto node = QSharedPointer<Query::Node>::create();
+        node->type = type;
+        node->children = children;
+        return node;
+    }
+
+    NodePointer parseOr()
+    {
+        QVector<NodePointer> children;
+        for (;;) {
+            NodePointer child = parseAnd();
+            if (!child)
+                return {};
+            children.append(child);
+            if (!isKeyword("or") && !isOperator("||"))
+                break;
+            next();
+        }
+        return combine(Query::Node::Or, children);
+    }
+
+    NodePointer parseAnd()
+    {
+        QVector<NodePointer> children;
+        for (;;) {
+            NodePointer child = parseUnary();
+            if (!child)
+                return {};
+            children.append(child);
+            if (!isKeyword("and") && !isOperator("&&"))
+                break;
+            next();
+        }
+        return combine(Query::Node::And, children);
+    }
+
+    NodePointer parseUnary()
+    {
+        if (isKeyword("not") || isOperator("!")) {
+            next();
+            if (++mDepth > MaxDepth)
+                return fail(QStringLiteral("Expression nested too deeply"));
+            NodePointer child = parseUnary();
+            if (!child)
+                return {};
+            --mDepth;
+            auto node = QSharedPointer<Query::Node>::create();
+            node->type = Query::Node::Not;
+            node->children.append(child);
+            return node;
+        }
+
+        if (isOperator("(")) {
+            next();
+            if (++mDepth > MaxDepth)
+                return fail(QStringLiteral("Expression nested too deeply"));
+            NodePointer node = parseOr();
+            if (!node)
+                return {};
+            if (!isOperator(")"))
+                return fail(QStringLiteral("Expected ')'"));
+            next();
+            --mDepth;
+            return node;
+        }
+
+        return parseTerm();
+    }
+
+    NodePointer parseTerm()
+    {
+        const Token token = next();
+        auto node = QSharedPointer<Query::Node>::create();
+
+        if (token.type == Token::String) {
+            node->type = Query::Node::Contains;
+            node->text = token.text;
+            return node;
+        }
+        if (token.type != Token::Word)
+            return fail(QStringLiteral("Expected a term"));
+
+        const QString field = token.text.toLower();
+        if (field == QLatin1String("done")) {
+            node->type = Query::Node::Done;
+            if (isOperator("=") || isOperator("!=")) {
+                const bool negate = next().text == QLatin1String("!=");
+                if (isKeyword("true"))
+                    node->value = true;
+                else if (isKeyword("false"))
+                    node->value = false;
+                else
+                    return fail(QStringLiteral("Expected true or false"));
+                next();
+                node->value = node->value != negate;
+            }
+            return node;
+        }
+
+        if (field == QLatin1String("tag")) {
+            if (!isOperator(":") && !isOperator("="))
+                return fail(QStringLiteral("Expected ':' after tag"));
+            next();
+            const Token name = next();
+            if (name.type != Token::Word && name.type != Token::String)
+                return fail(QStringLiteral("Expected a tag name"));
+            node->type = Query::Node::Tag;
+            node->text = name.text;
+            return node;
+        }
+
+        if (field == QLatin1String("field")) {
+            if (!isOperator(":"))
+                return fail(QStringLiteral("Expected ':' after field"));
+            next();
+            const Token name = next();
+            if (name.type != Token::Word && name.type != Token::String)
+                return fail(QStringLiteral("Expected a field name"));
+            node->field = name.text;
+            node->type = Query::Node::HasField;
+            if (!isOperator("~") && !isOperator("=") && !isOperator("!="))
+                return node;
+
+            const QString op = next().text;
+            const Token value = next();
+            if (value.type != Token::String && value.type != Token::Word)
+                return fail(QStringLiteral("Expected a value for field %1").arg(name.text));
+            node->text = value.text;
+            node->type = op == QLatin1String("~") ? Query::Node::FieldContains : Query::Node::FieldEquals;
+            if (op == QLatin1String("!=")) {
+                auto negated = QSharedPointer<Query::Node>::create();
+                negated->type = Query::Node::Not;
+                negated->children.append(node);
+                return negated;
+            }
+            return node;
+        }
+
+        if (field == QLatin1String("description")) {
+            const QString op = peek().type == Token::Operator ? next().text : QString();
+            const Token value = next();
+            if (value.type != Token::String && value.type != Token::Word)
+                return fail(QStringLiteral("Expected a value for description"));
+            node->text = value.text;
+            if (op == QLatin1String("~")) {
+                node->type = Query::Node::Contains;
+            } else if (op == QLatin1String("=") || op == QLatin1String("!=")) {
+                node->type = Query::Node::Equals;
+                if (op == QLatin1String("!=")) {
+                    auto negated = QSharedPointer<Query::Node>::create();
+                    negated->type = Query::Node::Not;
+                    negated->children.append(node);
+                    return negated;
+                }
+            } else {
+                return fail(QStringLiteral("Expected '~', '=' or '!=' after description"));
+            }
+            return node;
+        }
+
+        // A bare word searches the description.
+        node->type = Query::Node::Contains;
+        node->text = token.text;
+        return node;
+    }
+
+    QVector<Token> mTokens;
+    int mPosition = 0;
+    int mDepth = 0;
+    QString mError;
+};
+
+} // namespace
+
+Query Query::parse(const QString &text)
+{
+    Query query;
+    query.mText = text;
+
+    if (text.trimmed().isEmpty())
+        return query;
+
+    const QVector<Token> tokens = tokenize(text, &query.mError);
+    if (!query.mError.isEmpty())
+        return query;
+
+    query.mRoot = Parser(tokens).parse(&query.mError);
+    return query;
+}
+
+bool Query::isValid() const
+{
+    return mError.isEmpty();
+}
+
+QString Query::errorString() const
+{
+    return mError;
+}
+
+QString Query::text() const
+{
+    return mText;
+}
+
+QSharedPointer<const Query::Node> Query::root() const
+{
+    return mRoot;
+}
+
+bool Query::matches(const ToDoItem &item, const ToDoList &list) const
+{
+    // An empty query matches everything, an invalid one nothing.
+    if (!mRoot)
+        return isValid();
+    return matches(*mRoot, item, list);
+}
+
+bool Query::matches(const Node &node, const ToDoItem &item, const ToDoList &list)
+{
+    switch (node.type) {
+    case Node::And:
+        return std::all_of(node.children.cbegin(), node.children.cend(), [&](const auto &child) {
+            return matches(*child, item, list);
+        });
+    case Node::Or:
+        return std::any_of(node.children.cbegin(), node.children.cend(), [&](const auto &child) {
+            return matches(*child, item, list);
+        });
+    case Node::Not:
+        return !matches(*node.children.first(), item, list);
+    case Node::Done:
+        return item.done == node.value;
+    case Node::Contains:
+        return item.description.contains(node.text, Qt::CaseInsensitive);
+    case Node::Equals:
+        return item.description == node.text;
+    case Node::Tag: {
+        const quint32 tag = list.tagId(node.text);
+        return tag && std::binary_search(item.tags.cbegin(), item.tags.cend(), tag);
+    }
+    case Node::HasField:
+        return list.customFields().ids(node.field).contains(item.id);
+    case Node::FieldEquals: {
+        const QVariant value = list.customFields().value(item.id, node.field);
+        return value.isValid() && value.toString() == node.text;
+    }
+    case Node::FieldContains:
+        return list.customFields().value(item.id, node.field).toString().contains(node.text, Qt::CaseInsensitive);
+    }
+    return false;
+}
+
+QString Query::toString(const Node &node)
+{
+    // Backslashes first, so the ones escaping quotes are not doubled.
+    const auto quoted = [](QString text) {
+        text.replace(QStringLiteral("\\"), QStringLiteral("\\\\"));
+        return QStringLiteral("\"%1\"").arg(text.replace(QStringLiteral("\""), QStringLiteral("\\\"")));
+    };
+
+    switch (node.type) {
+    case Node::And:
+    case Node::Or: {
+        QStringList parts;
+        for (const auto &child : node.children)
+            parts.append(toString(*child));
+        return QStringLiteral("(%1)").arg(parts.join(node.type == Node::And ? QStringLiteral(" and ")
+                                                                            : QStringLiteral(" or ")));
+    }
+    case Node::Not:
+        return QStringLiteral("not %1").arg(toString(*node.children.first()));
+    case Node::Done:
+        return node.value ? QStringLiteral("done = true") : QStringLiteral("done = false");
+    case Node::Contains:
+        return QStringLiteral("description ~ %1").arg(quoted(node.text));
+    case Node::Equals:
+        return QStringLiteral("description = %1").arg(quoted(node.text));
+    case Node::Tag:
+        return QStringLiteral("tag:%1").arg(quoted(node.text));
+    case Node::HasField:
+        return QStringLiteral("field:%1").arg(quoted(node.field));
+    case Node::FieldEquals:
+        return QStringLiteral("field:%1 = %2").arg(quoted(node.field), quoted(node.text));
+    case Node::FieldContains:
+        return QStringLiteral("field:%1 ~ %2").arg(quoted(node.field), quoted(node.text));
+    }
+    return QString();
+}
@@ -0,0 +1,68 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+struct ToDoItem;
+class ToDoList;
+
+// Parsed filter expression over items, e.g.
+//
+//   done = false and description ~ "sink" and not tag:home
+//
+// Terms are "done" (optionally "= true/false" or "!="), "description" with
+// "~" (case-insensitive substring), "=" or "!=", "tag:name", "field:name"
+// for items that have a custom field, optionally followed by "~", "=" or
+// "!=" and a value compared with the field as text, and bare words, which
+// search the description. Terms combine with and/or/not (also &&, ||, !)
+// and parentheses.
+class Query
+{
+public:
+    struct Node
+    {
+        enum Type {
+            And,
+            Or,
+            Not,
+            Done,          // value
+            Contains,      // text, case-insensitive substring of the description
+            Equals,        // text, whole description
+            Tag,           // text, tag name
+            HasField,      // field, custom field name
+            FieldEquals,   // field, text, whole value
+            FieldContains  // field, text, case-insensitive substring of the value
+        };
+
+        Type type = And;
+        bool value = true;
+        QString text;
+        QString field;
+        QVector<QSharedPointer<const Node>> children;
+    };
+
+    Query() = default;
+
+    static Query parse(const QString &text);
+
+    bool isValid() const;
+    QString errorString() const;
+    QString text() const;
+
+    QSharedPointer<const Node> root() const;
+
+    // Evaluates the expression on a single item, without any index.
+    bool matches(const ToDoItem &item, const ToDoList &list) const;
+    static bool matches(const Node &node, const ToDoItem &item, const ToDoList &list);
+
+    static QString toString(const Node &node);
+
+private:
+    QString mText;
+    QString mError;
+    QSharedPointer<const Node> mRoot;
+};
+
+#endif // QUERY_H
@@ -0,0 +1,433 @@
+#include "QueryPlan.h"
+#include "ToDoList.h"
+#include "Trigrams.h"
+
+#include <QStringList>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+using Step = QueryPlan::Step;
+using StepPointer = QSharedPointer<Step>;
+
+// Relative costs per row: combining bitmaps works on 64 rows per word,
+// verifying a predicate means looking at the item itself.
+constexpr double BitmapCost = 1.0 / 64;
+constexpr double VerifyCost = 4.0;
+constexpr int ScanBlock = 1024;
+
+StepPointer makeStep(Step::Operator op, double rows, double cost)
+{
+    auto step = StepPointer::create();
+    step->op = op;
+    step->rows = rows;
+    step->cost = cost;
+    return step;
+}
+
+bool isIndexed(const Step &step)
+{
+    return step.op != Step::AllItems && step.op != Step::Filter && step.op != Step::Subtract;
+}
+
+// Index lookups whose candidates still have to be verified on the items.
+bool isVerified(const Step &step)
+{
+    return step.op == Step::TextIndex || (step.op == Step::FieldIndex && step.predicate);
+}
+
+bool isFullScan(const Step &step)
+{
+    return step.op == Step::Filter && step.children.first()->op == Step::AllItems;
+}
+
+class Planner
+{
+public:
+    explicit Planner(const ToDoList &list)
+        : mList(list)
+        , mLiveRows(double(list.liveIds().cardinality()))
+    {
+    }
+
+    StepPointer plan(const QSharedPointer<const Query::Node> &node)
+    {
+        switch (node->type) {
+        case Query::Node::Done: {
+            const double done = double(mList.doneIds().cardinality());
+            const double rows = node->value ? done : mLiveRows - done;
+            auto step = makeStep(Step::DoneIndex, rows, node->value ? done * BitmapCost : mLiveRows * BitmapCost);
+            step->value = node->value;
+            return step;
+        }
+        case Query::Node::Tag: {
+            const quint32 tag = mList.tagId(node->text);
+            if (!tag)
+                return makeStep(Step::Empty, 0, 0);
+            const double rows = double(mList.tagIndex().bitmap(tag).cardinality());
+            auto step = makeStep(Step::TagIndex, rows, rows * BitmapCost);
+            step->tag = tag;
+            return step;
+        }
+        case Query::Node::Contains:
+        case Query::Node::Equals:
+            return planText(node);
+        case Query::Node::HasField:
+        case Query::Node::FieldEquals:
+        case Query::Node::FieldContains: {
+            const double rows = double(mList.customFields().ids(node->field).cardinality());
+            if (rows == 0)
+                return makeStep(Step::Empty, 0, 0);
+            const bool verify = node->type != Query::Node::HasField;
+            auto step = makeStep(Step::FieldIndex, rows, rows * (verify ? VerifyCost : BitmapCost));
+            step->field = node->field;
+            if (verify)
+                step->predicate = node;
+            return step;
+        }
+        case Query::Node::Not: {
+            StepPointer inner = plan(node->children.first());
+            if (!isIndexed(*inner))
+                return scan(node);
+            auto step = makeStep(Step::Subtract, std::max(0.0, mLiveRows - inner->rows),
+                                 inner->cost + mLiveRows * BitmapCost);
+            step->children << makeStep(Step::AllItems, mLiveRows, 0) << inner;
+            return step;
+        }
+        case Query::Node::Or:
+            return planOr(node);
+        case Query::Node::And:
+            return planAnd(node);
+        }
+        return makeStep(Step::Empty, 0, 0);
+    }
+
+private:
+    StepPointer scan(const QSharedPointer<const Query::Node> &node)
+    {
+        // Without any estimate assume half of the rows survive.
+        auto step = makeStep(Step::Filter, mLiveRows / 2, mLiveRows * VerifyCost);
+        step->predicate = node;
+        step->children << makeStep(Step::AllItems, mLiveRows, 0);
+        return step;
+    }
+
+    StepPointer planText(const QSharedPointer<const Query::Node> &node)
+    {
+        const QVector<quint32> trigrams = Trigrams::of(node->text);
+        if (trigrams.isEmpty())
+            return scan(node);
+
+        // The rarest trigram bounds the number of candidates to verify.
+        double candidates = mLiveRows;
+        double postings = 0;
+        for (const quint32 trigram : trigrams) {
+            const double size = double(mList.textIndex().bitmap(trigram).cardinality());
+            candidates = std::min(candidates, size);
+            postings += size;
+        }
+        if (candidates == 0)
+            return makeStep(Step::Empty, 0, 0);
+
+        auto step = makeStep(Step::TextIndex, candidates, postings * BitmapCost + candidates * VerifyCost);
+        step->trigrams = trigrams;
+        step->predicate = node;
+        return step;
+    }
+
+    StepPointer planOr(const QSharedPointer<const Query::Node> &node)
+    {
+        // One branch that needs a full scan makes a single scan of the whole
+        // disjunction cheaper than scanning and uniting.
+        auto step = makeStep(Step::Unite, 0, 0);
+        for (const auto &child : node->children) {
+            StepPointer childStep = plan(child);
+            if (isFullScan(*childStep))
+                return scan(node);
+            if (childStep->op == Step::Empty)
+                continue;
+            step->rows += childStep->rows;
+            step->cost += childStep->cost + childStep->rows * BitmapCost;
+            step->children.append(childStep);
+        }
+        if (step->children.isEmpty())
+            return makeStep(Step::Empty, 0, 0);
+        if (step->children.size() == 1)
+            return step->children.first();
+        step->rows = std::min(step->rows, mLiveRows);
+        return step;
+    }
+
+    StepPointer planAnd(const QSharedPointer<const Query::Node> &node)
+    {
+        QVector<StepPointer> drivers;
+        QVector<StepPointer> excluded;
+        QVector<QSharedPointer<const Query::Node>> residual;
+
+        for (const auto &child : node->children) {
+            if (child->type == Query::Node::Not) {
+                StepPointer inner = plan(child->children.first());
+                if (inner->op == Step::Empty)
+                    continue;
+                if (isIndexed(*inner))
+                    excluded.append(inner);
+                else
+                    residual.append(child);
+                continue;
+            }
+
+            StepPointer childStep = plan(child);
+            if (childStep->op == Step::Empty)
+                return childStep;
+            if (isFullScan(*childStep))
+                residual.append(child);
+            else
+                drivers.append(childStep);
+        }
+
+        std::sort(drivers.begin(), drivers.end(), [](const StepPointer &a, const StepPointer &b) {
+            return a->rows < b->rows;
+        });
+
+        // Trigram and field lookups pay for verifying their candidates. Once
+        // a cheaper driver has narrowed the set down, verifying directly on
+        // that set is cheaper than intersecting with the lookup.
+        double rows = mLiveRows;
+        for (const StepPointer &driver : drivers) {
+            if (!isVerified(*driver))
+                rows = std::min(rows, driver->rows);
+        }
+        for (int i = drivers.size() - 1; i >= 0; --i) {
+            if (isVerified(*drivers.at(i)) && drivers.size() > 1
+                && drivers.at(i)->cost > rows * VerifyCost) {
+                residual.append(drivers.at(i)->predicate);
+                drivers.removeAt(i);
+            }
+        }
+
+        StepPointer step;
+        if (drivers.isEmpty()) {
+            step = makeStep(Step::AllItems, mLiveRows, 0);
+        } else if (drivers.size() == 1) {
+            step = drivers.first();
+        } else {
+            step = makeStep(Step::Intersect, drivers.first()->rows, 0);
+            for (const StepPointer &driver : drivers)
+                step->cost += driver->cost + driver->rows * BitmapCost;
+            step->children = drivers;
+        }
+
+        if (!excluded.isEmpty()) {
+            auto subtract = makeStep(Step::Subtract, step->rows, step->cost + step->rows * BitmapCost);
+            subtract->children.append(step);
+            for (const StepPointer &exclude : excluded) {
+                subtract->cost += exclude->cost;
+                subtract->rows = std::max(0.0, subtract->rows - exclude->rows * step->rows / std::max(mLiveRows, 1.0));
+            }
+            subtract->children += excluded;
+            step = subtract;
+        }
+
+        if (!residual.isEmpty()) {
+            auto predicate = QSharedPointer<Query::Node>::create();
+            predicate->type = Query::Node::And;
+            predicate->children = residual;
+            auto filter = makeStep(Step::Filter, step->rows / 2, step->cost + step->rows * VerifyCost);
+            filter->predicate = residual.size() == 1 ? residual.first()
+                                                     : QSharedPointer<const Query::Node>(predicate);
+            filter->children.append(step);
+            step = filter;
+        }
+
+        return step;
+    }
+
+    const ToDoList &mList;
+    double mLiveRows;
+};
+
+RoaringBitmap verify(const RoaringBitmap &candidates, const Query::Node &predicate,
+                     const QVector<ToDoItem> &items, const ToDoList &list)
+{
+    RoaringBitmap result;
+    candidates.forEach([&](quint32 id) {
+        const int index = list.indexOfId(id);
+        if (index >= 0 && Query::matches(predicate, items.at(index), list))
+            result.add(id);
+    });
+    return result;
+}
+
+RoaringBitmap blockScan(const Query::Node &predicate, const QVector<ToDoItem> &items, const ToDoList &list)
+{
+    // Evaluate a block of rows into a match mask first, then emit the ids of
+    // the set bits, which keeps the bitmap appends out of the predicate loop.
+    RoaringBitmap result;
+    quint64 mask[ScanBlock / 64];
+    for (int first = 0; first < items.size(); first += ScanBlock) {
+        const int count = std::min(ScanBlock, int(items.size()) - first);
+        std::fill(std::begin(mask), std::end(mask), 0);
+        for (int i = 0; i < count; ++i) {
+            if (Query::matches(predicate, items.at(first + i), list))
+                mask[i / 64] |= quint64(1) << (i % 64);
+        }
+        for (int w = 0; w < (count + 63) / 64; ++w) {
+            for (quint64 word = mask[w]; word; word &= word - 1)
+                result.add(items.at(first + w * 64 + qCountTrailingZeroBits(word)).id);
+        }
+    }
+    return result;
+}
+
+RoaringBitmap run(const Step &step, const QVector<ToDoItem> &items, const ToDoList &list)
+{
+    switch (step.op) {
+    case Step::Empty:
+        return RoaringBitmap();
+    case Step::AllItems:
+        return list.liveIds();
+    case Step::DoneIndex:
+        return step.value ? list.doneIds() : list.liveIds().andNot(list.doneIds());
+    case Step::TagIndex:
+        return list.tagIndex().bitmap(step.tag);
+    case Step::TextIndex: {
+        QVector<const RoaringBitmap *> postings;
+        for (const quint32 trigram : step.trigrams)
+            postings.append(&list.textIndex().bitmap(trigram));
+        std::sort(postings.begin(), postings.end(), [](const RoaringBitmap *a, const RoaringBitmap *b) {
+            return a->cardinality() < b->cardinality();
+        });
+        RoaringBitmap candidates = *postings.first();
+        for (int i = 1; i < postings.size() && !candidates.isEmpty(); ++i)
+            candidates = candidates & *postings.at(i);
+        return verify(candidates, *step.predicate, items, list);
+    }
+    case Step::FieldIndex:
+        if (!step.predicate)
+            return list.customFields().ids(step.field);
+        return verify(list.customFields().ids(step.field), *step.predicate, items, list);
+    case Step::Intersect: {
+        RoaringBitmap result = run(*step.children.first(), items, list);
+        for (int i = 1; i < step.children.size() && !result.isEmpty(); ++i)
+            result = result & run(*step.children.at(i), items, list);
+        return result;
+    }
+    case Step::Unite: {
+        RoaringBitmap result;
+        for (const auto &child : step.children)
+            result = result | run(*child, items, list);
+        return result;
+    }
+    case Step::Subtract: {
+        RoaringBitmap result = run(*step.children.first(), items, list);
+        for (int i = 1; i < step.children.size() && !result.isEmpty(); ++i)
+            result = result.andNot(run(*step.children.at(i), items, list));
+        return result;
+    }
+    case Step::Filter:
+        if (isFullScan(step))
+            return blockScan(*step.predicate, items, list);
+        return verify(run(*step.children.first(), items, list), *step.predicate, items, list);
+    }
+    return RoaringBitmap();
+}
+
+void describe(const Step &step, const ToDoList &list, int depth, QStringList *lines)
+{
+    QString label;
+    switch (step.op) {
+    case Step::Empty:
+        label = QStringLiteral("Empty");
+        break;
+    case Step::AllItems:
+        label = QStringLiteral("AllItems");
+        break;
+    case Step::DoneIndex:
+        label = step.value ? QStringLiteral("DoneIndex done") : QStringLiteral("DoneIndex not done");
+        break;
+    case Step::TagIndex:
+        label = QStringLiteral("TagIndex %1").arg(list.tagName(step.tag));
+        break;
+    case Step::TextIndex:
+        label = QStringLiteral("TextIndex %1 trigrams, verify %2")
+                    .arg(step.trigrams.size()).arg(Query::toString(*step.predicate));
+        break;
+    case Step::FieldIndex:
+        label = step.predicate ? QStringLiteral("FieldIndex %1, verify %2")
+                                     .arg(step.field, Query::toString(*step.predicate))
+                               : QStringLiteral("FieldIndex %1").arg(step.field);
+        break;
+    case Step::Intersect:
+        label = QStringLiteral("Intersect");
+        break;
+    case Step::Unite:
+        label = QStringLiteral("Unite");
+        break;
+    case Step::Subtract:
+        label = QStringLiteral("Subtract");
+        break;
+    case Step::Filter:
+        label = isFullScan(step)
+                    ? QStringLiteral("BlockScan %1").arg(Query::toString(*step.predicate))
+                    : QStringLiteral("Filter %1").arg(Query::toString(*step.predicate));
+        break;
+    }
+
+    lines->append(QStringLiteral("%1%2 (rows=%3 cost=%4)")
+                      .arg(QString(depth * 2, QLatin1Char(' ')), label)
+                      .arg(qRound64(step.rows)).arg(qRound64(step.cost)));
+
+    // A block scan reads the items directly; its AllItems input is implied.
+    if (isFullScan(step))
+        return;
+    for (const auto &child : step.children)
+        describe(*child, list, depth + 1, lines);
+}
+
+} // namespace
+
+QueryPlan QueryPlan::compile(const Query &query, const ToDoList &list)
+{
+    QueryPlan plan;
+    if (!query.isValid())
+        plan.mRoot = makeStep(Step::Empty, 0, 0);
+    else if (!query.root())
+        plan.mRoot = makeStep(Step::AllItems, double(list.liveIds().cardinality()), 0);
+    else
+        plan.mRoot = Planner(list).plan(query.root());
+
+    // The description needs the list for tag names, so render it right away.
+    QStringList lines;
+    describe(*plan.mRoot, list, 0, &lines);
+    plan.mExplain = lines.join(QLatin1Char('\n'));
+    return plan;
+}
+
+bool QueryPlan::isNull() const
+{
+    return !mRoot;
+}
+
+RoaringBitmap QueryPlan::execute(const ToDoList &list) const
+{
+    if (!mRoot)
+        return RoaringBitmap();
+    return run(*mRoot, list.items(), list);
+}
+
+double QueryPlan::estimatedRows() const
+{
+    return mRoot ? mRoot->rows : 0;
+}
+
+double QueryPlan::cost() const
+{
+    return mRoot ? mRoot->cost : 0;
+}
+
+QString QueryPlan::explain() const
+{
+    return mExplain;
+}
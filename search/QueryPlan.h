@@ -0,0 +1,68 @@
+#ifndef QUERYPLAN_H
+#define QUERYPLAN_H
+
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "Query.h"
+#include "RoaringBitmap.h"
+
+class ToDoList;
+
+// Evaluation plan for a Query against the indexes of a ToDoList. Terms that
+// have an index (done bitmap, tag bitmaps, trigram postings, custom field
+// ids) generate candidate id sets that are combined with bitmap operations;
+// the remaining terms are verified on the candidates only, or with a block
+// scan over the items when nothing narrows the search down.
+class QueryPlan
+{
+public:
+    struct Step
+    {
+        enum Operator {
+            Empty,      // nothing can match
+            AllItems,   // every live item
+            DoneIndex,  // done bitmap, or its complement when !value
+            TagIndex,   // bitmap of tag
+            TextIndex,  // intersection of trigram postings, verified against predicate
+            FieldIndex, // ids that have field, verified against predicate if any
+            Intersect,
+            Unite,
+            Subtract,   // first child minus the others
+            Filter      // first child verified against predicate
+        };
+
+        Operator op = Empty;
+        bool value = true;
+        quint32 tag = 0;
+        QString field;
+        QVector<quint32> trigrams;
+        QSharedPointer<const Query::Node> predicate;
+        QVector<QSharedPointer<Step>> children;
+
+        // Estimated output size and work, in rows.
+        double rows = 0;
+        double cost = 0;
+    };
+
+    QueryPlan() = default;
+
+    static QueryPlan compile(const Query &query, const ToDoList &list);
+
+    bool isNull() const;
+
+    RoaringBitmap execute(const ToDoList &list) const;
+
+    double estimatedRows() const;
+    double cost() const;
+
+    // Indented, human readable description of the plan with estimates.
+    QString explain() const;
+
+private:
+    QSharedPointer<Step> mRoot;
+    QString mExplain;
+};
+
+#endif // QUERYPLAN_H
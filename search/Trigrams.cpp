@@ -0,0 +1,36 @@
+#include "Trigrams.h"
+
+#include <algorithm>
+
+QVector<quint32> Trigrams::of(const QString &text)
+{
+    QVector<quint32> keys;
+    if (text.size() < 3)
+        return keys;
+
+    const QString folded = text.toCaseFolded();
+    keys.reserve(folded.size() - 2);
+    for (int i = 0; i + 2 < folded.size(); ++i)
+        keys.append(key(folded.at(i), folded.at(i + 1), folded.at(i + 2)));
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+quint32 Trigrams::key(QChar a, QChar b, QChar c)
+{
+    // Characters below U+0400 (Latin, Greek, Cyrillic) pack losslessly into
+    // 30 bits; anything else is hashed into the upper half of the key space.
+    // Collisions only add candidates, which are verified anyway.
+    const quint32 ua = a.unicode();
+    const quint32 ub = b.unicode();
+    const quint32 uc = c.unicode();
+    if (ua < 0x400 && ub < 0x400 && uc < 0x400)
+        return (ua << 20) | (ub << 10) | uc;
+
+    quint32 hash = 2166136261u;
+    for (const quint32 u : { ua, ub, uc })
+        hash = (hash ^ u) * 16777619u;
+    return hash | 0x80000000u;
+}
@@ -0,0 +1,19 @@
+#ifndef TRIGRAMS_H
+#define TRIGRAMS_H
+
+#include <QString>
+#include <QVector>
+
+// Case-folded character trigrams used as full-text postings keys. A
+// substring of at least three characters can only occur in a text that
+// contains all of the substring's trigrams.
+class Trigrams
+{
+public:
+    // Sorted, unique trigram keys of text.
+    static QVector<quint32> of(const QString &text);
+
+    static quint32 key(QChar a, QChar b, QChar c);
+};
+
+#endif // TRIGRAMS_H
@@ -0,0 +1,205 @@
+#include "ActivityFile.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <limits>
+
+namespace {
+
+constexpr quint32 Magic = 0x43414454; // "TDAC"
+constexpr quint32 FormatVersionV1 = 1;
+constexpr quint32 FormatVersion = 2;
+constexpr int HeaderSizeV1 = 32;
+constexpr int HeaderSize = 128;
+
+// Header fields, as byte offsets.
+constexpr int MagicOffset = 0;
+constexpr int FormatOffset = 4;
+constexpr int IdentityOffset = 8;
+constexpr int SizeOffset = 24; // version 1
+constexpr int EndOffset = 24;
+constexpr int MarksOffset = 32;
+constexpr int OpenOffset = 56;
+constexpr int OpenSize = 24;
+
+constexpr int RecordHeaderSize = 8;
+
+// No bucket closed yet.
+constexpr qint64 NoMark = std::numeric_limits<qint64>::min();
+
+struct Header
+{
+    quint64 end = HeaderSize;
+    qint64 marks[ActivitySeries::ResolutionCount] = {NoMark, NoMark, NoMark};
+};
+
+QByteArray encodeHeader(const QUuid &identity, const Header &header, const ActivitySeries &series)
+{
+    QByteArray data(HeaderSize, '\0');
+    char *out = data.data();
+    qToLittleEndian(Magic, out + MagicOffset);
+    qToLittleEndian(FormatVersion, out + FormatOffset);
+    const QByteArray uuid = identity.toRfc4122();
+    memcpy(out + IdentityOffset, uuid.constData(), 16);
+    qToLittleEndian(header.end, out + EndOffset);
+
+    for (int r = 0; r < ActivitySeries::ResolutionCount; ++r) {
+        qToLittleEndian(header.marks[r], out + MarksOffset + r * 8);
+
+        ActivitySeries::Point open;
+        char *bucket = out + OpenOffset + r * OpenSize;
+        if (series.openBucket(ActivitySeries::Resolution(r), &open)) {
+            qToLittleEndian(open.time, bucket);
+            qToLittleEndian(quint32(1), bucket + 8);
+            for (int c = 0; c < ActivitySeries::CounterCount; ++c)
+                qToLittleEndian(open.counts[c], bucket + 12 + c * 4);
+        }
+    }
+    return data;
+}
+
+// Appends a record for each resolution with buckets closed after its mark,
+// and moves the marks past them.
+void encodeRecords(const ActivitySeries &series, Header *header, QByteArray *records)
+{
+    for (int r = 0; r < ActivitySeries::ResolutionCount; ++r) {
+        qint64 last = header->marks[r];
+        const QByteArray blocks = series.closedSince(ActivitySeries::Resolution(r), header->marks[r], &last);
+        if (last == header->marks[r])
+            continue;
+
+        char record[RecordHeaderSize];
+        qToLittleEndian(quint32(r), record);
+        qToLittleEndian(quint32(blocks.size()), record + 4);
+        records->append(record, RecordHeaderSize);
+        records->append(blocks);
+        header->marks[r] = last;
+    }
+}
+
+}
+
+bool ActivityFile::write(const QString &filePath, const QUuid &identity, const ActivitySeries &series,
+                         QString *error)
+{
+    Header header;
+    QByteArray records;
+    encodeRecords(series, &header, &records);
+    header.end = quint64(HeaderSize + records.size());
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    file.write(encodeHeader(identity, header, series));
+    file.write(records);
+    if (!file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ActivityFile::append(const QString &filePath, const QUuid &identity, const ActivitySeries &series,
+                          QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadWrite))
+        return write(filePath, identity, series, error);
+
+    // Anything but a version 2 file of this list is replaced by a full one.
+    const QByteArray stored = file.read(HeaderSize);
+    const char *in = stored.constData();
+    Header header;
+    if (stored.size() == HeaderSize) {
+        header.end = qFromLittleEndian<quint64>(in + EndOffset);
+        for (int r = 0; r < ActivitySeries::ResolutionCount; ++r)
+            header.marks[r] = qFromLittleEndian<qint64>(in + MarksOffset + r * 8);
+    }
+    if (stored.size() != HeaderSize
+        || qFromLittleEndian<quint32>(in + MagicOffset) != Magic
+        || qFromLittleEndian<quint32>(in + FormatOffset) != FormatVersion
+        || QUuid::fromRfc4122(QByteArrayView(in + IdentityOffset, 16)) != identity
+        || header.end < quint64(HeaderSize) || header.end > quint64(file.size())) {
+        file.close();
+        return write(filePath, identity, series, error);
+    }
+
+    // Records go after the end marker, over anything left by a torn append,
+    // and are flushed before the header is moved past them.
+    QByteArray records;
+    encodeRecords(series, &header, &records);
+    if (!records.isEmpty()) {
+        if (!file.seek(qint64(header.end)) || file.write(records) != records.size() || !file.flush()) {
+            *error = file.errorString();
+            return false;
+        }
+        header.end += quint64(records.size());
+    }
+
+    const QByteArray updated = encodeHeader(identity, header, series);
+    if (!file.seek(0) || file.write(updated) != updated.size() || !file.flush()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+ActivitySeries ActivityFile::read(const QString &filePath, const QUuid &identity)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return ActivitySeries();
+
+    const QByteArray contents = file.readAll();
+    if (contents.size() < HeaderSizeV1)
+        return ActivitySeries();
+
+    const char *header = contents.constData();
+    const quint32 format = qFromLittleEndian<quint32>(header + FormatOffset);
+    if (qFromLittleEndian<quint32>(header + MagicOffset) != Magic
+        || QUuid::fromRfc4122(QByteArrayView(header + IdentityOffset, 16)) != identity)
+        return ActivitySeries();
+
+    if (format == FormatVersionV1) {
+        if (qFromLittleEndian<quint64>(header + SizeOffset) != quint64(contents.size() - HeaderSizeV1))
+            return ActivitySeries();
+        return ActivitySeries::deserialize(QByteArrayView(contents).mid(HeaderSizeV1));
+    }
+
+    const quint64 end = contents.size() >= HeaderSize ? qFromLittleEndian<quint64>(header + EndOffset) : 0;
+    if (format != FormatVersion || end < quint64(HeaderSize) || end > quint64(contents.size()))
+        return ActivitySeries();
+
+    ActivitySeries series;
+    for (qint64 offset = HeaderSize; offset + RecordHeaderSize <= qint64(end); ) {
+        const quint32 resolution = qFromLittleEndian<quint32>(header + offset);
+        const quint32 size = qFromLittleEndian<quint32>(header + offset + 4);
+        offset += RecordHeaderSize;
+        if (resolution >= ActivitySeries::ResolutionCount || size > quint64(end) - quint64(offset)
+            || !series.appendClosed(ActivitySeries::Resolution(resolution),
+                                    QByteArrayView(header + offset, qsizetype(size))))
+            return ActivitySeries();
+        offset += size;
+    }
+
+    for (int r = 0; r < ActivitySeries::ResolutionCount; ++r) {
+        const char *bucket = header + OpenOffset + r * OpenSize;
+        if (!qFromLittleEndian<quint32>(bucket + 8))
+            continue;
+        ActivitySeries::Point open;
+        open.time = qFromLittleEndian<qint64>(bucket);
+        for (int c = 0; c < ActivitySeries::CounterCount; ++c)
+            open.counts[c] = qFromLittleEndian<quint32>(bucket + 12 + c * 4);
+        series.setOpenBucket(ActivitySeries::Resolution(r), open);
+    }
+    return series;
+}
+
+QString ActivityFile::pathFor(const QString &listFilePath)
+{
+    return listFilePath + QStringLiteral(".activity");
+}
@@ -0,0 +1,35 @@
+#ifndef ACTIVITYFILE_H
+#define ACTIVITYFILE_H
+
+#include <QString>
+#include <QUuid>
+
+#include "ActivitySeries.h"
+
+// Activity counters persisted next to a list file.
+//
+// A fixed-size header, rewritten in place, holds the list identity, the
+// end of the records, the last closed bucket stored per resolution and the
+// open buckets. It is followed by records of closed buckets, as
+// ActivitySeries::closedSince() encodes them. append() only writes the
+// buckets closed since the last save and then moves the end marker past
+// them; write() replaces the file with a single record per resolution.
+// Version 1 files, a short header followed by ActivitySeries::serialize(),
+// are still read.
+class ActivityFile
+{
+public:
+    static bool write(const QString &filePath, const QUuid &identity, const ActivitySeries &series,
+                      QString *error);
+    // Falls back to write() for a file that is missing, of another list or
+    // of an older version.
+    static bool append(const QString &filePath, const QUuid &identity, const ActivitySeries &series,
+                       QString *error);
+
+    // Empty when the file is missing, invalid or belongs to another list.
+    static ActivitySeries read(const QString &filePath, const QUuid &identity);
+
+    static QString pathFor(const QString &listFilePath);
+};
+
+#endif // ACTIVITYFILE_H
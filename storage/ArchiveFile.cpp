@@ -0,0 +1,279 @@
+#include "ArchiveFile.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QtEndian>
+
+namespace {
+
+constexpr quint32 BlockMagicV1 = 0x42414454; // "TDAB"
+constexpr quint32 BlockMagic = 0x32414454; // "TDA2"
+constexpr int FormatVersion = 2;
+constexpr int HeaderSize = 16;
+constexpr int EntriesPerBlock = 512;
+constexpr int BloomBitsPerWord = 10;
+constexpr int BloomHashes = 4;
+
+quint64 wordHash(const QString &word)
+{
+    quint64 hash = 14695981039346656037ull;
+    for (const QChar c : word)
+        hash = (hash ^ c.unicode()) * 1099511628211ull;
+    return hash;
+}
+
+// Kirsch-Mitzenmacher double hashing over the two halves of one hash.
+template<typename Visit>
+void forEachBit(const QString &word, quint64 bitCount, Visit visit)
+{
+    const quint64 hash = wordHash(word);
+    const quint32 h1 = quint32(hash);
+    const quint32 h2 = quint32(hash >> 32) | 1;
+    for (int i = 0; i < BloomHashes; ++i)
+        visit((h1 + quint64(i) * h2) % bitCount);
+}
+
+QByteArray encodeEntries(const QVector<ArchiveFile::Entry> &entries, qsizetype first, qsizetype count)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    for (qsizetype i = first; i < first + count; ++i) {
+        const ArchiveFile::Entry &entry = entries.at(i);
+        stream << entry.id << entry.done << entry.description << entry.tags << entry.archivedAt
+               << entry.parentId << entry.created << entry.modified << entry.completed << entry.due
+               << entry.priority << entry.recurrence << entry.seriesId << entry.occurrence
+               << entry.consumed << entry.attachments << entry.customFields;
+    }
+    return qCompress(data);
+}
+
+} // namespace
+
+ArchiveFile::ArchiveFile(const QString &filePath)
+    : mFilePath(filePath)
+{
+}
+
+QString ArchiveFile::filePath() const
+{
+    return mFilePath;
+}
+
+bool ArchiveFile::open()
+{
+    mBlocks.clear();
+    mValidSize = 0;
+    mOpened = false;
+
+    QFile file(mFilePath);
+    if (!file.exists()) {
+        mOpened = true;
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        mErrorString = file.errorString();
+        return false;
+    }
+
+    scan(file, 0);
+    mOpened = true;
+    return true;
+}
+
+void ArchiveFile::scan(QFile &file, qint64 offset)
+{
+    // Adds the complete blocks from offset on to the directory.
+    const qint64 size = file.size();
+    while (size - offset >= HeaderSize) {
+        uchar header[HeaderSize];
+        file.seek(offset);
+        if (file.read(reinterpret_cast<char *>(header), HeaderSize) != HeaderSize)
+            break;
+
+        Block block;
+        const quint32 magic = qFromLittleEndian<quint32>(header);
+        if (magic == BlockMagic)
+            block.version = FormatVersion;
+        else if (magic == BlockMagicV1)
+            block.version = 1;
+        else
+            break;
+        block.entryCount = qFromLittleEndian<quint32>(header + 4);
+        block.payloadSize = qFromLittleEndian<quint32>(header + 8);
+        const quint32 bloomWords = qFromLittleEndian<quint32>(header + 12);
+        block.payloadOffset = offset + HeaderSize + qint64(bloomWords) * 8;
+        if (!bloomWords || block.payloadOffset + block.payloadSize > size)
+            break;
+
+        const QByteArray bloom = file.read(qint64(bloomWords) * 8);
+        block.bloom.resize(bloomWords);
+        for (quint32 i = 0; i < bloomWords; ++i)
+            block.bloom[i] = qFromLittleEndian<quint64>(bloom.constData() + i * 8);
+
+        offset = block.payloadOffset + block.payloadSize;
+        mBlocks.append(block);
+    }
+
+    mValidSize = offset;
+}
+
+QString ArchiveFile::errorString() const
+{
+    return mErrorString;
+}
+
+int ArchiveFile::blockCount() const
+{
+    return mBlocks.size();
+}
+
+int ArchiveFile::entryCount(int block) const
+{
+    return int(mBlocks.at(block).entryCount);
+}
+
+QVector<ArchiveFile::Entry> ArchiveFile::readBlock(int block) const
+{
+    QFile file(mFilePath);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(mBlocks.at(block).payloadOffset)) {
+        mErrorString = file.errorString();
+        return {};
+    }
+
+    const QByteArray data = qUncompress(file.read(mBlocks.at(block).payloadSize));
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_5);
+
+    QVector<Entry> entries;
+    entries.reserve(mBlocks.at(block).entryCount);
+    for (quint32 i = 0; i < mBlocks.at(block).entryCount && stream.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        stream >> entry.id >> entry.done >> entry.description >> entry.tags >> entry.archivedAt;
+        if (mBlocks.at(block).version >= 2) {
+            stream >> entry.parentId >> entry.created >> entry.modified >> entry.completed >> entry.due
+                   >> entry.priority >> entry.recurrence >> entry.seriesId >> entry.occurrence
+                   >> entry.consumed >> entry.attachments >> entry.customFields;
+        }
+        entries.append(entry);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        mErrorString = QStringLiteral("Corrupt archive block %1").arg(block);
+        return {};
+    }
+    return entries;
+}
+
+bool ArchiveFile::mayContain(int block, const QStringList &words) const
+{
+    const QVector<quint64> &bloom = mBlocks.at(block).bloom;
+    const quint64 bitCount = quint64(bloom.size()) * 64;
+    for (const QString &word : words) {
+        bool present = true;
+        forEachBit(word, bitCount, [&](quint64 bit) {
+            present = present && ((bloom.at(bit / 64) >> (bit % 64)) & 1);
+        });
+        if (!present)
+            return false;
+    }
+    return true;
+}
+
+bool ArchiveFile::append(const QVector<Entry> &entries)
+{
+    if (!mOpened && !open())
+        return false;
+
+    QFile file(mFilePath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        mErrorString = file.errorString();
+        return false;
+    }
+
+    // A file that shrank was replaced, so its directory is read again; one
+    // that grew may hold blocks appended since, or a block cut short.
+    if (file.size() < mValidSize) {
+        mBlocks.clear();
+        mValidSize = 0;
+    }
+    if (file.size() > mValidSize)
+        scan(file, mValidSize);
+    if (!file.resize(mValidSize) || !file.seek(mValidSize)) {
+        mErrorString = file.errorString();
+        return false;
+    }
+
+    for (qsizetype first = 0; first < entries.size(); first += EntriesPerBlock) {
+        const qsizetype count = std::min<qsizetype>(EntriesPerBlock, entries.size() - first);
+
+        QStringList blockWords;
+        for (qsizetype i = first; i < first + count; ++i)
+            blockWords += words(entries.at(i).description);
+        blockWords.removeDuplicates();
+
+        QVector<quint64> bloom(std::max<qsizetype>(1, (blockWords.size() * BloomBitsPerWord + 63) / 64));
+        for (const QString &word : std::as_const(blockWords)) {
+            forEachBit(word, quint64(bloom.size()) * 64, [&](quint64 bit) {
+                bloom[bit / 64] |= quint64(1) << (bit % 64);
+            });
+        }
+
+        const QByteArray payload = encodeEntries(entries, first, count);
+
+        QByteArray block(HeaderSize + bloom.size() * 8, '\0');
+        qToLittleEndian<quint32>(BlockMagic, block.data());
+        qToLittleEndian<quint32>(quint32(count), block.data() + 4);
+        qToLittleEndian<quint32>(quint32(payload.size()), block.data() + 8);
+        qToLittleEndian<quint32>(quint32(bloom.size()), block.data() + 12);
+        for (qsizetype i = 0; i < bloom.size(); ++i)
+            qToLittleEndian<quint64>(bloom.at(i), block.data() + HeaderSize + i * 8);
+        block += payload;
+
+        if (file.write(block) != block.size()) {
+            mErrorString = file.errorString();
+            return false;
+        }
+
+        Block written;
+        written.payloadOffset = mValidSize + HeaderSize + bloom.size() * 8;
+        written.payloadSize = quint32(payload.size());
+        written.entryCount = quint32(count);
+        written.version = FormatVersion;
+        written.bloom = bloom;
+        mBlocks.append(written);
+        mValidSize = written.payloadOffset + written.payloadSize;
+    }
+
+    if (!file.flush()) {
+        mErrorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QStringList ArchiveFile::words(const QString &text)
+{
+    QStringList words;
+    QString word;
+    for (const QChar c : text) {
+        if (c.isLetterOrNumber()) {
+            word.append(c);
+        } else if (!word.isEmpty()) {
+            words.append(word.toCaseFolded());
+            word.clear();
+        }
+    }
+    if (!word.isEmpty())
+        words.append(word.toCaseFolded());
+    return words;
+}
+
+bool ArchiveFile::matches(const Entry &entry, const QStringList &words)
+{
+    const QStringList entryWords = ArchiveFile::words(entry.description);
+    for (const QString &word : words) {
+        if (!entryWords.contains(word))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef ARCHIVEFILE_H
+#define ARCHIVEFILE_H
+
+#include <QDateTime>
+#include <QStringList>
+#include <QVariantHash>
+#include <QVector>
+
+class QFile;
+
+// Append-only archive of removed items, stored as compressed blocks.
+//
+// Each block starts with a small header and a bloom filter over the
+// case-folded words of its descriptions, followed by the qCompress()ed
+// items. Searching only decompresses the blocks whose filter admits every
+// word of the query. A block that was cut short by a crash is ignored and
+// overwritten by the next append.
+//
+// The block magic carries the format version. Blocks written before
+// version 2 only hold the first five fields of their entries; they stay
+// readable, with the other fields left empty.
+class ArchiveFile
+{
+public:
+    struct Entry
+    {
+        quint32 id = 0;
+        bool done = false;
+        QString description;
+        QStringList tags;
+        QDateTime archivedAt;
+        // Times in ms since the epoch, as in ToDoItem.
+        quint32 parentId = 0;
+        qint64 created = 0;
+        qint64 modified = 0;
+        qint64 completed = 0;
+        qint64 due = 0;
+        int priority = 0;
+        QString recurrence; // Recurrence::toString()
+        quint32 seriesId = 0;
+        qint64 occurrence = 0;
+        QVector<qint64> consumed;
+        QStringList attachments;
+        QVariantHash customFields;
+    };
+
+    explicit ArchiveFile(const QString &filePath = QString());
+
+    QString filePath() const;
+
+    // Re-reads the block directory; false if the file cannot be read. A
+    // missing file is an empty archive.
+    bool open();
+    QString errorString() const;
+
+    int blockCount() const;
+    int entryCount(int block) const;
+    QVector<Entry> readBlock(int block) const;
+
+    // Whether block may contain entries with all of words (see words()).
+    bool mayContain(int block, const QStringList &words) const;
+
+    // Writes the entries after the last complete block. The block directory
+    // stays in memory, so only blocks appended by someone else since are
+    // read; the new blocks are added to it as they are written.
+    bool append(const QVector<Entry> &entries);
+
+    // Case-folded words used for the bloom filters and for matching.
+    static QStringList words(const QString &text);
+    static bool matches(const Entry &entry, const QStringList &words);
+
+private:
+    struct Block
+    {
+        qint64 payloadOffset = 0;
+        quint32 payloadSize = 0;
+        quint32 entryCount = 0;
+        int version = 0;
+        QVector<quint64> bloom;
+    };
+
+    void scan(QFile &file, qint64 offset);
+
+    QString mFilePath;
+    QVector<Block> mBlocks;
+    qint64 mValidSize = 0;
+    bool mOpened = false;
+    mutable QString mErrorString;
+};
+
+#endif // ARCHIVEFILE_H
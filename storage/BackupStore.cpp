@@ -0,0 +1,274 @@
+#include "BackupStore.h"
+#include "ToDoList.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr qsizetype MinChunkSize = 2 * 1024;
+constexpr qsizetype MaxChunkSize = 64 * 1024;
+// Tested on the top bits, which depend on the last 64 bytes rather than the
+// last 13. Gives ~8 KiB chunks on average.
+constexpr quint64 ChunkMask = ~(~quint64(0) >> 13);
+constexpr qint64 ReadSize = 1024 * 1024;
+const QByteArray ManifestMagic = QByteArrayLiteral("TDBK 1");
+
+// Random but fixed, so chunk boundaries are stable across runs.
+const std::array<quint64, 256> &gearTable()
+{
+    static const std::array<quint64, 256> table = []() {
+        std::array<quint64, 256> values {};
+        quint64 state = 0x9e3779b97f4a7c15ull;
+        for (quint64 &value : values) {
+            // splitmix64
+            quint64 z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table;
+}
+
+// Reads the chunks of a manifest back to back.
+class SnapshotDevice : public QIODevice
+{
+public:
+    SnapshotDevice(const QStringList &chunkPaths, const QVector<BackupStore::Chunk> &chunks, QObject *parent)
+        : QIODevice(parent)
+        , mChunkPaths(chunkPaths)
+        , mChunks(chunks)
+    {
+    }
+
+    bool isSequential() const override { return true; }
+
+    bool atEnd() const override
+    {
+        return mNext == mChunks.size() && mPosition == mBuffer.size();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        qint64 read = 0;
+        while (read < maxSize) {
+            if (mPosition == mBuffer.size()) {
+                if (mNext == mChunks.size())
+                    break;
+                if (!loadChunk(mNext++))
+                    return read ? read : -1;
+            }
+
+            const qint64 count = std::min<qint64>(maxSize - read, mBuffer.size() - mPosition);
+            memcpy(data + read, mBuffer.constData() + mPosition, size_t(count));
+            mPosition += count;
+            read += count;
+        }
+        return read;
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    bool loadChunk(int index)
+    {
+        QFile file(mChunkPaths.at(index));
+        if (!file.open(QIODevice::ReadOnly)) {
+            setErrorString(file.errorString());
+            return false;
+        }
+
+        mBuffer = file.readAll();
+        mPosition = 0;
+        if (mBuffer.size() != mChunks.at(index).size
+            || QCryptographicHash::hash(mBuffer, QCryptographicHash::Sha256) != mChunks.at(index).hash) {
+            setErrorString(QStringLiteral("Corrupt backup chunk %1").arg(mChunkPaths.at(index)));
+            mBuffer.clear();
+            return false;
+        }
+        return true;
+    }
+
+    QStringList mChunkPaths;
+    QVector<BackupStore::Chunk> mChunks;
+    int mNext = 0;
+    QByteArray mBuffer;
+    qsizetype mPosition = 0;
+};
+
+} // namespace
+
+BackupStore::BackupStore(const QString &directory)
+    : mDirectory(directory)
+{
+}
+
+QString BackupStore::errorString() const
+{
+    return mErrorString;
+}
+
+QStringList BackupStore::snapshots() const
+{
+    QStringList names = QDir(mDirectory + QStringLiteral("/snapshots"))
+                            .entryList({ QStringLiteral("*.manifest") }, QDir::Files, QDir::Name);
+    for (QString &name : names)
+        name.chop(9);
+    return names;
+}
+
+QString BackupStore::backup(const QString &listFilePath)
+{
+    QFile file(listFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        mErrorString = file.errorString();
+        return QString();
+    }
+
+    const std::array<quint64, 256> &gear = gearTable();
+    QVector<Chunk> chunks;
+    QByteArray chunk;
+    quint64 hash = 0;
+
+    while (!file.atEnd()) {
+        const QByteArray data = file.read(ReadSize);
+        if (data.isEmpty()) {
+            mErrorString = file.errorString();
+            return QString();
+        }
+
+        qsizetype start = 0;
+        for (qsizetype i = 0; i < data.size(); ++i) {
+            hash = (hash << 1) + gear[uchar(data.at(i))];
+            const qsizetype size = chunk.size() + i - start + 1;
+            if ((size >= MinChunkSize && !(hash & ChunkMask)) || size >= MaxChunkSize) {
+                chunk.append(data.constData() + start, i - start + 1);
+                if (!storeChunk(chunk, &chunks))
+                    return QString();
+                chunk.clear();
+                hash = 0;
+                start = i + 1;
+            }
+        }
+        chunk.append(data.constData() + start, data.size() - start);
+    }
+    if (!chunk.isEmpty() && !storeChunk(chunk, &chunks))
+        return QString();
+
+    QString name = QDateTime::currentDateTimeUtc().toString(QStringLiteral("yyyyMMdd'T'HHmmsszzz"));
+    while (QFile::exists(manifestPath(name)))
+        name += QLatin1Char('_');
+
+    QDir().mkpath(mDirectory + QStringLiteral("/snapshots"));
+    QSaveFile manifest(manifestPath(name));
+    if (!manifest.open(QIODevice::WriteOnly)) {
+        mErrorString = manifest.errorString();
+        return QString();
+    }
+
+    QTextStream stream(&manifest);
+    stream << ManifestMagic << '\n';
+    for (const Chunk &entry : std::as_const(chunks))
+        stream << entry.hash.toHex() << ' ' << entry.size << '\n';
+    stream.flush();
+
+    if (!manifest.commit()) {
+        mErrorString = manifest.errorString();
+        return QString();
+    }
+    return name;
+}
+
+bool BackupStore::restore(const QString &snapshot, ToDoList *list)
+{
+    QIODevice *device = open(snapshot);
+    if (!device)
+        return false;
+
+    const bool loaded = list->load(device);
+    if (!loaded)
+        mErrorString = device->errorString().isEmpty() ? list->errorString() : device->errorString();
+    delete device;
+    return loaded;
+}
+
+QIODevice *BackupStore::open(const QString &snapshot, QObject *parent)
+{
+    QFile manifest(manifestPath(snapshot));
+    if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        mErrorString = manifest.errorString();
+        return nullptr;
+    }
+
+    if (manifest.readLine().trimmed() != ManifestMagic) {
+        mErrorString = QStringLiteral("Not a backup manifest");
+        return nullptr;
+    }
+
+    QVector<Chunk> chunks;
+    QStringList paths;
+    while (!manifest.atEnd()) {
+        const QList<QByteArray> fields = manifest.readLine().trimmed().split(' ');
+        Chunk chunk;
+        bool ok = fields.size() == 2;
+        if (ok) {
+            // fromHex() does not reject invalid digits, so the length of
+            // the text is checked as well as that of the hash.
+            chunk.hash = QByteArray::fromHex(fields.at(0));
+            chunk.size = fields.at(1).toUInt(&ok);
+            ok = ok && fields.at(0).size() == 64 && chunk.hash.size() == 32
+                && chunk.size > 0 && qsizetype(chunk.size) <= MaxChunkSize;
+        }
+        if (!ok) {
+            mErrorString = QStringLiteral("Corrupt backup manifest");
+            return nullptr;
+        }
+        chunks.append(chunk);
+        paths.append(chunkPath(chunk.hash));
+    }
+
+    QIODevice *device = new SnapshotDevice(paths, chunks, parent);
+    device->open(QIODevice::ReadOnly);
+    return device;
+}
+
+QString BackupStore::chunkPath(const QByteArray &hash) const
+{
+    const QByteArray hex = hash.toHex();
+    return QStringLiteral("%1/chunks/%2/%3").arg(mDirectory, QLatin1String(hex.left(2)), QLatin1String(hex));
+}
+
+QString BackupStore::manifestPath(const QString &snapshot) const
+{
+    return QStringLiteral("%1/snapshots/%2.manifest").arg(mDirectory, snapshot);
+}
+
+bool BackupStore::storeChunk(const QByteArray &data, QVector<Chunk> *chunks)
+{
+    Chunk chunk;
+    chunk.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+    chunk.size = quint32(data.size());
+    chunks->append(chunk);
+
+    const QString path = chunkPath(chunk.hash);
+    if (QFile::exists(path))
+        return true;
+
+    QDir().mkpath(path.left(path.lastIndexOf(QLatin1Char('/'))));
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        mErrorString = file.errorString();
+        return false;
+    }
+    return true;
+}
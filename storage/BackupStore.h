@@ -0,0 +1,50 @@
+#ifndef BACKUPSTORE_H
+#define BACKUPSTORE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QStringList>
+#include <QVector>
+
+class ToDoList;
+
+// Deduplicating snapshots of list files.
+//
+// A snapshot is cut into content-defined chunks with a gear rolling hash,
+// so an edit only changes the chunks around it, and every chunk is stored
+// once under its SHA-256 in <directory>/chunks. A snapshot itself is a
+// manifest in <directory>/snapshots listing its chunks in order, written
+// only after all of them are on disk.
+class BackupStore
+{
+public:
+    struct Chunk
+    {
+        QByteArray hash; // raw SHA-256
+        quint32 size = 0;
+    };
+
+    explicit BackupStore(const QString &directory);
+
+    QString errorString() const;
+
+    // Snapshot names, oldest first.
+    QStringList snapshots() const;
+
+    // Returns the name of the new snapshot, or an empty string on failure.
+    QString backup(const QString &listFilePath);
+    bool restore(const QString &snapshot, ToDoList *list);
+
+    // Streams the contents of a snapshot; null on failure.
+    QIODevice *open(const QString &snapshot, QObject *parent = nullptr);
+
+private:
+    QString chunkPath(const QByteArray &hash) const;
+    QString manifestPath(const QString &snapshot) const;
+    bool storeChunk(const QByteArray &data, QVector<Chunk> *chunks);
+
+    QString mDirectory;
+    QString mErrorString;
+};
+
+#endif // BACKUPSTORE_H
@@ -0,0 +1,93 @@
+#include "BlobStore.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+constexpr qint64 ReadSize = 1024 * 1024;
+
+bool isHash(const QString &hash)
+{
+    if (hash.size() != 64)
+        return false;
+    for (const QChar c : hash) {
+        if (!((c >= u'0' && c <= u'9') || (c >= u'a' && c <= u'f')))
+            return false;
+    }
+    return true;
+}
+
+}
+
+BlobStore::BlobStore(const QString &directory)
+    : mDirectory(directory)
+{
+}
+
+QString BlobStore::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/blobs");
+}
+
+QString BlobStore::errorString() const
+{
+    return mErrorString;
+}
+
+QString BlobStore::put(const QString &filePath)
+{
+    QFile source(filePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        mErrorString = source.errorString();
+        return QString();
+    }
+
+    QCryptographicHash sha(QCryptographicHash::Sha256);
+    if (!sha.addData(&source)) {
+        mErrorString = source.errorString();
+        return QString();
+    }
+    const QString hash = QString::fromLatin1(sha.result().toHex());
+
+    const QString target = path(hash);
+    if (QFile::exists(target))
+        return hash;
+
+    QDir().mkpath(target.left(target.lastIndexOf(QLatin1Char('/'))));
+    QSaveFile file(target);
+    if (!file.open(QIODevice::WriteOnly) || !source.seek(0)) {
+        mErrorString = file.errorString();
+        return QString();
+    }
+    while (!source.atEnd()) {
+        const QByteArray data = source.read(ReadSize);
+        if (data.isEmpty() || file.write(data) != data.size()) {
+            mErrorString = data.isEmpty() ? source.errorString() : file.errorString();
+            file.cancelWriting();
+            return QString();
+        }
+    }
+    if (!file.commit()) {
+        mErrorString = file.errorString();
+        return QString();
+    }
+    return hash;
+}
+
+bool BlobStore::contains(const QString &hash) const
+{
+    return isHash(hash) && QFile::exists(path(hash));
+}
+
+QString BlobStore::path(const QString &hash) const
+{
+    // Hashes come from QML image URLs as well; anything else must not
+    // reach outside the store.
+    if (!isHash(hash))
+        return QString();
+    return QStringLiteral("%1/%2/%3").arg(mDirectory, hash.left(2), hash);
+}
@@ -0,0 +1,31 @@
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include <QString>
+
+// Content-addressed store for attachments. A file is stored once under the
+// hex SHA-256 of its contents in <directory>/<first two digits>/<hash>, so
+// attaching the same file again, to any item of any list, costs nothing.
+class BlobStore
+{
+public:
+    explicit BlobStore(const QString &directory = defaultDirectory());
+
+    // The blobs directory in the application data location.
+    static QString defaultDirectory();
+
+    QString errorString() const;
+
+    // Copies the file into the store unless its contents are there already
+    // and returns their hash, or an empty string on failure.
+    QString put(const QString &filePath);
+
+    bool contains(const QString &hash) const;
+    QString path(const QString &hash) const;
+
+private:
+    QString mDirectory;
+    QString mErrorString;
+};
+
+#endif // BLOBSTORE_H
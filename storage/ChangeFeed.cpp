@@ -0,0 +1,61 @@
+#include "ChangeFeed.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+QByteArray ChangeFeed::toNdjson(const ChangeSet &changes, const ToDoList &list)
+{
+    QByteArray lines;
+
+    const auto append = [&lines](const QJsonObject &object) {
+        lines += QJsonDocument(object).toJson(QJsonDocument::Compact);
+        lines += '\n';
+    };
+    const auto itemObject = [&list](const char *operation, const ToDoItem &item) {
+        QJsonObject object {
+            { QStringLiteral("op"), QLatin1String(operation) },
+            { QStringLiteral("id"), qint64(item.id) },
+            { QStringLiteral("parentId"), qint64(item.parentId) },
+            { QStringLiteral("done"), item.done },
+            { QStringLiteral("description"), item.description },
+            { QStringLiteral("tags"), QJsonArray::fromStringList(list.tagNames(item.tags)) }
+        };
+        if (item.due)
+            object.insert(QStringLiteral("due"), item.due);
+        if (item.priority)
+            object.insert(QStringLiteral("priority"), item.priority);
+        object.insert(QStringLiteral("created"), item.created);
+        object.insert(QStringLiteral("modified"), item.modified);
+        if (item.completed)
+            object.insert(QStringLiteral("completed"), item.completed);
+        if (item.recurrence.isValid())
+            object.insert(QStringLiteral("recurrence"), item.recurrence.toString());
+        if (!item.attachments.isEmpty())
+            object.insert(QStringLiteral("attachments"), QJsonArray::fromStringList(item.attachments));
+        if (item.duplicateOf)
+            object.insert(QStringLiteral("duplicateOf"), qint64(item.duplicateOf));
+        if (item.seriesId) {
+            object.insert(QStringLiteral("seriesId"), qint64(item.seriesId));
+            object.insert(QStringLiteral("occurrence"), item.occurrence);
+        }
+        const QVariantHash fields = list.customFields().fields(item.id);
+        if (!fields.isEmpty())
+            object.insert(QStringLiteral("fields"), QJsonObject::fromVariantHash(fields));
+        return object;
+    };
+
+    append({
+        { QStringLiteral("from"), qint64(changes.fromVersion) },
+        { QStringLiteral("to"), qint64(changes.toVersion) },
+        { QStringLiteral("snapshot"), changes.snapshot }
+    });
+    for (const quint32 id : changes.deletes)
+        append({ { QStringLiteral("op"), QStringLiteral("delete") }, { QStringLiteral("id"), qint64(id) } });
+    for (const ToDoItem &item : changes.inserts)
+        append(itemObject("insert", item));
+    for (const ToDoItem &item : changes.updates)
+        append(itemObject("update", item));
+
+    return lines;
+}
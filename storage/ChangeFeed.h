@@ -0,0 +1,30 @@
+#ifndef CHANGEFEED_H
+#define CHANGEFEED_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "ToDoList.h"
+
+// Changes between two versions of a ToDoList, one entry per item.
+struct ChangeSet
+{
+    quint64 fromVersion = 0;
+    quint64 toVersion = 0;
+    // The history did not reach back to fromVersion; inserts then hold every
+    // item and consumers should replace what they have.
+    bool snapshot = false;
+    QVector<ToDoItem> inserts;
+    QVector<ToDoItem> updates;
+    QVector<quint32> deletes;
+};
+
+class ChangeFeed
+{
+public:
+    // One JSON object per line: a header with the versions and the snapshot
+    // flag, then {"op":"insert"|"update"|"delete", "id":...} records.
+    static QByteArray toNdjson(const ChangeSet &changes, const ToDoList &list);
+};
+
+#endif // CHANGEFEED_H
@@ -0,0 +1,401 @@
+#include "CsvFile.h"
+#include "ToDoList.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define TODO_CSV_SSE2
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr qsizetype WindowSize = qsizetype(32) << 20;
+constexpr qsizetype ChunkSize = qsizetype(1) << 20;
+constexpr int ExportChunkRows = 16384;
+constexpr int ExportBatchChunks = 64;
+
+enum Column {
+    DoneColumn,
+    DescriptionColumn,
+    TagsColumn,
+    IgnoredColumn
+};
+
+struct Row
+{
+    bool done = false;
+    QString description;
+    QStringList tags;
+};
+
+struct ParsedChunk
+{
+    QVector<Row> rows;
+    qsizetype end = 0; // just past the last record starting in the chunk
+};
+
+struct Masks
+{
+    quint64 quotes = 0;
+    quint64 separators = 0; // commas and newlines
+};
+
+Masks classify(const char *data)
+{
+    Masks masks;
+#ifdef TODO_CSV_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (int i = 0; i < 4; ++i) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16));
+        masks.quotes |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(block, quote)))) << (i * 16);
+        const __m128i separators = _mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline));
+        masks.separators |= quint64(quint16(_mm_movemask_epi8(separators))) << (i * 16);
+    }
+#else
+    for (int i = 0; i < 64; ++i) {
+        if (data[i] == '"')
+            masks.quotes |= quint64(1) << i;
+        else if (data[i] == ',' || data[i] == '\n')
+            masks.separators |= quint64(1) << i;
+    }
+#endif
+    return masks;
+}
+
+// Bit i is set when byte i is inside quotes: a running xor of the quote bits.
+quint64 prefixXor(quint64 bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+qsizetype countQuotes(const char *data, qsizetype begin, qsizetype end)
+{
+    qsizetype count = 0;
+    qsizetype pos = begin;
+    for (; end - pos >= 64; pos += 64)
+        count += qPopulationCount(classify(data + pos).quotes);
+    for (; pos < end; ++pos)
+        count += data[pos] == '"';
+    return count;
+}
+
+// Appends the offsets of unquoted commas and newlines in [begin, end) and
+// returns whether end is inside quotes.
+bool findSeparators(const char *data, qsizetype begin, qsizetype end, bool inQuotes, QVector<qsizetype> *separators)
+{
+    qsizetype pos = begin;
+    quint64 carry = inQuotes ? ~quint64(0) : 0;
+    for (; end - pos >= 64; pos += 64) {
+        const Masks masks = classify(data + pos);
+        const quint64 inside = prefixXor(masks.quotes) ^ carry;
+        carry = inside >> 63 ? ~quint64(0) : 0;
+        for (quint64 bits = masks.separators & ~inside; bits; bits &= bits - 1)
+            separators->append(pos + qCountTrailingZeroBits(bits));
+    }
+
+    inQuotes = carry;
+    for (; pos < end; ++pos) {
+        if (data[pos] == '"')
+            inQuotes = !inQuotes;
+        else if (!inQuotes && (data[pos] == ',' || data[pos] == '\n'))
+            separators->append(pos);
+    }
+    return inQuotes;
+}
+
+QString field(const char *data, qsizetype begin, qsizetype end)
+{
+    if (end > begin && data[end - 1] == '\r')
+        --end;
+    if (end - begin >= 2 && data[begin] == '"' && data[end - 1] == '"') {
+        QByteArray unquoted(data + begin + 1, end - begin - 2);
+        unquoted.replace("\"\"", "\"");
+        return QString::fromUtf8(unquoted);
+    }
+    return QString::fromUtf8(data + begin, end - begin);
+}
+
+bool parseDone(const QString &text)
+{
+    static const QStringList truths = { QStringLiteral("1"), QStringLiteral("true"), QStringLiteral("yes"),
+                                        QStringLiteral("x"), QStringLiteral("done") };
+    return truths.contains(text.trimmed(), Qt::CaseInsensitive);
+}
+
+// Unquoted separators from a starting offset on, found in blocks as they
+// are needed.
+class Scanner
+{
+public:
+    Scanner(const char *data, qsizetype size, qsizetype begin, qsizetype end, bool inQuotes)
+        : mData(data)
+        , mSize(size)
+        , mScanned(end)
+    {
+        mInQuotes = findSeparators(data, begin, end, inQuotes, &mSeparators);
+    }
+
+    // False at the end of the data.
+    bool next(qsizetype *separator)
+    {
+        while (mNext == mSeparators.size()) {
+            if (mScanned >= mSize)
+                return false;
+            const qsizetype end = std::min(mSize, mScanned + 65536);
+            mInQuotes = findSeparators(mData, mScanned, end, mInQuotes, &mSeparators);
+            mScanned = end;
+        }
+        *separator = mSeparators.at(mNext++);
+        return true;
+    }
+
+private:
+    const char *mData;
+    qsizetype mSize;
+    qsizetype mScanned;
+    bool mInQuotes = false;
+    QVector<qsizetype> mSeparators;
+    int mNext = 0;
+};
+
+// Calls onField(column, begin, end) for each field of the record starting
+// at begin and returns the offset just past it.
+template<typename OnField>
+qsizetype readRecord(const char *data, qsizetype size, Scanner &scanner, qsizetype begin, OnField onField)
+{
+    int column = 0;
+    qsizetype separator = 0;
+    while (scanner.next(&separator)) {
+        onField(column++, begin, separator);
+        begin = separator + 1;
+        if (data[separator] == '\n')
+            return begin;
+    }
+    onField(column, begin, size);
+    return size;
+}
+
+// Parses the records that start in [begin, end); the last one may run past
+// end. Unless begin is known to start a record, everything up to the first
+// unquoted newline belongs to the previous chunk.
+ParsedChunk parseChunk(const char *data, qsizetype size, qsizetype begin, qsizetype end, bool inQuotes,
+                       bool atRecordStart, const QVector<Column> &columns)
+{
+    // Scanning from the byte before begin catches a record starting right
+    // at begin.
+    const qsizetype scanBegin = atRecordStart ? begin : begin - 1;
+    Scanner scanner(data, size, scanBegin, end, inQuotes != (scanBegin < begin && data[scanBegin] == '"'));
+    qsizetype recordBegin = begin;
+    if (!atRecordStart) {
+        qsizetype separator = 0;
+        do {
+            if (!scanner.next(&separator) || separator >= end)
+                return { {}, begin };
+        } while (data[separator] != '\n');
+        recordBegin = separator + 1;
+    }
+
+    ParsedChunk chunk;
+    while (recordBegin < end && recordBegin < size) {
+        Row row;
+        const qsizetype recordEnd = readRecord(data, size, scanner, recordBegin,
+                                               [&](int column, qsizetype fieldBegin, qsizetype fieldEnd) {
+            const Column kind = column < columns.size() ? columns.at(column) : IgnoredColumn;
+            if (kind == DoneColumn)
+                row.done = parseDone(field(data, fieldBegin, fieldEnd));
+            else if (kind == DescriptionColumn)
+                row.description = field(data, fieldBegin, fieldEnd);
+            else if (kind == TagsColumn)
+                row.tags = field(data, fieldBegin, fieldEnd).split(QLatin1Char(';'), Qt::SkipEmptyParts);
+        });
+
+        // Blank lines carry no item.
+        qsizetype contentEnd = recordEnd;
+        while (contentEnd > recordBegin && (data[contentEnd - 1] == '\n' || data[contentEnd - 1] == '\r'))
+            --contentEnd;
+        if (contentEnd > recordBegin)
+            chunk.rows.append(row);
+
+        recordBegin = recordEnd;
+    }
+
+    chunk.end = recordBegin;
+    return chunk;
+}
+
+QVector<Column> headerColumns(const QStringList &names)
+{
+    QVector<Column> columns;
+    bool recognized = false;
+    for (const QString &name : names) {
+        const QString key = name.trimmed().toLower();
+        if (key == QLatin1String("done")) {
+            columns.append(DoneColumn);
+            recognized = true;
+        } else if (key == QLatin1String("description")) {
+            columns.append(DescriptionColumn);
+            recognized = true;
+        } else if (key == QLatin1String("tags")) {
+            columns.append(TagsColumn);
+            recognized = true;
+        } else {
+            columns.append(IgnoredColumn);
+        }
+    }
+    return recognized ? columns : QVector<Column>();
+}
+
+QByteArray quoted(const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+    if (utf8.contains(',') || utf8.contains('"') || utf8.contains('\n') || utf8.contains('\r')) {
+        utf8.replace("\"", "\"\"");
+        utf8.prepend('"');
+        utf8.append('"');
+    }
+    return utf8;
+}
+
+} // namespace
+
+bool CsvFile::read(const QString &filePath, ToDoList *list, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    const qsizetype size = file.size();
+    if (!size)
+        return true;
+    const char *data = reinterpret_cast<const char *>(file.map(0, size));
+    if (!data) {
+        *error = file.errorString();
+        return false;
+    }
+
+    // The header decides the column order for all chunks.
+    // Spreadsheets like to start their exports with a UTF-8 byte order mark.
+    QVector<Column> columns = { DoneColumn, DescriptionColumn, TagsColumn };
+    qsizetype offset = size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+    {
+        Scanner scanner(data, size, offset, offset, false);
+        QStringList names;
+        const qsizetype headerEnd = readRecord(data, size, scanner, offset, [&](int, qsizetype begin, qsizetype end) {
+            names.append(field(data, begin, end));
+        });
+        const QVector<Column> named = headerColumns(names);
+        if (!named.isEmpty()) {
+            columns = named;
+            offset = headerEnd;
+        }
+    }
+
+    while (offset < size) {
+        const qsizetype windowEnd = std::min(size, offset + WindowSize);
+
+        QVector<qsizetype> begins;
+        for (qsizetype begin = offset; begin < windowEnd; begin += ChunkSize)
+            begins.append(begin);
+
+        // Quote parity at each chunk start; the window starts at a record.
+        const QVector<qsizetype> quotes = QtConcurrent::blockingMapped<QVector<qsizetype>>(
+            begins, [&](qsizetype begin) {
+                return countQuotes(data, begin, std::min(windowEnd, begin + ChunkSize));
+            });
+        QVector<bool> inQuotes(begins.size());
+        for (int i = 1; i < begins.size(); ++i)
+            inQuotes[i] = inQuotes.at(i - 1) != bool(quotes.at(i - 1) & 1);
+
+        QVector<int> chunkIndexes(begins.size());
+        std::iota(chunkIndexes.begin(), chunkIndexes.end(), 0);
+        const QVector<ParsedChunk> chunks = QtConcurrent::blockingMapped<QVector<ParsedChunk>>(
+            chunkIndexes, [&](int i) {
+                return parseChunk(data, size, begins.at(i), std::min(windowEnd, begins.at(i) + ChunkSize),
+                                  inQuotes.at(i), i == 0, columns);
+            });
+
+        QVector<ToDoItem> items;
+        for (const ParsedChunk &chunk : chunks) {
+            for (const Row &row : chunk.rows) {
+                ToDoItem item;
+                item.done = row.done;
+                item.description = row.description;
+                item.tags = list->internTags(row.tags);
+                items.append(item);
+            }
+        }
+        list->appendItems(items);
+
+        // The first chunk always starts a record, so this moves forward.
+        for (const ParsedChunk &chunk : chunks)
+            offset = std::max(offset, chunk.end);
+    }
+
+    return true;
+}
+
+bool CsvFile::write(const QString &filePath, const ToDoList &list, QString *error)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    const QVector<ToDoItem> items = list.items();
+    const auto format = [&](int first) {
+        QByteArray text;
+        const int last = std::min(int(items.size()), first + ExportChunkRows);
+        for (int i = first; i < last; ++i) {
+            const ToDoItem &item = items.at(i);
+            text += item.done ? "true," : "false,";
+            text += quoted(item.description);
+            text += ',';
+            text += quoted(list.tagNames(item.tags).join(QLatin1Char(';')));
+            text += '\n';
+        }
+        return text;
+    };
+
+    file.write("done,description,tags\n");
+
+    // Formatted a batch of chunks at a time to bound memory; written in
+    // order.
+    for (int batch = 0; batch < items.size(); batch += ExportChunkRows * ExportBatchChunks) {
+        QVector<int> firsts;
+        for (int first = batch; first < items.size() && first < batch + ExportChunkRows * ExportBatchChunks;
+             first += ExportChunkRows)
+            firsts.append(first);
+
+        const QVector<QByteArray> chunks = QtConcurrent::blockingMapped<QVector<QByteArray>>(firsts, format);
+        for (const QByteArray &chunk : chunks) {
+            if (file.write(chunk) != chunk.size()) {
+                *error = file.errorString();
+                return false;
+            }
+        }
+    }
+
+    if (!file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef CSVFILE_H
+#define CSVFILE_H
+
+#include <QString>
+
+class ToDoList;
+
+// RFC 4180 CSV import and export of list items.
+//
+// Columns are matched by the header row (done, description, tags; tags are
+// separated by ';'); without a recognized header the columns are taken in
+// that order. Reading maps the file and parses it in windows of bounded
+// size: within a window, the quote parity at each chunk boundary is
+// derived from per-chunk quote counts, after which the chunks are split
+// into records and fields in parallel. Quotes, delimiters and newlines are
+// located 64 bytes at a time with SSE2 where available.
+class CsvFile
+{
+public:
+    static bool read(const QString &filePath, ToDoList *list, QString *error);
+    static bool write(const QString &filePath, const ToDoList &list, QString *error);
+};
+
+#endif // CSVFILE_H
@@ -0,0 +1,185 @@
+#include "IndexFile.h"
+
+#include <QSaveFile>
+#include <QtEndian>
+
+namespace {
+
+constexpr quint32 Magic = 0x58494454; // "TDIX"
+constexpr quint32 FormatVersion = 1;
+constexpr int HeaderSize = 64;
+constexpr int EntrySize = 24;
+
+// Header fields, as byte offsets.
+constexpr int MagicOffset = 0;
+constexpr int FormatOffset = 4;
+constexpr int IdentityOffset = 8;
+constexpr int VersionOffset = 24;
+constexpr int EntryCountOffset = 32;
+constexpr int ChecksumOffset = 40;
+
+quint64 fnv1a(const uchar *data, qint64 size, quint64 hash = 14695981039346656037ull)
+{
+    for (qint64 i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    return hash;
+}
+
+template<typename T>
+void put(QByteArray *data, int offset, T value)
+{
+    qToLittleEndian(value, data->data() + offset);
+}
+
+class SectionSource : public BitmapSource
+{
+public:
+    SectionSource(const QSharedPointer<IndexFile> &file, IndexFile::Section section, QList<quint32> keys)
+        : mFile(file)
+        , mSection(section)
+        , mKeys(keys)
+    {
+    }
+
+    QList<quint32> keys() const override { return mKeys; }
+    RoaringBitmap bitmap(quint32 key) const override { return mFile->bitmap(mSection, key); }
+
+private:
+    QSharedPointer<IndexFile> mFile;
+    IndexFile::Section mSection;
+    QList<quint32> mKeys;
+};
+
+} // namespace
+
+bool IndexFile::write(const QString &filePath, const QUuid &identity, quint64 listVersion,
+                      const RoaringBitmap &liveIds, const BitmapIndex &tags, const BitmapIndex &text,
+                      QString *error)
+{
+    struct Pending
+    {
+        quint32 section;
+        quint32 key;
+        QByteArray data;
+    };
+
+    QVector<Pending> pending;
+    pending.append({ LiveIds, 0, liveIds.serialize() });
+    for (const quint32 key : tags.keys())
+        pending.append({ Tags, key, tags.bitmap(key).serialize() });
+    for (const quint32 key : text.keys())
+        pending.append({ Text, key, text.bitmap(key).serialize() });
+
+    QByteArray head(HeaderSize + pending.size() * EntrySize, '\0');
+    put<quint32>(&head, MagicOffset, Magic);
+    put<quint32>(&head, FormatOffset, FormatVersion);
+    const QByteArray uuid = identity.toRfc4122();
+    std::copy(uuid.cbegin(), uuid.cend(), head.begin() + IdentityOffset);
+    put<quint64>(&head, VersionOffset, listVersion);
+    put<quint32>(&head, EntryCountOffset, quint32(pending.size()));
+
+    quint64 offset = quint64(head.size() + 7) / 8 * 8;
+    for (int i = 0; i < pending.size(); ++i) {
+        const int entry = HeaderSize + i * EntrySize;
+        put<quint32>(&head, entry, pending.at(i).section);
+        put<quint32>(&head, entry + 4, pending.at(i).key);
+        put<quint64>(&head, entry + 8, offset);
+        put<quint64>(&head, entry + 16, quint64(pending.at(i).data.size()));
+        offset += quint64(pending.at(i).data.size() + 7) / 8 * 8;
+    }
+    put<quint64>(&head, ChecksumOffset, fnv1a(reinterpret_cast<const uchar *>(head.constData()), head.size()));
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    const QByteArray padding(8, '\0');
+    file.write(head);
+    file.write(padding.constData(), (8 - head.size() % 8) % 8);
+    for (const Pending &entry : pending) {
+        file.write(entry.data);
+        file.write(padding.constData(), (8 - entry.data.size() % 8) % 8);
+    }
+
+    if (!file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QSharedPointer<IndexFile> IndexFile::open(const QString &filePath)
+{
+    QSharedPointer<IndexFile> index(new IndexFile);
+    index->mFile.setFileName(filePath);
+    if (!index->mFile.open(QIODevice::ReadOnly) || index->mFile.size() < HeaderSize)
+        return {};
+
+    const qint64 size = index->mFile.size();
+    index->mData = index->mFile.map(0, size);
+    if (!index->mData)
+        return {};
+
+    const uchar *data = index->mData;
+    if (qFromLittleEndian<quint32>(data + MagicOffset) != Magic
+        || qFromLittleEndian<quint32>(data + FormatOffset) != FormatVersion)
+        return {};
+
+    const quint32 entries = qFromLittleEndian<quint32>(data + EntryCountOffset);
+    if (entries > quint64(size - HeaderSize) / EntrySize)
+        return {};
+
+    // The checksum covers header and directory with the checksum field
+    // itself zeroed.
+    const qint64 headSize = HeaderSize + qint64(entries) * EntrySize;
+    QByteArray head(reinterpret_cast<const char *>(data), headSize);
+    put<quint64>(&head, ChecksumOffset, 0);
+    if (fnv1a(reinterpret_cast<const uchar *>(head.constData()), head.size())
+        != qFromLittleEndian<quint64>(data + ChecksumOffset))
+        return {};
+
+    index->mIdentity = QUuid::fromRfc4122(QByteArrayView(data + IdentityOffset, 16));
+    index->mListVersion = qFromLittleEndian<quint64>(data + VersionOffset);
+    for (quint32 i = 0; i < entries; ++i) {
+        const uchar *entry = data + HeaderSize + i * EntrySize;
+        Entry location;
+        location.offset = qFromLittleEndian<quint64>(entry + 8);
+        location.size = qFromLittleEndian<quint64>(entry + 16);
+        if (location.offset > quint64(size) || location.size > quint64(size) - location.offset)
+            return {};
+        index->mSections[qFromLittleEndian<quint32>(entry)].insert(qFromLittleEndian<quint32>(entry + 4), location);
+    }
+
+    return index;
+}
+
+QString IndexFile::pathFor(const QString &listFilePath)
+{
+    return listFilePath + QStringLiteral(".idx");
+}
+
+QUuid IndexFile::identity() const
+{
+    return mIdentity;
+}
+
+quint64 IndexFile::listVersion() const
+{
+    return mListVersion;
+}
+
+RoaringBitmap IndexFile::bitmap(Section section, quint32 key) const
+{
+    const Entry entry = mSections.value(section).value(key);
+    if (!entry.size)
+        return RoaringBitmap();
+
+    return RoaringBitmap::deserialize(QByteArrayView(mData + entry.offset, qsizetype(entry.size)));
+}
+
+QSharedPointer<const BitmapSource> IndexFile::source(const QSharedPointer<IndexFile> &file, Section section)
+{
+    return QSharedPointer<const BitmapSource>(new SectionSource(file, section, file->mSections.value(section).keys()));
+}
@@ -0,0 +1,59 @@
+#ifndef INDEXFILE_H
+#define INDEXFILE_H
+
+#include <QFile>
+#include <QHash>
+#include <QSharedPointer>
+#include <QUuid>
+
+#include "BitmapIndex.h"
+
+// Search indexes persisted next to a list file, read through a memory map.
+//
+// Layout (little-endian): a 64-byte header with the list identity and the
+// list version the indexes reflect, a directory of (section, key, offset,
+// size) entries and the serialized bitmaps, 8-byte aligned. A checksum over
+// header and directory rejects files that were truncated or belong to a
+// different list. Bitmaps themselves are only read when first used.
+class IndexFile
+{
+public:
+    enum Section : quint32 {
+        LiveIds = 0,
+        Tags = 1,
+        Text = 2
+    };
+
+    static bool write(const QString &filePath, const QUuid &identity, quint64 listVersion,
+                      const RoaringBitmap &liveIds, const BitmapIndex &tags, const BitmapIndex &text,
+                      QString *error);
+
+    // Null when the file is missing or invalid.
+    static QSharedPointer<IndexFile> open(const QString &filePath);
+
+    static QString pathFor(const QString &listFilePath);
+
+    QUuid identity() const;
+    quint64 listVersion() const;
+
+    RoaringBitmap bitmap(Section section, quint32 key) const;
+
+    // A view of one section for BitmapIndex::attach(); it keeps the mapping
+    // alive.
+    static QSharedPointer<const BitmapSource> source(const QSharedPointer<IndexFile> &file, Section section);
+
+private:
+    struct Entry
+    {
+        quint64 offset = 0;
+        quint64 size = 0;
+    };
+
+    QFile mFile;
+    const uchar *mData = nullptr;
+    QUuid mIdentity;
+    quint64 mListVersion = 0;
+    QHash<quint32, QHash<quint32, Entry>> mSections;
+};
+
+#endif // INDEXFILE_H
@@ -0,0 +1,250 @@
+#include "ListFile.h"
+
+#include <QDataStream>
+#include <QFileDevice>
+#include <QHash>
+#include <QSet>
+
+#ifdef Q_OS_WIN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr quint32 Magic = 0x54444c31; // "TDL1"
+constexpr quint32 FormatVersion = 10;
+constexpr int HeaderSize = 64;
+
+enum RecordType : quint8 {
+    UpsertRecord = 1,
+    RemoveRecord = 2,
+    TagsRecord = 3
+};
+
+void setUpStream(QDataStream &stream)
+{
+    stream.setVersion(QDataStream::Qt_6_5);
+}
+
+// flush() only hands the data to the OS; this waits until it is on disk.
+bool sync(QFileDevice *file)
+{
+    if (!file->flush())
+        return false;
+    if (file->handle() < 0)
+        return true; // not backed by a file descriptor
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(HANDLE(_get_osfhandle(file->handle())));
+#else
+    return fsync(file->handle()) == 0;
+#endif
+}
+
+void writeItem(QDataStream &stream, const ToDoItem &item)
+{
+    stream << item.id << item.parentId << item.done << item.description << item.tags << item.version
+           << item.due << item.priority << item.created << item.modified << item.completed
+           << item.recurrence.toString() << item.seriesId << item.occurrence << item.attachments
+           << item.duplicateOf << item.consumed;
+}
+
+void readItem(QDataStream &stream, ToDoItem *item)
+{
+    stream >> item->id >> item->parentId >> item->done >> item->description >> item->tags >> item->version
+           >> item->due >> item->priority >> item->created >> item->modified >> item->completed;
+    QString recurrence;
+    stream >> recurrence >> item->seriesId >> item->occurrence >> item->attachments
+           >> item->duplicateOf >> item->consumed;
+    item->recurrence = Recurrence::parse(recurrence);
+}
+
+bool writeHeader(QFileDevice *file, const ListFile::Header &header)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    setUpStream(stream);
+    stream << Magic << FormatVersion << header.identity << header.version << header.nextId
+           << header.snapshotEnd << header.end << header.recordCount;
+    data.resize(HeaderSize, '\0');
+
+    return file->seek(0) && file->write(data) == HeaderSize;
+}
+
+} // namespace
+
+bool ListFile::write(QFileDevice *file, const ListContents &contents)
+{
+    Header header;
+    header.identity = contents.identity;
+    header.version = contents.version;
+    header.nextId = contents.nextId;
+    if (!writeHeader(file, header))
+        return false;
+
+    QDataStream stream(file);
+    setUpStream(stream);
+    stream << contents.tagNames << quint32(contents.items.size());
+    for (const ToDoItem &item : contents.items) {
+        writeItem(stream, item);
+        stream << contents.customFields.value(item.id);
+    }
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    header.snapshotEnd = header.end = quint64(file->pos());
+    return writeHeader(file, header);
+}
+
+bool ListFile::read(QIODevice *device, ListContents *contents, QString *error)
+{
+    Header header;
+    if (!readHeader(device, &header)) {
+        *error = QStringLiteral("Not a list file or unsupported format version");
+        return false;
+    }
+
+    contents->identity = header.identity;
+    contents->version = header.version;
+    contents->nextId = header.nextId;
+
+    QDataStream stream(device);
+    setUpStream(stream);
+
+    quint32 count = 0;
+    stream >> contents->tagNames >> count;
+
+    contents->items.clear();
+    contents->items.reserve(int(std::min<quint32>(count, 1 << 20)));
+    contents->customFields.clear();
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        ToDoItem item;
+        QVariantHash fields;
+        readItem(stream, &item);
+        stream >> fields;
+        contents->items.append(item);
+        if (!fields.isEmpty())
+            contents->customFields.insert(item.id, fields);
+    }
+
+    // Records are counted rather than measured, so this works on
+    // sequential devices too.
+    if (header.recordCount) {
+        QHash<quint32, int> indexById;
+        indexById.reserve(contents->items.size());
+        for (int i = 0; i < contents->items.size(); ++i)
+            indexById.insert(contents->items.at(i).id, i);
+
+        QSet<quint32> removed;
+        for (quint32 i = 0; i < header.recordCount && stream.status() == QDataStream::Ok; ++i) {
+            quint8 type = 0;
+            stream >> type;
+            if (type == UpsertRecord) {
+                ToDoItem item;
+                QVariantHash fields;
+                readItem(stream, &item);
+                stream >> fields;
+                if (fields.isEmpty())
+                    contents->customFields.remove(item.id);
+                else
+                    contents->customFields.insert(item.id, fields);
+                const int index = indexById.value(item.id, -1);
+                if (index >= 0) {
+                    contents->items[index] = item;
+                } else {
+                    indexById.insert(item.id, contents->items.size());
+                    contents->items.append(item);
+                }
+            } else if (type == RemoveRecord) {
+                quint32 id = 0;
+                stream >> id;
+                removed.insert(id);
+            } else if (type == TagsRecord) {
+                QStringList names;
+                stream >> names;
+                contents->tagNames += names;
+            } else {
+                stream.setStatus(QDataStream::ReadCorruptData);
+            }
+        }
+
+        if (!removed.isEmpty()) {
+            contents->items.removeIf([&removed](const ToDoItem &item) {
+                return removed.contains(item.id);
+            });
+            for (const quint32 id : std::as_const(removed))
+                contents->customFields.remove(id);
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        *error = QStringLiteral("Truncated or corrupt list file");
+        return false;
+    }
+    return true;
+}
+
+bool ListFile::readHeader(QIODevice *device, Header *header)
+{
+    const QByteArray data = device->read(HeaderSize);
+    if (data.size() != HeaderSize)
+        return false;
+
+    QDataStream stream(data);
+    setUpStream(stream);
+    quint32 magic = 0;
+    quint32 format = 0;
+    stream >> magic >> format >> header->identity >> header->version >> header->nextId
+           >> header->snapshotEnd >> header->end >> header->recordCount;
+    return stream.status() == QDataStream::Ok && magic == Magic && format == FormatVersion;
+}
+
+bool ListFile::append(QFileDevice *file, const ListChanges &changes, QString *error)
+{
+    Header header;
+    if (!file->seek(0) || !readHeader(file, &header)) {
+        *error = QStringLiteral("Not a list file or unsupported format version");
+        return false;
+    }
+
+    // Anything past the end marker is left over from a torn append.
+    if (!file->seek(qint64(header.end))) {
+        *error = file->errorString();
+        return false;
+    }
+
+    QDataStream stream(file);
+    setUpStream(stream);
+    if (!changes.addedTagNames.isEmpty()) {
+        stream << quint8(TagsRecord) << changes.addedTagNames;
+        ++header.recordCount;
+    }
+    for (const quint32 id : changes.removals)
+        stream << quint8(RemoveRecord) << id;
+    header.recordCount += quint32(changes.removals.size());
+    for (const ToDoItem &item : changes.upserts) {
+        stream << quint8(UpsertRecord);
+        writeItem(stream, item);
+        stream << changes.customFields.value(item.id);
+    }
+    header.recordCount += quint32(changes.upserts.size());
+
+    // The records must be durable before the header points past them, or a
+    // crash could leave an end marker over data that never made it to disk.
+    if (stream.status() != QDataStream::Ok || !sync(file)) {
+        *error = file->errorString();
+        return false;
+    }
+
+    header.end = quint64(file->pos());
+    header.version = changes.version;
+    header.nextId = changes.nextId;
+    if (!writeHeader(file, header) || !sync(file)) {
+        *error = file->errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef LISTFILE_H
+#define LISTFILE_H
+
+#include <QHash>
+#include <QStringList>
+#include <QUuid>
+#include <QVariant>
+#include <QVector>
+
+#include "ToDoList.h"
+
+class QFileDevice;
+class QIODevice;
+
+// Everything a list file stores; item tags index into tagNames, from 1.
+struct ListContents
+{
+    QUuid identity;
+    quint64 version = 0;
+    quint32 nextId = 1;
+    QStringList tagNames;
+    QVector<ToDoItem> items;
+    QHash<quint32, QVariantHash> customFields; // by item id, see CustomFieldStore
+};
+
+// What changed since a list file was last written.
+struct ListChanges
+{
+    quint64 version = 0;
+    quint32 nextId = 1;
+    QStringList addedTagNames;
+    QVector<ToDoItem> upserts; // in row order; unknown ids are appended
+    QHash<quint32, QVariantHash> customFields; // of the upserts, which replace the stored ones
+    QVector<quint32> removals;
+};
+
+// On-disk representation of a ToDoList.
+//
+// A fixed-size header, rewritten in place, is followed by a full snapshot
+// of the list and an append region of change records. append() writes the
+// records first and only then moves the header's end marker past them, so
+// a torn append is never read back. write() compacts everything into a
+// new snapshot.
+class ListFile
+{
+public:
+    struct Header
+    {
+        QUuid identity;
+        quint64 version = 0;
+        quint32 nextId = 1;
+        quint64 snapshotEnd = 0;
+        quint64 end = 0;
+        quint32 recordCount = 0;
+    };
+
+    static bool write(QFileDevice *file, const ListContents &contents);
+    static bool read(QIODevice *device, ListContents *contents, QString *error);
+
+    static bool readHeader(QIODevice *device, Header *header);
+    static bool append(QFileDevice *file, const ListChanges &changes, QString *error);
+};
+
+#endif // LISTFILE_H
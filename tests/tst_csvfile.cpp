@@ -0,0 +1,86 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "CsvFile.h"
+#include "ToDoList.h"
+
+namespace {
+
+constexpr qsizetype ChunkSize = qsizetype(1) << 20;
+constexpr qsizetype WindowSize = qsizetype(32) << 20;
+
+}
+
+class TestCsvFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void quotedNewlinesAcrossBoundaries();
+};
+
+// Records with quoted newlines are placed so that a chunk and a window
+// boundary fall inside their quotes, right on a newline; the parser must
+// neither start a record there nor lose one.
+void TestCsvFile::quotedNewlinesAcrossBoundaries()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("items.csv"));
+
+    const QByteArray header = "done,description,tags\n";
+    const QVector<qsizetype> boundaries = {
+        header.size() + ChunkSize,
+        header.size() + 2 * ChunkSize,
+        header.size() + WindowSize,
+    };
+
+    QByteArray data = header;
+    QStringList expected;
+    QVector<int> straddling;
+    const QByteArray filler(1000, 'a');
+    for (int boundary = 0; boundary < boundaries.size(); ) {
+        const qsizetype at = boundaries.at(boundary);
+        if (at - data.size() < 2 * filler.size()) {
+            // done,"<pad>\n<rest>, with ""quotes""",tag with the newline at the boundary
+            const QByteArray pad(at - data.size() - 3, 'p');
+            const QByteArray rest = "line " + QByteArray::number(boundary);
+            data += "0,\"" + pad + "\n" + rest + ", with \"\"quotes\"\"\",tag\n";
+            straddling.append(expected.size());
+            expected.append(QString::fromLatin1(pad + "\n" + rest + ", with \"quotes\""));
+            ++boundary;
+        } else {
+            const QByteArray description = QByteArray::number(expected.size()) + ' ' + filler;
+            data += "1," + description + ",\n";
+            expected.append(QString::fromLatin1(description));
+        }
+    }
+    for (int i = 0; i < 16; ++i) {
+        const QByteArray description = "tail " + QByteArray::number(i);
+        data += "1,\"" + description + "\nsecond line\",\n";
+        expected.append(QString::fromLatin1(description + "\nsecond line"));
+    }
+    QVERIFY(data.size() > WindowSize);
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(data), data.size());
+    file.close();
+
+    ToDoList list;
+    QString error;
+    QVERIFY2(CsvFile::read(path, &list, &error), qPrintable(error));
+
+    const QVector<ToDoItem> items = list.items();
+    QCOMPARE(items.size(), expected.size());
+    for (int i = 0; i < items.size(); ++i)
+        QCOMPARE(items.at(i).description, expected.at(i));
+    for (const int index : std::as_const(straddling)) {
+        QVERIFY(!items.at(index).done);
+        QCOMPARE(list.tagNames(items.at(index).tags), QStringList { QStringLiteral("tag") });
+    }
+}
+
+QTEST_GUILESS_MAIN(TestCsvFile)
+#include "tst_csvfile.moc"
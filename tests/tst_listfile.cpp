@@ -0,0 +1,273 @@
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QtTest>
+
+#include "ListFile.h"
+#include "ToDoList.h"
+
+class TestListFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void writeRead();
+    void appendRead();
+    void tornAppendIgnored();
+    void saveAppendReload();
+
+private:
+    static ToDoItem item(quint32 id, const QString &description);
+    static ListContents contents();
+    static void compare(const ToDoItem &actual, const ToDoItem &expected);
+};
+
+ToDoItem TestListFile::item(quint32 id, const QString &description)
+{
+    ToDoItem item;
+    item.done = false;
+    item.description = description;
+    item.id = id;
+    item.version = id;
+    item.created = 1760000000000 + id;
+    item.modified = item.created;
+    return item;
+}
+
+// A bit of everything a list file stores.
+ListContents TestListFile::contents()
+{
+    ListContents contents;
+    contents.identity = QUuid::createUuid();
+    contents.version = 7;
+    contents.nextId = 5;
+    contents.tagNames = QStringList { QStringLiteral("home"), QStringLiteral("work") };
+
+    ToDoItem series = item(1, QStringLiteral("Water the plants"));
+    series.tags = { 1 };
+    series.due = 1760090000000;
+    series.priority = 2;
+    series.recurrence = Recurrence::parse(QStringLiteral("FREQ=WEEKLY;BYDAY=MO,TH;COUNT=10"));
+    series.consumed = { 1760090000000, 1760350000000 };
+    contents.items.append(series);
+
+    ToDoItem occurrence = item(2, QStringLiteral("Water the plants"));
+    occurrence.done = true;
+    occurrence.completed = 1760095000000;
+    occurrence.seriesId = 1;
+    occurrence.occurrence = 1760090000000;
+    contents.items.append(occurrence);
+
+    ToDoItem child = item(3, QStringLiteral("Buy \"fertilizer\"\nand pots"));
+    child.parentId = 1;
+    child.tags = { 1, 2 };
+    child.attachments = QStringList { QStringLiteral("ab12"), QStringLiteral("cd34") };
+    contents.items.append(child);
+
+    ToDoItem duplicate = item(4, QStringLiteral("water the plants"));
+    duplicate.duplicateOf = 1;
+    contents.items.append(duplicate);
+
+    contents.customFields.insert(1, QVariantHash { { QStringLiteral("estimate"), 15 } });
+    contents.customFields.insert(3, QVariantHash { { QStringLiteral("shop"), QStringLiteral("Garden centre") },
+                                                   { QStringLiteral("estimate"), 40 } });
+    return contents;
+}
+
+void TestListFile::compare(const ToDoItem &actual, const ToDoItem &expected)
+{
+    QCOMPARE(actual.id, expected.id);
+    QCOMPARE(actual.parentId, expected.parentId);
+    QCOMPARE(actual.done, expected.done);
+    QCOMPARE(actual.description, expected.description);
+    QCOMPARE(actual.tags, expected.tags);
+    QCOMPARE(actual.version, expected.version);
+    QCOMPARE(actual.due, expected.due);
+    QCOMPARE(actual.priority, expected.priority);
+    QCOMPARE(actual.created, expected.created);
+    QCOMPARE(actual.modified, expected.modified);
+    QCOMPARE(actual.completed, expected.completed);
+    QCOMPARE(actual.recurrence.toString(), expected.recurrence.toString());
+    QCOMPARE(actual.seriesId, expected.seriesId);
+    QCOMPARE(actual.occurrence, expected.occurrence);
+    QCOMPARE(actual.consumed, expected.consumed);
+    QCOMPARE(actual.attachments, expected.attachments);
+    QCOMPARE(actual.duplicateOf, expected.duplicateOf);
+}
+
+void TestListFile::writeRead()
+{
+    const ListContents written = contents();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QVERIFY(ListFile::write(&file, written));
+
+    QVERIFY(file.seek(0));
+    ListContents read;
+    QString error;
+    QVERIFY2(ListFile::read(&file, &read, &error), qPrintable(error));
+
+    QCOMPARE(read.identity, written.identity);
+    QCOMPARE(read.version, written.version);
+    QCOMPARE(read.nextId, written.nextId);
+    QCOMPARE(read.tagNames, written.tagNames);
+    QCOMPARE(read.items.size(), written.items.size());
+    for (int i = 0; i < read.items.size(); ++i) {
+        compare(read.items.at(i), written.items.at(i));
+        if (QTest::currentTestFailed())
+            return;
+    }
+    QCOMPARE(read.customFields, written.customFields);
+}
+
+void TestListFile::appendRead()
+{
+    ListContents expected = contents();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QVERIFY(ListFile::write(&file, expected));
+
+    // An edit, an addition and a removal, in two appends.
+    ListChanges first;
+    first.version = 8;
+    first.nextId = 6;
+    first.addedTagNames = QStringList { QStringLiteral("garden") };
+    ToDoItem edited = expected.items.at(2);
+    edited.description = QStringLiteral("Buy fertilizer");
+    edited.tags = { 3 };
+    edited.version = 8;
+    first.upserts.append(edited);
+    first.customFields.insert(edited.id, QVariantHash { { QStringLiteral("estimate"), 30 } });
+    ToDoItem added = item(5, QStringLiteral("Repot the ficus"));
+    added.version = 8;
+    first.upserts.append(added);
+    QString error;
+    QVERIFY2(ListFile::append(&file, first, &error), qPrintable(error));
+
+    ListChanges second;
+    second.version = 9;
+    second.nextId = 6;
+    second.removals = { 2 };
+    QVERIFY2(ListFile::append(&file, second, &error), qPrintable(error));
+
+    expected.version = 9;
+    expected.nextId = 6;
+    expected.tagNames.append(QStringLiteral("garden"));
+    expected.items[2] = edited;
+    expected.items.append(added);
+    expected.items.removeAt(1);
+    expected.customFields.insert(edited.id, QVariantHash { { QStringLiteral("estimate"), 30 } });
+
+    QVERIFY(file.seek(0));
+    ListFile::Header header;
+    QVERIFY(ListFile::readHeader(&file, &header));
+    QCOMPARE(header.recordCount, quint32(4));
+    QCOMPARE(header.version, quint64(9));
+    QVERIFY(header.end > header.snapshotEnd);
+
+    QVERIFY(file.seek(0));
+    ListContents read;
+    QVERIFY2(ListFile::read(&file, &read, &error), qPrintable(error));
+    QCOMPARE(read.version, expected.version);
+    QCOMPARE(read.nextId, expected.nextId);
+    QCOMPARE(read.tagNames, expected.tagNames);
+    QCOMPARE(read.items.size(), expected.items.size());
+    for (int i = 0; i < read.items.size(); ++i) {
+        compare(read.items.at(i), expected.items.at(i));
+        if (QTest::currentTestFailed())
+            return;
+    }
+    QCOMPARE(read.customFields, expected.customFields);
+}
+
+// Bytes past the end marker, as a crash in the middle of an append leaves
+// them, are not read back, and the next append writes over them.
+void TestListFile::tornAppendIgnored()
+{
+    ListContents expected = contents();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QVERIFY(ListFile::write(&file, expected));
+    QVERIFY(file.seek(file.size()));
+    QVERIFY(file.write(QByteArray(100, '\x01')) == 100);
+    QVERIFY(file.flush());
+
+    QVERIFY(file.seek(0));
+    ListContents read;
+    QString error;
+    QVERIFY2(ListFile::read(&file, &read, &error), qPrintable(error));
+    QCOMPARE(read.items.size(), expected.items.size());
+
+    ListChanges changes;
+    changes.version = 8;
+    changes.nextId = 5;
+    changes.removals = { 4 };
+    QVERIFY2(ListFile::append(&file, changes, &error), qPrintable(error));
+
+    QVERIFY(file.seek(0));
+    QVERIFY2(ListFile::read(&file, &read, &error), qPrintable(error));
+    QCOMPARE(read.items.size(), expected.items.size() - 1);
+    QCOMPARE(read.items.last().id, quint32(3));
+}
+
+// Through ToDoList: the first save writes a snapshot, the next one appends
+// the changes, and loading the file gives back the same list.
+void TestListFile::saveAppendReload()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("list.todo"));
+
+    ToDoList list;
+    QVector<ToDoItem> items;
+    for (int i = 0; i < 50; ++i) {
+        ToDoItem item;
+        item.done = i % 5 == 0;
+        item.description = QStringLiteral("Item %1").arg(i);
+        item.tags = list.internTags(QStringList { QStringLiteral("tag%1").arg(i % 3) });
+        item.priority = i % 4;
+        items.append(item);
+    }
+    list.appendItems(items);
+    QVERIFY(list.setCustomField(1, QStringLiteral("estimate"), 15));
+    QVERIFY2(list.save(path), qPrintable(list.errorString()));
+
+    ToDoItem edited = list.items().at(2);
+    edited.description = QStringLiteral("Item 2, edited");
+    edited.due = 1760090000000;
+    edited.tags = list.internTags(QStringList { QStringLiteral("new tag") });
+    QVERIFY(list.setItemAt(2, edited));
+    QVERIFY(list.setCustomField(3, QStringLiteral("owner"), QStringLiteral("sam")));
+    ToDoItem added;
+    added.done = false;
+    added.description = QStringLiteral("Added after the first save");
+    list.appendItems({ added });
+    list.removeCompletedItems();
+    QVERIFY2(list.save(path), qPrintable(list.errorString()));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    ListFile::Header header;
+    QVERIFY(ListFile::readHeader(&file, &header));
+    QVERIFY(header.recordCount > 0);
+    file.close();
+
+    ToDoList reloaded;
+    QVERIFY2(reloaded.load(path), qPrintable(reloaded.errorString()));
+
+    const QVector<ToDoItem> expected = list.items();
+    const QVector<ToDoItem> actual = reloaded.items();
+    QCOMPARE(actual.size(), expected.size());
+    for (int i = 0; i < actual.size(); ++i) {
+        QCOMPARE(actual.at(i).id, expected.at(i).id);
+        QCOMPARE(actual.at(i).done, expected.at(i).done);
+        QCOMPARE(actual.at(i).description, expected.at(i).description);
+        QCOMPARE(reloaded.tagNames(actual.at(i).tags), list.tagNames(expected.at(i).tags));
+        QCOMPARE(actual.at(i).due, expected.at(i).due);
+        QCOMPARE(actual.at(i).priority, expected.at(i).priority);
+        QCOMPARE(reloaded.customField(i, QStringLiteral("estimate")), list.customField(i, QStringLiteral("estimate")));
+        QCOMPARE(reloaded.customField(i, QStringLiteral("owner")), list.customField(i, QStringLiteral("owner")));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestListFile)
+#include "tst_listfile.moc"
@@ -0,0 +1,84 @@
+#include <QDateTime>
+#include <QtTest>
+
+#include "Recurrence.h"
+
+namespace {
+
+const QTime TimeOfDay(9, 30);
+
+// A Wednesday.
+const QDate Start(2026, 10, 14);
+
+qint64 at(const QDate &date)
+{
+    return QDateTime(date, TimeOfDay).toMSecsSinceEpoch();
+}
+
+}
+
+class TestRecurrence : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void weeklyByDayFromMidWeek_data();
+    void weeklyByDayFromMidWeek();
+    void roundTrip();
+};
+
+void TestRecurrence::weeklyByDayFromMidWeek_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<QDate>("from");
+    QTest::addColumn<QList<QDate>>("expected");
+
+    QTest::newRow("start day listed")
+        << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,WE,FR;COUNT=5") << Start
+        << QList<QDate> { { 2026, 10, 14 }, { 2026, 10, 16 }, { 2026, 10, 19 }, { 2026, 10, 21 }, { 2026, 10, 23 } };
+    // Days of the first week before the start neither occur nor count.
+    QTest::newRow("all listed days before start")
+        << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,TU;COUNT=3") << Start
+        << QList<QDate> { { 2026, 10, 19 }, { 2026, 10, 20 }, { 2026, 10, 26 } };
+    QTest::newRow("start day not listed")
+        << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,TH;COUNT=3") << Start
+        << QList<QDate> { { 2026, 10, 15 }, { 2026, 10, 19 }, { 2026, 10, 22 } };
+    QTest::newRow("every other week")
+        << QStringLiteral("FREQ=WEEKLY;INTERVAL=2;BYDAY=TH,SU;COUNT=4") << Start
+        << QList<QDate> { { 2026, 10, 15 }, { 2026, 10, 18 }, { 2026, 10, 29 }, { 2026, 11, 1 } };
+    // The window starts in a later week; the count still runs from the start.
+    QTest::newRow("window after start")
+        << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,WE,FR;COUNT=5") << QDate(2026, 10, 19)
+        << QList<QDate> { { 2026, 10, 19 }, { 2026, 10, 21 }, { 2026, 10, 23 } };
+    QTest::newRow("window after count")
+        << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,WE,FR;COUNT=5") << QDate(2026, 10, 24) << QList<QDate>();
+}
+
+void TestRecurrence::weeklyByDayFromMidWeek()
+{
+    QFETCH(QString, rule);
+    QFETCH(QDate, from);
+    QFETCH(QList<QDate>, expected);
+
+    QCOMPARE(Start.dayOfWeek(), 3);
+    const Recurrence recurrence = Recurrence::parse(rule);
+    QVERIFY(recurrence.isValid());
+
+    QVector<qint64> times;
+    for (const QDate &date : std::as_const(expected))
+        times.append(at(date));
+
+    const qint64 windowStart = QDateTime(from, QTime(0, 0)).toMSecsSinceEpoch();
+    const qint64 windowEnd = at(Start.addYears(1));
+    QCOMPARE(recurrence.occurrences(at(Start), windowStart, windowEnd, 100), times);
+}
+
+void TestRecurrence::roundTrip()
+{
+    const QString rule = QStringLiteral("FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH;COUNT=10");
+    QCOMPARE(Recurrence::parse(rule).toString(), rule);
+    QVERIFY(!Recurrence::parse(QStringLiteral("FREQ=DAILY;BYDAY=MO")).isValid());
+}
+
+QTEST_GUILESS_MAIN(TestRecurrence)
+#include "tst_recurrence.moc"
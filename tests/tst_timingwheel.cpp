@@ -0,0 +1,158 @@
+#include <QtTest>
+
+#include "TimingWheel.h"
+
+class TestTimingWheel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void stepsAcrossLevels_data();
+    void stepsAcrossLevels();
+    void jumpsAcrossLevels();
+    void reschedulesAndCancels();
+    void beyondTopLevel();
+};
+
+void TestTimingWheel::stepsAcrossLevels_data()
+{
+    QTest::addColumn<quint64>("now");
+
+    QTest::newRow("zero") << quint64(0);
+    QTest::newRow("before level 1") << quint64(60);
+    QTest::newRow("before level 2") << quint64(4090);
+    QTest::newRow("before level 3") << quint64(262140);
+    QTest::newRow("mid level 2") << quint64(5000);
+}
+
+// Ticking one at a time, every id fires at its own tick, whichever levels
+// it cascades through on the way down.
+void TestTimingWheel::stepsAcrossLevels()
+{
+    QFETCH(quint64, now);
+
+    TimingWheel wheel(now);
+    QHash<quint32, quint64> ticks;
+    quint32 id = 1;
+    for (const quint64 offset : { 1, 3, 4, 63, 64, 65, 127, 128, 4095, 4096, 4097, 8191, 8192, 262143, 262144,
+                                  262145, 266240, 300000 }) {
+        ticks.insert(id, now + offset);
+        wheel.schedule(id++, now + offset);
+    }
+    // Offsets from the next boundary of each level rather than from now.
+    for (const int shift : { 6, 12, 18 }) {
+        const quint64 boundary = (now >> shift << shift) + (quint64(1) << shift);
+        for (const qint64 delta : { -1, 0, 1 }) {
+            if (boundary + delta > now) {
+                ticks.insert(id, boundary + delta);
+                wheel.schedule(id++, boundary + delta);
+            }
+        }
+    }
+    QCOMPARE(wheel.size(), ticks.size());
+
+    const quint64 last = now + 300000;
+    for (quint64 tick = now + 1; tick <= last; ++tick) {
+        const QVector<quint32> fired = wheel.advance(tick);
+        for (const quint32 firedId : fired) {
+            QVERIFY(ticks.contains(firedId));
+            QCOMPARE(ticks.take(firedId), tick);
+        }
+        QCOMPARE(wheel.now(), tick);
+    }
+    QVERIFY(ticks.isEmpty());
+    QCOMPARE(wheel.size(), 0);
+    QCOMPARE(wheel.nextTick(), TimingWheel::NoTick);
+}
+
+// A single advance over many levels returns everything in tick order, and
+// nextTick() never skips past a due id.
+void TestTimingWheel::jumpsAcrossLevels()
+{
+    const quint64 now = 4000;
+    TimingWheel wheel(now);
+    QVector<quint64> ticks = { now + 1, 4096, 4097, 4159, 4160, 262143, 262144, 262145,
+                               quint64(1) << 24, (quint64(1) << 24) + 1, (quint64(1) << 30) + 7,
+                               (quint64(1) << 36) - 1 };
+    for (int i = 0; i < ticks.size(); ++i)
+        wheel.schedule(quint32(i + 1), ticks.at(i));
+
+    QVector<quint64> fired;
+    while (wheel.nextTick() != TimingWheel::NoTick) {
+        const quint64 next = wheel.nextTick();
+        QVERIFY(next > wheel.now());
+        for (const quint32 id : wheel.advance(next)) {
+            QVERIFY(ticks.at(id - 1) <= next);
+            QCOMPARE(ticks.at(id - 1), next);
+            fired.append(ticks.at(id - 1));
+        }
+    }
+    QCOMPARE(fired, ticks);
+
+    TimingWheel jump(now);
+    for (int i = 0; i < ticks.size(); ++i)
+        jump.schedule(quint32(i + 1), ticks.at(i));
+    QVector<quint32> expected;
+    for (int i = 0; i < ticks.size(); ++i)
+        expected.append(quint32(i + 1));
+    QCOMPARE(jump.advance(quint64(1) << 40), expected);
+    QCOMPARE(jump.size(), 0);
+}
+
+void TestTimingWheel::reschedulesAndCancels()
+{
+    TimingWheel wheel(100);
+    wheel.schedule(1, 200);
+    wheel.schedule(2, 5000);
+    wheel.schedule(3, 70000);
+    wheel.schedule(1, 4100); // moves from level 1 to level 2
+    wheel.cancel(3);
+    wheel.schedule(4, 50); // already due
+
+    QCOMPARE(wheel.nextTick(), quint64(100));
+    QCOMPARE(wheel.advance(4099), QVector<quint32> { 4 });
+    QCOMPARE(wheel.advance(4100), QVector<quint32> { 1 });
+    QVERIFY(!wheel.contains(3));
+    QCOMPARE(wheel.advance(100000), QVector<quint32> { 2 });
+    QCOMPARE(wheel.size(), 0);
+}
+
+// Ticks 2^36 or more ahead do not fit the six levels; they must neither
+// wrap into a slot at or before now() nor stall advance().
+void TestTimingWheel::beyondTopLevel()
+{
+    // About now in seconds, and due dates thousands of years ahead.
+    const quint64 now = 1760000000;
+    const quint64 span = quint64(1) << 36;
+    const QVector<quint64> ticks = { now + span - 1, now + span, now + span + 1, 2 * span,
+                                     now + 3 * span + 12345, quint64(1) << 40, quint64(1) << 62 };
+
+    TimingWheel wheel(now);
+    for (int i = 0; i < ticks.size(); ++i)
+        wheel.schedule(quint32(i + 1), ticks.at(i));
+
+    QVector<quint64> fired;
+    int steps = 0;
+    while (wheel.nextTick() != TimingWheel::NoTick) {
+        const quint64 next = wheel.nextTick();
+        QVERIFY(next > wheel.now());
+        QVERIFY(++steps < 1000);
+        for (const quint32 id : wheel.advance(next)) {
+            QCOMPARE(ticks.at(id - 1), next);
+            fired.append(ticks.at(id - 1));
+        }
+    }
+    QCOMPARE(fired, ticks);
+
+    TimingWheel jump(now);
+    for (int i = 0; i < ticks.size(); ++i)
+        jump.schedule(quint32(i + 1), ticks.at(i));
+    QCOMPARE(jump.advance(now + 2 * span).size(), 4);
+    QCOMPARE(jump.size(), 3);
+    jump.cancel(6);
+    QCOMPARE(jump.advance(~quint64(0) - 1), (QVector<quint32> { 5, 7 }));
+    QCOMPARE(jump.size(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestTimingWheel)
+#include "tst_timingwheel.moc"
@@ -0,0 +1,325 @@
+#include "ActivitySeries.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+quint64 zigZag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+qint64 unZigZag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+void writeVarint(QByteArray &data, quint64 value)
+{
+    while (value >= 0x80) {
+        data.append(char(value | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
+}
+
+bool readVarint(QByteArrayView data, qsizetype *offset, quint64 *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *offset < data.size(); shift += 7) {
+        const quint8 byte = quint8(data.at((*offset)++));
+        *value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+qint64 floorDiv(qint64 value, qint64 divisor)
+{
+    const qint64 quotient = value / divisor;
+    return quotient * divisor > value ? quotient - 1 : quotient;
+}
+
+}
+
+qint64 ActivitySeries::bucketSize(Resolution resolution)
+{
+    switch(resolution){
+    case Minute:
+        return 60 * 1000;
+    case Hour:
+        return 60 * 60 * 1000;
+    case Day:
+    case ResolutionCount:
+        break;
+    }
+
+    return 24 * 60 * 60 * 1000;
+}
+
+void ActivitySeries::record(Counter counter, qint64 time, quint32 count)
+{
+    for (int r = 0; r < ResolutionCount; ++r) {
+        Rollup &rollup = mRollups[r];
+        const qint64 size = bucketSize(Resolution(r));
+        const qint64 bucket = floorDiv(time, size) * size;
+
+        // Events from before the open bucket (a clock that went back) are
+        // counted in the open bucket rather than rewriting closed blocks.
+        if (rollup.hasOpen && bucket > rollup.open.time) {
+            close(rollup, size, rollup.open);
+            rollup.hasOpen = false;
+        }
+        if (!rollup.hasOpen) {
+            rollup.open = Point();
+            rollup.open.time = bucket;
+            rollup.hasOpen = true;
+        }
+        rollup.open.counts[counter] += count;
+    }
+}
+
+void ActivitySeries::close(Rollup &rollup, qint64 unit, const Point &point)
+{
+    if (rollup.blocks.isEmpty() || rollup.blocks.last().count >= BlockPoints) {
+        Block block;
+        block.first = point.time;
+        writeVarint(block.data, zigZag(point.time / unit));
+        for (int c = 0; c < CounterCount; ++c)
+            writeVarint(block.data, point.counts[c]);
+        rollup.previousDelta = 0;
+        rollup.blocks.append(block);
+    } else {
+        Block &block = rollup.blocks.last();
+        const qint64 delta = (point.time - rollup.previous.time) / unit;
+        writeVarint(block.data, zigZag(delta - rollup.previousDelta));
+        for (int c = 0; c < CounterCount; ++c)
+            writeVarint(block.data, zigZag(qint64(point.counts[c]) - qint64(rollup.previous.counts[c])));
+        rollup.previousDelta = delta;
+    }
+
+    Block &block = rollup.blocks.last();
+    block.last = point.time;
+    ++block.count;
+    rollup.previous = point;
+}
+
+void ActivitySeries::decode(const Block &block, qint64 unit, qint64 from, qint64 to, QVector<Point> *points)
+{
+    const QByteArrayView data(block.data);
+    qsizetype offset = 0;
+    quint64 value = 0;
+    if (!readVarint(data, &offset, &value))
+        return;
+
+    Point point;
+    point.time = unZigZag(value) * unit;
+    for (int c = 0; c < CounterCount; ++c) {
+        if (!readVarint(data, &offset, &value))
+            return;
+        point.counts[c] = quint32(value);
+    }
+
+    qint64 delta = 0;
+    for (int i = 0; ; ) {
+        if (point.time >= to)
+            return;
+        if (point.time >= from)
+            points->append(point);
+        if (++i >= block.count)
+            return;
+
+        if (!readVarint(data, &offset, &value))
+            return;
+        delta += unZigZag(value);
+        point.time += delta * unit;
+        for (int c = 0; c < CounterCount; ++c) {
+            if (!readVarint(data, &offset, &value))
+                return;
+            point.counts[c] = quint32(qint64(point.counts[c]) + unZigZag(value));
+        }
+    }
+}
+
+QVector<ActivitySeries::Point> ActivitySeries::points(Resolution resolution, qint64 from, qint64 to) const
+{
+    QVector<Point> points;
+    if (resolution < 0 || resolution >= ResolutionCount || from >= to)
+        return points;
+
+    const Rollup &rollup = mRollups[resolution];
+    const qint64 unit = bucketSize(resolution);
+    auto it = std::lower_bound(rollup.blocks.cbegin(), rollup.blocks.cend(), from,
+                               [](const Block &block, qint64 time) { return block.last < time; });
+    for (; it != rollup.blocks.cend() && it->first < to; ++it)
+        decode(*it, unit, from, to, &points);
+
+    if (rollup.hasOpen && rollup.open.time >= from && rollup.open.time < to)
+        points.append(rollup.open);
+    return points;
+}
+
+bool ActivitySeries::isEmpty() const
+{
+    return !mRollups[Minute].hasOpen && mRollups[Minute].blocks.isEmpty();
+}
+
+void ActivitySeries::clear()
+{
+    for (Rollup &rollup : mRollups)
+        rollup = Rollup();
+}
+
+QByteArray ActivitySeries::serialize() const
+{
+    QByteArray data;
+    for (const Rollup &rollup : mRollups) {
+        writeBlocks(data, rollup.blocks);
+        writeVarint(data, rollup.hasOpen);
+        if (rollup.hasOpen) {
+            writeVarint(data, zigZag(rollup.open.time));
+            for (int c = 0; c < CounterCount; ++c)
+                writeVarint(data, rollup.open.counts[c]);
+        }
+    }
+    return data;
+}
+
+ActivitySeries ActivitySeries::deserialize(QByteArrayView data)
+{
+    ActivitySeries series;
+    qsizetype offset = 0;
+    quint64 value = 0;
+    const auto read = [&](quint64 *target) { return readVarint(data, &offset, target); };
+
+    for (Rollup &rollup : series.mRollups) {
+        if (!readBlocks(data, &offset, &rollup.blocks))
+            return ActivitySeries();
+
+        if (!read(&value))
+            return ActivitySeries();
+        rollup.hasOpen = value != 0;
+        if (rollup.hasOpen) {
+            if (!read(&value))
+                return ActivitySeries();
+            rollup.open.time = unZigZag(value);
+            for (int c = 0; c < CounterCount; ++c) {
+                if (!read(&value))
+                    return ActivitySeries();
+                rollup.open.counts[c] = quint32(value);
+            }
+        }
+
+        // Pick up the encoder where the last block left off.
+        if (!rollup.blocks.isEmpty()) {
+            const qint64 unit = bucketSize(Resolution(&rollup - series.mRollups));
+            QVector<Point> tail;
+            decode(rollup.blocks.last(), unit, std::numeric_limits<qint64>::min(),
+                   std::numeric_limits<qint64>::max(), &tail);
+            if (tail.size() != rollup.blocks.last().count)
+                return ActivitySeries();
+            rollup.previous = tail.last();
+            if (tail.size() > 1)
+                rollup.previousDelta = (tail.last().time - tail.at(tail.size() - 2).time) / unit;
+        }
+    }
+
+    return series;
+}
+
+QByteArray ActivitySeries::closedSince(Resolution resolution, qint64 since, qint64 *last) const
+{
+    *last = since;
+    const Rollup &rollup = mRollups[resolution];
+    const qint64 unit = bucketSize(resolution);
+    const qint64 to = rollup.hasOpen ? rollup.open.time : std::numeric_limits<qint64>::max();
+    const QVector<Point> points = since < to ? this->points(resolution, since + 1, to) : QVector<Point>();
+
+    // Encoded as blocks of their own, which decode() reads back.
+    Rollup closed;
+    for (const Point &point : points)
+        close(closed, unit, point);
+    if (!points.isEmpty())
+        *last = points.last().time;
+
+    QByteArray data;
+    writeBlocks(data, closed.blocks);
+    return data;
+}
+
+bool ActivitySeries::appendClosed(Resolution resolution, QByteArrayView data)
+{
+    QVector<Block> blocks;
+    qsizetype offset = 0;
+    if (!readBlocks(data, &offset, &blocks) || offset != data.size())
+        return false;
+
+    Rollup &rollup = mRollups[resolution];
+    const qint64 unit = bucketSize(resolution);
+    for (const Block &block : std::as_const(blocks)) {
+        QVector<Point> points;
+        decode(block, unit, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(), &points);
+        if (points.size() != block.count)
+            return false;
+        for (const Point &point : std::as_const(points)) {
+            if (!rollup.blocks.isEmpty() && point.time <= rollup.blocks.last().last)
+                return false;
+            close(rollup, unit, point);
+        }
+    }
+    return true;
+}
+
+bool ActivitySeries::openBucket(Resolution resolution, Point *point) const
+{
+    if (!mRollups[resolution].hasOpen)
+        return false;
+    *point = mRollups[resolution].open;
+    return true;
+}
+
+void ActivitySeries::setOpenBucket(Resolution resolution, const Point &point)
+{
+    mRollups[resolution].open = point;
+    mRollups[resolution].hasOpen = true;
+}
+
+void ActivitySeries::writeBlocks(QByteArray &data, const QVector<Block> &blocks)
+{
+    writeVarint(data, quint64(blocks.size()));
+    for (const Block &block : blocks) {
+        writeVarint(data, zigZag(block.first));
+        writeVarint(data, zigZag(block.last));
+        writeVarint(data, quint64(block.count));
+        writeVarint(data, quint64(block.data.size()));
+        data.append(block.data);
+    }
+}
+
+bool ActivitySeries::readBlocks(QByteArrayView data, qsizetype *offset, QVector<Block> *blocks)
+{
+    quint64 blockCount = 0;
+    if (!readVarint(data, offset, &blockCount) || blockCount > quint64(data.size()))
+        return false;
+
+    for (quint64 i = 0; i < blockCount; ++i) {
+        Block block;
+        quint64 first = 0;
+        quint64 last = 0;
+        quint64 count = 0;
+        quint64 size = 0;
+        if (!readVarint(data, offset, &first) || !readVarint(data, offset, &last)
+            || !readVarint(data, offset, &count) || !readVarint(data, offset, &size)
+            || count == 0 || count > BlockPoints || size > quint64(data.size() - *offset))
+            return false;
+        block.first = unZigZag(first);
+        block.last = unZigZag(last);
+        block.count = int(count);
+        block.data = data.mid(*offset, qsizetype(size)).toByteArray();
+        *offset += qsizetype(size);
+        blocks->append(block);
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+#ifndef ACTIVITYSERIES_H
+#define ACTIVITYSERIES_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVector>
+
+// Counts of list events over time, rolled up per minute, hour and day (UTC).
+//
+// Recording only bumps the open bucket of each resolution. When a bucket
+// closes it is appended to a block of that resolution: the bucket time as a
+// delta-of-delta and the counts as deltas to the previous bucket, all as
+// zig-zag varints, so regular activity takes a byte or two per bucket.
+// Blocks hold up to BlockPoints buckets and know their time span, so a range
+// read skips straight to the first block it needs.
+class ActivitySeries
+{
+public:
+    enum Counter {
+        Created,
+        Completed,
+        Removed,
+        CounterCount
+    };
+
+    enum Resolution {
+        Minute,
+        Hour,
+        Day,
+        ResolutionCount
+    };
+
+    struct Point
+    {
+        qint64 time = 0; // start of the bucket, ms since the epoch
+        quint32 counts[CounterCount] = {};
+    };
+
+    void record(Counter counter, qint64 time, quint32 count = 1);
+
+    // Buckets with activity starting in [from, to), oldest first.
+    QVector<Point> points(Resolution resolution, qint64 from, qint64 to) const;
+
+    bool isEmpty() const;
+    void clear();
+
+    // deserialize() returns an empty series for malformed data.
+    QByteArray serialize() const;
+    static ActivitySeries deserialize(QByteArrayView data);
+
+    // The closed buckets after since, encoded as blocks, and the time of the
+    // last of them through last. appendClosed() adds such data after the
+    // closed buckets so far; false for malformed data. ActivityFile appends
+    // closed buckets to its file this way.
+    QByteArray closedSince(Resolution resolution, qint64 since, qint64 *last) const;
+    bool appendClosed(Resolution resolution, QByteArrayView data);
+
+    // The bucket still counting events, if any.
+    bool openBucket(Resolution resolution, Point *point) const;
+    void setOpenBucket(Resolution resolution, const Point &point);
+
+    static qint64 bucketSize(Resolution resolution);
+
+private:
+    static constexpr int BlockPoints = 256;
+
+    struct Block
+    {
+        qint64 first = 0;
+        qint64 last = 0;
+        int count = 0;
+        QByteArray data;
+    };
+
+    struct Rollup
+    {
+        QVector<Block> blocks;
+        Point open;
+        bool hasOpen = false;
+        // Encoder state of the last block.
+        qint64 previousDelta = 0;
+        Point previous;
+    };
+
+    static void close(Rollup &rollup, qint64 unit, const Point &point);
+    static void decode(const Block &block, qint64 unit, qint64 from, qint64 to, QVector<Point> *points);
+    static void writeBlocks(QByteArray &data, const QVector<Block> &blocks);
+    static bool readBlocks(QByteArrayView data, qsizetype *offset, QVector<Block> *blocks);
+
+    Rollup mRollups[ResolutionCount];
+};
+
+#endif // ACTIVITYSERIES_H
@@ -0,0 +1,86 @@
+#include "BitmapIndex.h"
+
+void BitmapIndex::add(quint32 key, quint32 id)
+{
+    if (RoaringBitmap *bitmap = load(key))
+        bitmap->add(id);
+    else
+        mBitmaps[key].add(id);
+}
+
+void BitmapIndex::remove(quint32 key, quint32 id)
+{
+    RoaringBitmap *bitmap = load(key);
+    if (!bitmap)
+        return;
+
+    bitmap->remove(id);
+    if (bitmap->isEmpty())
+        mBitmaps.erase(key);
+}
+
+const RoaringBitmap &BitmapIndex::bitmap(quint32 key) const
+{
+    static const RoaringBitmap empty;
+
+    const RoaringBitmap *bitmap = load(key);
+    return bitmap ? *bitmap : empty;
+}
+
+bool BitmapIndex::contains(quint32 key) const
+{
+    return load(key) != nullptr;
+}
+
+QList<quint32> BitmapIndex::keys() const
+{
+    QList<quint32> keys;
+    keys.reserve(int(mBitmaps.size()) + mUnloaded.size());
+    for (const auto &entry : mBitmaps)
+        keys.append(entry.first);
+    for (const quint32 key : mUnloaded)
+        keys.append(key);
+    return keys;
+}
+
+void BitmapIndex::clear()
+{
+    mBitmaps.clear();
+    mSource.reset();
+    mUnloaded.clear();
+    mStaleIds.clear();
+}
+
+void BitmapIndex::attach(const QSharedPointer<const BitmapSource> &source, const RoaringBitmap &staleIds)
+{
+    clear();
+
+    mSource = source;
+    mStaleIds = staleIds;
+    const QList<quint32> keys = source->keys();
+    mUnloaded = QSet<quint32>(keys.cbegin(), keys.cend());
+}
+
+void BitmapIndex::detach()
+{
+    const QSet<quint32> unloaded = mUnloaded;
+    for (const quint32 key : unloaded)
+        load(key);
+
+    mSource.reset();
+    mStaleIds.clear();
+}
+
+RoaringBitmap *BitmapIndex::load(quint32 key) const
+{
+    if (mUnloaded.remove(key)) {
+        RoaringBitmap bitmap = mSource->bitmap(key);
+        if (!mStaleIds.isEmpty())
+            bitmap = bitmap.andNot(mStaleIds);
+        if (!bitmap.isEmpty())
+            mBitmaps[key] = bitmap;
+    }
+
+    const auto it = mBitmaps.find(key);
+    return it == mBitmaps.end() ? nullptr : &it->second;
+}
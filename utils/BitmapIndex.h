@@ -0,0 +1,58 @@
+#ifndef BITMAPINDEX_H
+#define BITMAPINDEX_H
+
+#include <QList>
+#include <QSet>
+#include <QSharedPointer>
+
+#include <unordered_map>
+
+#include "RoaringBitmap.h"
+
+// Read-only store of serialized bitmaps, e.g. a section of a mapped file.
+class BitmapSource
+{
+public:
+    virtual ~BitmapSource() = default;
+
+    virtual QList<quint32> keys() const = 0;
+    virtual RoaringBitmap bitmap(quint32 key) const = 0;
+};
+
+// Inverted index from a 32-bit key (tag, token, ...) to the set of item ids
+// carrying it.
+//
+// The index can be attached to a BitmapSource, in which case a key's bitmap
+// is only deserialized when it is first used. Ids listed as stale at attach
+// time are dropped from every bitmap as it is loaded, so the caller only has
+// to add the current postings of those ids back.
+class BitmapIndex
+{
+public:
+    void add(quint32 key, quint32 id);
+    void remove(quint32 key, quint32 id);
+
+    // Empty bitmap for unknown keys.
+    const RoaringBitmap &bitmap(quint32 key) const;
+    bool contains(quint32 key) const;
+
+    QList<quint32> keys() const;
+    void clear();
+
+    void attach(const QSharedPointer<const BitmapSource> &source, const RoaringBitmap &staleIds);
+    // Loads everything still on the source and releases it.
+    void detach();
+
+private:
+    RoaringBitmap *load(quint32 key) const;
+
+    // Node based, so references handed out stay valid while other keys are
+    // loaded lazily.
+    mutable std::unordered_map<quint32, RoaringBitmap> mBitmaps;
+
+    QSharedPointer<const BitmapSource> mSource;
+    mutable QSet<quint32> mUnloaded;
+    RoaringBitmap mStaleIds;
+};
+
+#endif // BITMAPINDEX_H
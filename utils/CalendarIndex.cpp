@@ -0,0 +1,86 @@
+#include "CalendarIndex.h"
+
+#include <QDateTime>
+#include <QTimeZone>
+
+void CalendarIndex::insert(Kind kind, quint32 id, qint64 time)
+{
+    if (mZone.isEmpty())
+        mZone = QTimeZone::systemTimeZoneId();
+
+    const qint64 day = dayOf(time);
+    const auto it = mEntries[kind].find(id);
+    if (it != mEntries[kind].end()) {
+        it->time = time;
+        if (it->day == day)
+            return;
+        removeFromDay(kind, it->day, id);
+        it->day = day;
+    } else {
+        mEntries[kind].insert(id, { time, day });
+    }
+    mDays[kind][day].add(id);
+}
+
+void CalendarIndex::remove(Kind kind, quint32 id)
+{
+    const auto it = mEntries[kind].constFind(id);
+    if (it == mEntries[kind].constEnd())
+        return;
+
+    removeFromDay(kind, it->day, id);
+    mEntries[kind].erase(it);
+}
+
+void CalendarIndex::clear()
+{
+    for (QMap<qint64, RoaringBitmap> &days : mDays)
+        days.clear();
+    for (QHash<quint32, Entry> &entries : mEntries)
+        entries.clear();
+    mZone.clear();
+}
+
+void CalendarIndex::refresh()
+{
+    const QByteArray zone = QTimeZone::systemTimeZoneId();
+    if (mZone.isEmpty() || mZone == zone)
+        return;
+
+    mZone = zone;
+    for (int kind = 0; kind < KindCount; ++kind) {
+        mDays[kind].clear();
+        for (auto it = mEntries[kind].begin(); it != mEntries[kind].end(); ++it) {
+            it->day = dayOf(it->time);
+            mDays[kind][it->day].add(it.key());
+        }
+    }
+}
+
+const RoaringBitmap &CalendarIndex::ids(Kind kind, qint64 day) const
+{
+    static const RoaringBitmap none;
+    const auto it = mDays[kind].constFind(day);
+    return it != mDays[kind].constEnd() ? *it : none;
+}
+
+int CalendarIndex::count(Kind kind, qint64 day) const
+{
+    return int(ids(kind, day).cardinality());
+}
+
+qint64 CalendarIndex::dayOf(qint64 time)
+{
+    return QDateTime::fromMSecsSinceEpoch(time).date().toJulianDay();
+}
+
+void CalendarIndex::removeFromDay(Kind kind, qint64 day, quint32 id)
+{
+    auto it = mDays[kind].find(day);
+    if (it == mDays[kind].end())
+        return;
+
+    it->remove(id);
+    if (it->isEmpty())
+        mDays[kind].erase(it);
+}
@@ -0,0 +1,56 @@
+#ifndef CALENDARINDEX_H
+#define CALENDARINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+
+#include "RoaringBitmap.h"
+
+// Item ids bucketed per local calendar day, separately for due and
+// completion dates. Days are Julian day numbers; only days with items have
+// a bucket.
+//
+// Every id remembers its time and the day it was filed under, so removing
+// it does not depend on the time zone it is removed in. After the system
+// time zone changed, refresh() files all ids under their new local days.
+class CalendarIndex
+{
+public:
+    enum Kind {
+        Due,
+        Completed,
+        KindCount
+    };
+
+    // Files id under the local day of time (ms since the epoch), moving it
+    // from the day it was filed under before.
+    void insert(Kind kind, quint32 id, qint64 time);
+    void remove(Kind kind, quint32 id);
+    void clear();
+
+    // Files all ids again when the system time zone is not the one they
+    // were filed in.
+    void refresh();
+
+    const RoaringBitmap &ids(Kind kind, qint64 day) const;
+    int count(Kind kind, qint64 day) const;
+
+    // The local day of a time in ms since the epoch.
+    static qint64 dayOf(qint64 time);
+
+private:
+    struct Entry
+    {
+        qint64 time;
+        qint64 day;
+    };
+
+    void removeFromDay(Kind kind, qint64 day, quint32 id);
+
+    QMap<qint64, RoaringBitmap> mDays[KindCount];
+    QHash<quint32, Entry> mEntries[KindCount];
+    QByteArray mZone;
+};
+
+#endif // CALENDARINDEX_H
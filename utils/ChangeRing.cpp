@@ -0,0 +1,53 @@
+#include "ChangeRing.h"
+
+#include <algorithm>
+
+ChangeRing::ChangeRing(int capacity)
+    : mEntries(std::max(1, capacity))
+{
+}
+
+void ChangeRing::record(quint64 version, quint32 id, Operation operation)
+{
+    if (mCount == mEntries.size()) {
+        mFloor = mEntries.at(mHead).version;
+        mHead = (mHead + 1) % mEntries.size();
+        --mCount;
+    }
+
+    mEntries[(mHead + mCount) % mEntries.size()] = { version, id, operation };
+    ++mCount;
+}
+
+void ChangeRing::reset(quint64 version)
+{
+    mHead = 0;
+    mCount = 0;
+    mFloor = version;
+}
+
+bool ChangeRing::covers(quint64 version) const
+{
+    return version >= mFloor;
+}
+
+QVector<ChangeRing::Entry> ChangeRing::entriesSince(quint64 version) const
+{
+    // Versions increase along the ring, so the first entry to return can be
+    // found by binary search.
+    int low = 0;
+    int high = mCount;
+    while (low < high) {
+        const int middle = (low + high) / 2;
+        if (mEntries.at((mHead + middle) % mEntries.size()).version <= version)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    QVector<Entry> entries;
+    entries.reserve(mCount - low);
+    for (int i = low; i < mCount; ++i)
+        entries.append(mEntries.at((mHead + i) % mEntries.size()));
+    return entries;
+}
@@ -0,0 +1,44 @@
+#ifndef CHANGERING_H
+#define CHANGERING_H
+
+#include <QVector>
+
+// Bounded history of which id changed at which version, oldest entries
+// dropped first. Versions must be recorded in increasing order.
+class ChangeRing
+{
+public:
+    enum Operation : quint8 {
+        Insert,
+        Update,
+        Delete
+    };
+
+    struct Entry
+    {
+        quint64 version = 0;
+        quint32 id = 0;
+        Operation operation = Update;
+    };
+
+    explicit ChangeRing(int capacity = 1 << 16);
+
+    void record(quint64 version, quint32 id, Operation operation);
+    // Forgets everything; changes up to and including version are no longer
+    // covered.
+    void reset(quint64 version);
+
+    // Whether every change after version is still retained.
+    bool covers(quint64 version) const;
+
+    // Entries after version, oldest first.
+    QVector<Entry> entriesSince(quint64 version) const;
+
+private:
+    QVector<Entry> mEntries;
+    int mHead = 0; // oldest entry
+    int mCount = 0;
+    quint64 mFloor = 0;
+};
+
+#endif // CHANGERING_H
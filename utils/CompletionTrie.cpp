@@ -0,0 +1,228 @@
+#include "CompletionTrie.h"
+
+#include <algorithm>
+#include <queue>
+
+void CompletionTrie::insert(const QString &key, const QString &display, quint64 stamp)
+{
+    if (key.isEmpty())
+        return;
+
+    int node = 0;
+    int offset = 0;
+    while (offset < key.size()) {
+        int child = childStartingWith(node, key.at(offset));
+        if (child < 0) {
+            const int leaf = allocate();
+            mNodes[leaf].edge = key.mid(offset);
+            addChild(node, leaf);
+            node = leaf;
+            break;
+        }
+
+        const QString edge = mNodes.at(child).edge;
+        int common = 0;
+        while (common < edge.size() && offset + common < key.size()
+               && edge.at(common) == key.at(offset + common))
+            ++common;
+
+        if (common < edge.size()) {
+            // Split the edge into parent -> middle -> child.
+            const int middle = allocate();
+            mNodes[middle].edge = edge.left(common);
+            removeChild(node, child);
+            addChild(node, middle);
+            mNodes[child].edge = edge.mid(common);
+            addChild(middle, child);
+            updateBest(middle);
+            child = middle;
+        }
+
+        node = child;
+        offset += common;
+    }
+
+    Node &target = mNodes[node];
+    if (target.own.count == 0)
+        ++mSize;
+    ++target.own.count;
+    target.own.stamp = std::max(target.own.stamp, stamp);
+    target.display = display;
+
+    for (int n = node; n >= 0; n = mNodes.at(n).parent)
+        updateBest(n);
+}
+
+void CompletionTrie::remove(const QString &key)
+{
+    if (key.isEmpty())
+        return;
+
+    int node = 0;
+    int offset = 0;
+    while (offset < key.size()) {
+        node = childStartingWith(node, key.at(offset));
+        if (node < 0)
+            return;
+        const QString &edge = mNodes.at(node).edge;
+        if (QStringView(key).mid(offset, edge.size()) != edge)
+            return;
+        offset += edge.size();
+    }
+
+    Node &target = mNodes[node];
+    if (target.own.count == 0)
+        return;
+
+    if (--target.own.count == 0) {
+        target.own = Score();
+        target.display.clear();
+        --mSize;
+        compact(node);
+        return;
+    }
+
+    for (int n = node; n >= 0; n = mNodes.at(n).parent)
+        updateBest(n);
+}
+
+void CompletionTrie::clear()
+{
+    mNodes = { Node() };
+    mFreeNodes.clear();
+    mSize = 0;
+}
+
+int CompletionTrie::size() const
+{
+    return mSize;
+}
+
+QVector<CompletionTrie::Completion> CompletionTrie::complete(const QString &prefix, int limit) const
+{
+    QVector<Completion> completions;
+    if (limit <= 0)
+        return completions;
+
+    // Find the node whose subtree holds every key starting with prefix; the
+    // prefix may end in the middle of its edge.
+    int node = 0;
+    int offset = 0;
+    while (offset < prefix.size()) {
+        node = childStartingWith(node, prefix.at(offset));
+        if (node < 0)
+            return completions;
+        const QString &edge = mNodes.at(node).edge;
+        const int length = std::min(int(edge.size()), int(prefix.size()) - offset);
+        if (QStringView(prefix).mid(offset, length) != QStringView(edge).left(length))
+            return completions;
+        offset += length;
+    }
+
+    // Best-first walk: subtrees are queued with their best score and keys
+    // with their own, so keys pop out in rank order.
+    struct Entry
+    {
+        Score score;
+        int node;
+        bool key;
+
+        bool operator<(const Entry &other) const { return score < other.score; }
+    };
+
+    std::priority_queue<Entry> queue;
+    if (mNodes.at(node).best.count > 0)
+        queue.push({ mNodes.at(node).best, node, false });
+
+    while (!queue.empty() && completions.size() < limit) {
+        const Entry entry = queue.top();
+        queue.pop();
+
+        const Node &current = mNodes.at(entry.node);
+        if (entry.key) {
+            completions.append({ current.display, current.own.count, current.own.stamp });
+            continue;
+        }
+
+        if (current.own.count > 0)
+            queue.push({ current.own, entry.node, true });
+        for (const int child : current.children)
+            queue.push({ mNodes.at(child).best, child, false });
+    }
+
+    return completions;
+}
+
+int CompletionTrie::childStartingWith(int node, QChar c) const
+{
+    const QVector<int> &children = mNodes.at(node).children;
+    const auto it = std::lower_bound(children.cbegin(), children.cend(), c, [this](int child, QChar value) {
+        return mNodes.at(child).edge.at(0) < value;
+    });
+    if (it == children.cend() || mNodes.at(*it).edge.at(0) != c)
+        return -1;
+    return *it;
+}
+
+void CompletionTrie::addChild(int parent, int child)
+{
+    const QChar first = mNodes.at(child).edge.at(0);
+    QVector<int> &children = mNodes[parent].children;
+    const auto it = std::lower_bound(children.begin(), children.end(), first, [this](int sibling, QChar value) {
+        return mNodes.at(sibling).edge.at(0) < value;
+    });
+    children.insert(it, child);
+    mNodes[child].parent = parent;
+}
+
+void CompletionTrie::removeChild(int parent, int child)
+{
+    mNodes[parent].children.removeOne(child);
+    mNodes[child].parent = -1;
+}
+
+int CompletionTrie::allocate()
+{
+    if (!mFreeNodes.isEmpty())
+        return mFreeNodes.takeLast();
+
+    mNodes.append(Node());
+    return mNodes.size() - 1;
+}
+
+void CompletionTrie::release(int node)
+{
+    mNodes[node] = Node();
+    mFreeNodes.append(node);
+}
+
+void CompletionTrie::updateBest(int node)
+{
+    Node &current = mNodes[node];
+    Score best = current.own;
+    for (const int child : current.children)
+        best = std::max(best, mNodes.at(child).best);
+    current.best = best;
+}
+
+void CompletionTrie::compact(int node)
+{
+    // Drops a node that no longer ends a key and has no children, and merges
+    // a keyless node with its only child, so the trie stays a radix trie.
+    while (node > 0 && mNodes.at(node).own.count == 0 && mNodes.at(node).children.size() <= 1) {
+        const int parent = mNodes.at(node).parent;
+        removeChild(parent, node);
+
+        if (mNodes.at(node).children.size() == 1) {
+            const int child = mNodes.at(node).children.first();
+            mNodes[child].edge.prepend(mNodes.at(node).edge);
+            addChild(parent, child);
+        }
+
+        release(node);
+        node = parent;
+    }
+
+    for (int n = node; n >= 0; n = mNodes.at(n).parent)
+        updateBest(n);
+}
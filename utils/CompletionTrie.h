@@ -0,0 +1,65 @@
+#ifndef COMPLETIONTRIE_H
+#define COMPLETIONTRIE_H
+
+#include <QString>
+#include <QVector>
+
+// Radix trie over normalized strings with a use count and a recency stamp
+// per string. Every node caches the best (count, stamp) of its subtree, so
+// the top-K completions of a prefix come out of a best-first walk that
+// only visits the branches that can still contribute.
+class CompletionTrie
+{
+public:
+    struct Completion
+    {
+        QString text;
+        int count = 0;
+        quint64 stamp = 0;
+    };
+
+    // display is returned by complete() for key; the latest one wins.
+    void insert(const QString &key, const QString &display, quint64 stamp);
+    void remove(const QString &key);
+    void clear();
+
+    int size() const;
+
+    QVector<Completion> complete(const QString &prefix, int limit) const;
+
+private:
+    struct Score
+    {
+        int count = 0;
+        quint64 stamp = 0;
+
+        bool operator<(const Score &other) const
+        {
+            return count != other.count ? count < other.count : stamp < other.stamp;
+        }
+    };
+
+    struct Node
+    {
+        QString edge; // label of the edge leading to this node
+        int parent = -1;
+        QVector<int> children; // sorted by the first character of their edge
+        Score own;             // count == 0 when no key ends here
+        Score best;            // best score in the subtree, own included
+        QString display;
+    };
+
+    int childStartingWith(int node, QChar c) const;
+    void addChild(int parent, int child);
+    void removeChild(int parent, int child);
+    int allocate();
+    void release(int node);
+    void updateBest(int node);
+    void compact(int node);
+
+    QVector<Node> mNodes{ Node() }; // node 0 is the root
+    QVector<int> mFreeNodes;
+    int mSize = 0;
+};
+
+#endif // COMPLETIONTRIE_H
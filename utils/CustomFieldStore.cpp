@@ -0,0 +1,179 @@
+#include "CustomFieldStore.h"
+
+#include <algorithm>
+
+QStringList CustomFieldStore::fieldNames() const
+{
+    QStringList names;
+    names.reserve(mColumns.size());
+    for (const Column &column : mColumns)
+        names.append(column.name);
+    return names;
+}
+
+int CustomFieldStore::fieldIndex(const QString &name) const
+{
+    return mFieldIndex.value(name, -1);
+}
+
+QVariant CustomFieldStore::value(quint32 id, int field) const
+{
+    if (field < 0 || field >= mColumns.size())
+        return QVariant();
+    return columnValue(mColumns.at(field), id);
+}
+
+QVariant CustomFieldStore::value(quint32 id, const QString &name) const
+{
+    return value(id, fieldIndex(name));
+}
+
+bool CustomFieldStore::setValue(quint32 id, const QString &name, const QVariant &value)
+{
+    int field = fieldIndex(name);
+    if (field < 0) {
+        if (name.isEmpty() || !value.isValid())
+            return false;
+        field = mColumns.size();
+        mColumns.append(Column());
+        mColumns.last().name = name;
+        mFieldIndex.insert(name, field);
+    }
+    return setColumnValue(mColumns[field], id, value);
+}
+
+QVariantHash CustomFieldStore::fields(quint32 id) const
+{
+    QVariantHash fields;
+    for (const Column &column : mColumns) {
+        if (column.ids.contains(id))
+            fields.insert(column.name, columnValue(column, id));
+    }
+    return fields;
+}
+
+bool CustomFieldStore::setFields(quint32 id, const QVariantHash &fields)
+{
+    bool changed = false;
+    for (Column &column : mColumns) {
+        if (!fields.contains(column.name))
+            changed |= setColumnValue(column, id, QVariant());
+    }
+    for (auto it = fields.cbegin(); it != fields.cend(); ++it)
+        changed |= setValue(id, it.key(), it.value());
+    return changed;
+}
+
+void CustomFieldStore::removeItem(quint32 id)
+{
+    for (Column &column : mColumns)
+        setColumnValue(column, id, QVariant());
+}
+
+const RoaringBitmap &CustomFieldStore::ids(const QString &name) const
+{
+    static const RoaringBitmap none;
+    const int field = fieldIndex(name);
+    return field >= 0 ? mColumns.at(field).ids : none;
+}
+
+void CustomFieldStore::clear()
+{
+    mColumns.clear();
+    mFieldIndex.clear();
+}
+
+QVariant CustomFieldStore::columnValue(const Column &column, quint32 id)
+{
+    if (!column.dense)
+        return column.sparse.value(id);
+    if (id < column.base || id - column.base >= quint32(column.values.size()))
+        return QVariant();
+    return column.values.at(int(id - column.base));
+}
+
+bool CustomFieldStore::setColumnValue(Column &column, quint32 id, const QVariant &value)
+{
+    const bool present = column.ids.contains(id);
+    if (!value.isValid()) {
+        if (!present)
+            return false;
+        column.ids.remove(id);
+        if (column.dense)
+            column.values[int(id - column.base)] = QVariant();
+        else
+            column.sparse.remove(id);
+        reshape(column);
+        return true;
+    }
+
+    if (present && columnValue(column, id) == value)
+        return false;
+
+    if (column.dense) {
+        // Growing a dense column towards a far away id would allocate the
+        // whole gap, so such a value goes into a sparse column instead.
+        const quint32 first = std::min(id, column.base);
+        const quint32 last = std::max(id, column.base + quint32(column.values.size()) - 1);
+        const quint64 count = column.ids.cardinality() + (present ? 0 : 1);
+        if (count * 4 < quint64(last - first) + 1) {
+            toSparse(column);
+        } else {
+            if (id < column.base) {
+                column.values.insert(0, int(column.base - id), QVariant());
+                column.base = id;
+            } else if (id - column.base >= quint32(column.values.size())) {
+                column.values.resize(int(id - column.base) + 1);
+            }
+            column.values[int(id - column.base)] = value;
+            column.ids.add(id);
+            return true;
+        }
+    }
+
+    if (column.sparse.isEmpty()) {
+        column.min = column.max = id;
+    } else {
+        column.min = std::min(column.min, id);
+        column.max = std::max(column.max, id);
+    }
+    column.sparse.insert(id, value);
+    column.ids.add(id);
+    reshape(column);
+    return true;
+}
+
+void CustomFieldStore::reshape(Column &column)
+{
+    const quint64 count = column.ids.cardinality();
+    if (column.dense) {
+        while (!column.values.isEmpty() && !column.values.last().isValid())
+            column.values.removeLast();
+        if (count == 0 || count * 4 < quint64(column.values.size()))
+            toSparse(column);
+    } else if (count >= MinDenseValues && count * 2 >= quint64(column.max - column.min) + 1) {
+        toDense(column);
+    }
+}
+
+void CustomFieldStore::toSparse(Column &column)
+{
+    column.sparse.reserve(int(column.ids.cardinality()));
+    column.ids.forEach([&](quint32 id) {
+        column.sparse.insert(id, column.values.at(int(id - column.base)));
+    });
+    column.min = column.base;
+    column.max = column.base + quint32(std::max<qsizetype>(column.values.size(), 1)) - 1;
+    column.values = QVector<QVariant>();
+    column.dense = false;
+}
+
+void CustomFieldStore::toDense(Column &column)
+{
+    column.base = column.min;
+    column.values.resize(int(column.max - column.min) + 1);
+    for (auto it = column.sparse.cbegin(); it != column.sparse.cend(); ++it)
+        column.values[int(it.key() - column.base)] = it.value();
+    column.sparse = QHash<quint32, QVariant>();
+    column.dense = true;
+}
@@ -0,0 +1,69 @@
+#ifndef CUSTOMFIELDSTORE_H
+#define CUSTOMFIELDSTORE_H
+
+#include <QHash>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include "RoaringBitmap.h"
+
+// User defined fields of the items of a list (ticket number, estimate,
+// owner), stored per field rather than per item.
+//
+// A column starts out as a hash from item id to value. Once it holds enough
+// values to fill at least half of its id range it turns into a vector
+// indexed by id - base, which drops the per-value hash overhead for fields
+// most items have; it turns back into a hash when it thins out to a quarter.
+// Either way memory follows the values present, not rows times fields.
+// Every column also keeps a bitmap of the ids that have it.
+class CustomFieldStore
+{
+public:
+    // In order of first use; a field keeps its index until clear().
+    QStringList fieldNames() const;
+    int fieldIndex(const QString &name) const;
+
+    QVariant value(quint32 id, int field) const;
+    QVariant value(quint32 id, const QString &name) const;
+    // An invalid value removes the field from the item. Returns whether
+    // anything changed.
+    bool setValue(quint32 id, const QString &name, const QVariant &value);
+
+    QVariantHash fields(quint32 id) const;
+    // Replaces all fields of the item.
+    bool setFields(quint32 id, const QVariantHash &fields);
+    void removeItem(quint32 id);
+
+    // Ids of the items that have the field.
+    const RoaringBitmap &ids(const QString &name) const;
+
+    void clear();
+
+private:
+    static constexpr int MinDenseValues = 64;
+
+    struct Column
+    {
+        QString name;
+        RoaringBitmap ids;
+        bool dense = false;
+        QHash<quint32, QVariant> sparse;
+        QVector<QVariant> values; // dense, ids from base
+        quint32 base = 0;
+        // Bounds of the sparse ids; removals may leave them loose.
+        quint32 min = 0;
+        quint32 max = 0;
+    };
+
+    static QVariant columnValue(const Column &column, quint32 id);
+    static bool setColumnValue(Column &column, quint32 id, const QVariant &value);
+    static void reshape(Column &column);
+    static void toSparse(Column &column);
+    static void toDense(Column &column);
+
+    QVector<Column> mColumns;
+    QHash<QString, int> mFieldIndex;
+};
+
+#endif // CUSTOMFIELDSTORE_H
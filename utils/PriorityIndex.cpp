@@ -0,0 +1,44 @@
+#include "PriorityIndex.h"
+
+#include <limits>
+
+bool PriorityIndex::MoreUrgent::operator()(const Key &a, const Key &b) const
+{
+    if (a.priority != b.priority)
+        return a.priority > b.priority;
+
+    const qint64 aDue = a.due ? a.due : std::numeric_limits<qint64>::max();
+    const qint64 bDue = b.due ? b.due : std::numeric_limits<qint64>::max();
+    if (aDue != bDue)
+        return aDue < bDue;
+    return a.id < b.id;
+}
+
+void PriorityIndex::insert(const Key &key)
+{
+    mKeys.insert(key);
+}
+
+void PriorityIndex::remove(const Key &key)
+{
+    mKeys.erase(key);
+}
+
+void PriorityIndex::clear()
+{
+    mKeys.clear();
+}
+
+int PriorityIndex::size() const
+{
+    return int(mKeys.size());
+}
+
+QVector<quint32> PriorityIndex::first(int count) const
+{
+    QVector<quint32> ids;
+    ids.reserve(std::min(count, size()));
+    for (auto it = mKeys.cbegin(); it != mKeys.cend() && ids.size() < count; ++it)
+        ids.append(it->id);
+    return ids;
+}
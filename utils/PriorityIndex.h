@@ -0,0 +1,37 @@
+#ifndef PRIORITYINDEX_H
+#define PRIORITYINDEX_H
+
+#include <QVector>
+
+#include <set>
+
+// Ids ordered by urgency: higher priority first, then earlier due time
+// (items without one last), then lower id. Insertions and removals are
+// O(log n); the first n ids are read in O(n).
+class PriorityIndex
+{
+public:
+    struct Key
+    {
+        int priority = 0;
+        qint64 due = 0; // 0 for none
+        quint32 id = 0;
+    };
+
+    void insert(const Key &key);
+    void remove(const Key &key);
+    void clear();
+    int size() const;
+
+    QVector<quint32> first(int count) const;
+
+private:
+    struct MoreUrgent
+    {
+        bool operator()(const Key &a, const Key &b) const;
+    };
+
+    std::set<Key, MoreUrgent> mKeys;
+};
+
+#endif // PRIORITYINDEX_H
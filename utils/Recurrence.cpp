@@ -0,0 +1,190 @@
+#include "Recurrence.h"
+
+#include <QDateTime>
+#include <QStringList>
+#include <QTimeZone>
+
+#include <algorithm>
+
+namespace {
+
+const char *const FrequencyNames[] = { "", "DAILY", "WEEKLY", "MONTHLY", "YEARLY" };
+const char *const WeekdayNames[] = { "MO", "TU", "WE", "TH", "FR", "SA", "SU" };
+
+}
+
+Recurrence Recurrence::parse(const QString &rule)
+{
+    Recurrence recurrence;
+    const QStringList parts = rule.trimmed().toUpper().split(u';', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        const qsizetype equals = part.indexOf(u'=');
+        if (equals < 0)
+            return Recurrence();
+        const QString key = part.left(equals).trimmed();
+        const QString value = part.mid(equals + 1).trimmed();
+
+        bool ok = true;
+        if (key == QLatin1String("FREQ")) {
+            ok = false;
+            for (int f = Daily; f <= Yearly; ++f) {
+                if (value == QLatin1String(FrequencyNames[f])) {
+                    recurrence.mFrequency = Frequency(f);
+                    ok = true;
+                }
+            }
+        } else if (key == QLatin1String("INTERVAL")) {
+            recurrence.mInterval = value.toInt(&ok);
+            ok = ok && recurrence.mInterval > 0;
+        } else if (key == QLatin1String("COUNT")) {
+            recurrence.mCount = value.toInt(&ok);
+            ok = ok && recurrence.mCount > 0;
+        } else if (key == QLatin1String("UNTIL")) {
+            const QDateTime until = QDateTime::fromString(value, Qt::ISODate);
+            ok = until.isValid();
+            recurrence.mUntil = until.toMSecsSinceEpoch();
+        } else if (key == QLatin1String("BYDAY")) {
+            for (const QString &day : value.split(u',', Qt::SkipEmptyParts)) {
+                const auto name = std::find_if(std::begin(WeekdayNames), std::end(WeekdayNames),
+                                               [&](const char *name) { return day.trimmed() == QLatin1String(name); });
+                if (name == std::end(WeekdayNames))
+                    return Recurrence();
+                recurrence.mWeekdays |= quint8(1u << (name - std::begin(WeekdayNames)));
+            }
+        } else {
+            ok = false;
+        }
+        if (!ok)
+            return Recurrence();
+    }
+
+    if (recurrence.mWeekdays && recurrence.mFrequency != Weekly)
+        return Recurrence();
+    return recurrence;
+}
+
+QString Recurrence::toString() const
+{
+    if (!isValid())
+        return QString();
+
+    QStringList parts;
+    parts << QStringLiteral("FREQ=%1").arg(QLatin1String(FrequencyNames[mFrequency]));
+    if (mInterval != 1)
+        parts << QStringLiteral("INTERVAL=%1").arg(mInterval);
+    if (mWeekdays) {
+        QStringList days;
+        for (int d = 0; d < 7; ++d) {
+            if (mWeekdays & (1u << d))
+                days << QLatin1String(WeekdayNames[d]);
+        }
+        parts << QStringLiteral("BYDAY=") + days.join(u',');
+    }
+    if (mCount)
+        parts << QStringLiteral("COUNT=%1").arg(mCount);
+    if (mUntil)
+        parts << QStringLiteral("UNTIL=")
+                     + QDateTime::fromMSecsSinceEpoch(mUntil, QTimeZone::UTC).toString(Qt::ISODate);
+    return parts.join(u';');
+}
+
+bool Recurrence::isValid() const
+{
+    return mFrequency != None;
+}
+
+QVector<qint64> Recurrence::occurrences(qint64 start, qint64 from, qint64 to, int limit) const
+{
+    QVector<qint64> times;
+    if (!isValid() || from >= to || limit <= 0)
+        return times;
+
+    const QDateTime first = QDateTime::fromMSecsSinceEpoch(start);
+    const QDate startDate = first.date();
+    const QTime timeOfDay = first.time();
+    const QDate fromDate = QDateTime::fromMSecsSinceEpoch(std::max(from, start)).date();
+
+    // Weekly rules with days run over whole weeks from the Monday of the
+    // first one; days of that week before the start do not count.
+    const bool byDay = mFrequency == Weekly && mWeekdays;
+    QDate periodStart = startDate;
+    int skipped = 0;
+    int perPeriod = 1;
+    if (byDay) {
+        periodStart = startDate.addDays(1 - startDate.dayOfWeek());
+        perPeriod = 0;
+        for (int d = 0; d < 7; ++d) {
+            if (mWeekdays & (1u << d)) {
+                ++perPeriod;
+                if (d + 1 < startDate.dayOfWeek())
+                    ++skipped;
+            }
+        }
+    }
+
+    const auto periodDate = [&](qint64 period) {
+        switch(mFrequency){
+        case Daily:
+            return periodStart.addDays(period * mInterval);
+        case Weekly:
+            return periodStart.addDays(period * mInterval * 7);
+        case Monthly:
+            return periodStart.addMonths(int(period * mInterval));
+        case Yearly:
+            return periodStart.addYears(int(period * mInterval));
+        case None:
+            break;
+        }
+        return periodStart;
+    };
+
+    // The last period starting before the window, give or take one for
+    // clamped month ends.
+    qint64 period = 0;
+    switch(mFrequency){
+    case Daily:
+        period = periodStart.daysTo(fromDate) / mInterval;
+        break;
+    case Weekly:
+        period = periodStart.daysTo(fromDate) / (7 * mInterval);
+        break;
+    case Monthly:
+        period = ((fromDate.year() - periodStart.year()) * 12 + fromDate.month() - periodStart.month()) / mInterval;
+        break;
+    case Yearly:
+        period = (fromDate.year() - periodStart.year()) / mInterval;
+        break;
+    case None:
+        break;
+    }
+    period = std::max<qint64>(0, period - 1);
+
+    for (;; ++period) {
+        const QDate date = periodDate(period);
+        for (int day = 0, j = 0; day < (byDay ? 7 : 1); ++day) {
+            if (byDay && !(mWeekdays & (1u << day)))
+                continue;
+
+            const qint64 index = period * perPeriod + j++ - skipped;
+            if (index < 0)
+                continue;
+            if (mCount && index >= mCount)
+                return times;
+
+            const qint64 time = QDateTime(date.addDays(day), timeOfDay).toMSecsSinceEpoch();
+            if (time >= to || (mUntil && time > mUntil))
+                return times;
+            if (time >= from) {
+                times.append(time);
+                if (times.size() >= limit)
+                    return times;
+            }
+        }
+    }
+}
+
+bool Recurrence::operator==(const Recurrence &other) const
+{
+    return mFrequency == other.mFrequency && mInterval == other.mInterval && mWeekdays == other.mWeekdays
+           && mCount == other.mCount && mUntil == other.mUntil;
+}
@@ -0,0 +1,48 @@
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+#include <QString>
+#include <QVector>
+
+// Repetition rule of a recurring item, written as a subset of iCalendar
+// RRULE, e.g.
+//
+//   FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH;COUNT=10
+//
+// FREQ is DAILY, WEEKLY, MONTHLY or YEARLY; BYDAY only applies to WEEKLY.
+// UNTIL takes an ISO 8601 date-time. Occurrences keep the local time of day
+// of the first one and are computed for a window only: the first period in
+// the window is found arithmetically, so the cost does not depend on how
+// far the window is from the start.
+class Recurrence
+{
+public:
+    enum Frequency {
+        None,
+        Daily,
+        Weekly,
+        Monthly,
+        Yearly
+    };
+
+    static Recurrence parse(const QString &rule);
+    QString toString() const;
+
+    bool isValid() const;
+
+    // Occurrence times in [from, to) of a series starting at start, all in
+    // ms since the epoch, at most limit of them.
+    QVector<qint64> occurrences(qint64 start, qint64 from, qint64 to, int limit) const;
+
+    bool operator==(const Recurrence &other) const;
+    bool operator!=(const Recurrence &other) const { return !(*this == other); }
+
+private:
+    Frequency mFrequency = None;
+    int mInterval = 1;
+    quint8 mWeekdays = 0; // bit 0 is Monday
+    int mCount = 0;       // 0 for unlimited
+    qint64 mUntil = 0;    // ms since the epoch, 0 for none
+};
+
+#endif // RECURRENCE_H
@@ -0,0 +1,422 @@
+#include "RoaringBitmap.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+
+bool RoaringBitmap::Container::contains(quint16 low) const
+{
+    if (isBitmap())
+        return words.at(low >> 6) & (quint64(1) << (low & 63));
+    return std::binary_search(values.constBegin(), values.constEnd(), low);
+}
+
+void RoaringBitmap::Container::toBitmap()
+{
+    words.fill(0, BitmapWords);
+    for (const quint16 low : values)
+        words[low >> 6] |= quint64(1) << (low & 63);
+    values = QVector<quint16>();
+}
+
+void RoaringBitmap::Container::toArray()
+{
+    QVector<quint16> array;
+    array.reserve(cardinality);
+    for (int w = 0; w < BitmapWords; ++w) {
+        quint64 word = words.at(w);
+        while (word) {
+            array.append(quint16(w * 64 + qCountTrailingZeroBits(word)));
+            word &= word - 1;
+        }
+    }
+    values = array;
+    words = QVector<quint64>();
+}
+
+void RoaringBitmap::Container::optimize()
+{
+    if (isBitmap() && cardinality <= ArrayLimit)
+        toArray();
+    else if (!isBitmap() && cardinality > ArrayLimit)
+        toBitmap();
+}
+
+void RoaringBitmap::add(quint32 value)
+{
+    const quint16 key = quint16(value >> 16);
+    const quint16 low = quint16(value & 0xffff);
+
+    int index = findContainer(key);
+    if (index < 0) {
+        index = -index - 1;
+        Container container;
+        container.key = key;
+        mContainers.insert(index, container);
+    }
+
+    Container &container = mContainers[index];
+    if (container.isBitmap()) {
+        quint64 &word = container.words[low >> 6];
+        const quint64 bit = quint64(1) << (low & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            ++container.cardinality;
+        }
+        return;
+    }
+
+    const auto it = std::lower_bound(container.values.begin(), container.values.end(), low);
+    if (it != container.values.end() && *it == low)
+        return;
+    container.values.insert(it, low);
+    ++container.cardinality;
+    container.optimize();
+}
+
+void RoaringBitmap::remove(quint32 value)
+{
+    const int index = findContainer(quint16(value >> 16));
+    if (index < 0)
+        return;
+
+    const quint16 low = quint16(value & 0xffff);
+    Container &container = mContainers[index];
+    if (container.isBitmap()) {
+        quint64 &word = container.words[low >> 6];
+        const quint64 bit = quint64(1) << (low & 63);
+        if (!(word & bit))
+            return;
+        word &= ~bit;
+    } else {
+        const auto it = std::lower_bound(container.values.begin(), container.values.end(), low);
+        if (it == container.values.end() || *it != low)
+            return;
+        container.values.erase(it);
+    }
+
+    if (--container.cardinality == 0)
+        mContainers.removeAt(index);
+    else
+        container.optimize();
+}
+
+bool RoaringBitmap::contains(quint32 value) const
+{
+    const int index = findContainer(quint16(value >> 16));
+    return index >= 0 && mContainers.at(index).contains(quint16(value & 0xffff));
+}
+
+quint64 RoaringBitmap::cardinality() const
+{
+    quint64 total = 0;
+    for (const Container &container : mContainers)
+        total += container.cardinality;
+    return total;
+}
+
+bool RoaringBitmap::isEmpty() const
+{
+    return mContainers.isEmpty();
+}
+
+void RoaringBitmap::clear()
+{
+    mContainers.clear();
+}
+
+QVector<quint32> RoaringBitmap::toVector() const
+{
+    QVector<quint32> result;
+    result.reserve(int(cardinality()));
+    forEach([&result](quint32 value) { result.append(value); });
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int i = 0;
+    int j = 0;
+    while (i < mContainers.size() && j < other.mContainers.size()) {
+        const Container &a = mContainers.at(i);
+        const Container &b = other.mContainers.at(j);
+        if (a.key < b.key) {
+            ++i;
+        } else if (b.key < a.key) {
+            ++j;
+        } else {
+            Container container = intersect(a, b);
+            if (container.cardinality > 0)
+                result.mContainers.append(container);
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int i = 0;
+    int j = 0;
+    while (i < mContainers.size() || j < other.mContainers.size()) {
+        if (j >= other.mContainers.size()
+            || (i < mContainers.size() && mContainers.at(i).key < other.mContainers.at(j).key)) {
+            result.mContainers.append(mContainers.at(i++));
+        } else if (i >= mContainers.size() || other.mContainers.at(j).key < mContainers.at(i).key) {
+            result.mContainers.append(other.mContainers.at(j++));
+        } else {
+            result.mContainers.append(unite(mContainers.at(i++), other.mContainers.at(j++)));
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::andNot(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int j = 0;
+    for (const Container &a : mContainers) {
+        while (j < other.mContainers.size() && other.mContainers.at(j).key < a.key)
+            ++j;
+        if (j < other.mContainers.size() && other.mContainers.at(j).key == a.key) {
+            Container container = subtract(a, other.mContainers.at(j));
+            if (container.cardinality > 0)
+                result.mContainers.append(container);
+        } else {
+            result.mContainers.append(a);
+        }
+    }
+    return result;
+}
+
+QByteArray RoaringBitmap::serialize() const
+{
+    // Header: container count and padding. Each container: key, kind (0 for
+    // an array, 1 for a bitmap) and cardinality, followed by its values or
+    // words padded to 8 bytes.
+    QByteArray data;
+    const auto append32 = [&data](quint32 value) {
+        value = qToLittleEndian(value);
+        data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+
+    append32(quint32(mContainers.size()));
+    append32(0);
+    for (const Container &container : mContainers) {
+        append32(quint32(container.key) | (container.isBitmap() ? 0x10000u : 0u));
+        append32(quint32(container.cardinality));
+        if (container.isBitmap()) {
+            for (const quint64 word : container.words) {
+                const quint64 little = qToLittleEndian(word);
+                data.append(reinterpret_cast<const char *>(&little), sizeof(little));
+            }
+        } else {
+            for (const quint16 low : container.values) {
+                const quint16 little = qToLittleEndian(low);
+                data.append(reinterpret_cast<const char *>(&little), sizeof(little));
+            }
+            while (data.size() % 8)
+                data.append('\0');
+        }
+    }
+    return data;
+}
+
+RoaringBitmap RoaringBitmap::deserialize(QByteArrayView data)
+{
+    RoaringBitmap bitmap;
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.data());
+    qsizetype offset = 0;
+    const auto has = [&](qsizetype size) { return offset + size <= data.size(); };
+
+    if (!has(8))
+        return bitmap;
+    const quint32 count = qFromLittleEndian<quint32>(bytes);
+    offset = 8;
+
+    // Every container takes at least its 8 byte header, so a count beyond
+    // that is corrupt and must not reach reserve().
+    if (count > quint64(data.size() - 8) / 8)
+        return RoaringBitmap();
+
+    bitmap.mContainers.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        if (!has(8))
+            return RoaringBitmap();
+        const quint32 header = qFromLittleEndian<quint32>(bytes + offset);
+        Container container;
+        container.key = quint16(header & 0xffff);
+        const quint32 cardinality = qFromLittleEndian<quint32>(bytes + offset + 4);
+        container.cardinality = int(cardinality);
+        offset += 8;
+        if (cardinality == 0 || cardinality > 0x10000
+            || (!bitmap.mContainers.isEmpty() && container.key <= bitmap.mContainers.last().key))
+            return RoaringBitmap();
+
+        if (header & 0x10000u) {
+            if (!has(BitmapWords * 8))
+                return RoaringBitmap();
+            container.words.resize(BitmapWords);
+            int bits = 0;
+            for (int w = 0; w < BitmapWords; ++w) {
+                container.words[w] = qFromLittleEndian<quint64>(bytes + offset + w * 8);
+                bits += qPopulationCount(container.words.at(w));
+            }
+            if (bits != container.cardinality)
+                return RoaringBitmap();
+            offset += BitmapWords * 8;
+            // Other writers may keep small groups as bitmaps.
+            container.optimize();
+        } else {
+            const qsizetype size = (qsizetype(container.cardinality) * 2 + 7) / 8 * 8;
+            if (container.cardinality > ArrayLimit || !has(size))
+                return RoaringBitmap();
+            container.values.resize(container.cardinality);
+            for (int v = 0; v < container.cardinality; ++v) {
+                container.values[v] = qFromLittleEndian<quint16>(bytes + offset + v * 2);
+                if (v > 0 && container.values.at(v) <= container.values.at(v - 1))
+                    return RoaringBitmap();
+            }
+            offset += size;
+        }
+        bitmap.mContainers.append(container);
+    }
+    return bitmap;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap &other) const
+{
+    if (mContainers.size() != other.mContainers.size())
+        return false;
+
+    for (int i = 0; i < mContainers.size(); ++i) {
+        const Container &a = mContainers.at(i);
+        const Container &b = other.mContainers.at(i);
+        if (a.key != b.key || a.cardinality != b.cardinality)
+            return false;
+        if (a.isBitmap() == b.isBitmap()) {
+            if (a.values != b.values || a.words != b.words)
+                return false;
+            continue;
+        }
+
+        // Same cardinality, so the array's values all being set is enough.
+        const Container &array = a.isBitmap() ? b : a;
+        const Container &bitmap = a.isBitmap() ? a : b;
+        for (const quint16 low : array.values) {
+            if (!bitmap.contains(low))
+                return false;
+        }
+    }
+    return true;
+}
+
+int RoaringBitmap::findContainer(quint16 key) const
+{
+    // Binary search; returns -(insertion point) - 1 when the key is missing.
+    int first = 0;
+    int last = mContainers.size() - 1;
+    while (first <= last) {
+        const int middle = (first + last) / 2;
+        const quint16 middleKey = mContainers.at(middle).key;
+        if (middleKey < key)
+            first = middle + 1;
+        else if (key < middleKey)
+            last = middle - 1;
+        else
+            return middle;
+    }
+    return -first - 1;
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+
+    if (a.isBitmap() && b.isBitmap()) {
+        result.words.fill(0, BitmapWords);
+        for (int w = 0; w < BitmapWords; ++w) {
+            result.words[w] = a.words.at(w) & b.words.at(w);
+            result.cardinality += qPopulationCount(result.words.at(w));
+        }
+        result.optimize();
+        return result;
+    }
+
+    if (a.isBitmap() || b.isBitmap()) {
+        const Container &array = a.isBitmap() ? b : a;
+        const Container &bitmap = a.isBitmap() ? a : b;
+        for (const quint16 low : array.values) {
+            if (bitmap.contains(low))
+                result.values.append(low);
+        }
+    } else {
+        std::set_intersection(a.values.constBegin(), a.values.constEnd(),
+                              b.values.constBegin(), b.values.constEnd(),
+                              std::back_inserter(result.values));
+    }
+    result.cardinality = result.values.size();
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::unite(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+
+    if (!a.isBitmap() && !b.isBitmap()) {
+        result.values.reserve(a.values.size() + b.values.size());
+        std::set_union(a.values.constBegin(), a.values.constEnd(),
+                       b.values.constBegin(), b.values.constEnd(),
+                       std::back_inserter(result.values));
+        result.cardinality = result.values.size();
+        result.optimize();
+        return result;
+    }
+
+    Container left = a;
+    Container right = b;
+    if (!left.isBitmap())
+        left.toBitmap();
+    if (!right.isBitmap())
+        right.toBitmap();
+
+    result.words.fill(0, BitmapWords);
+    for (int w = 0; w < BitmapWords; ++w) {
+        result.words[w] = left.words.at(w) | right.words.at(w);
+        result.cardinality += qPopulationCount(result.words.at(w));
+    }
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::subtract(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+
+    if (a.isBitmap()) {
+        result.words = a.words;
+        if (b.isBitmap()) {
+            for (int w = 0; w < BitmapWords; ++w)
+                result.words[w] &= ~b.words.at(w);
+        } else {
+            for (const quint16 low : b.values)
+                result.words[low >> 6] &= ~(quint64(1) << (low & 63));
+        }
+        for (int w = 0; w < BitmapWords; ++w)
+            result.cardinality += qPopulationCount(result.words.at(w));
+        result.optimize();
+        return result;
+    }
+
+    for (const quint16 low : a.values) {
+        if (!b.contains(low))
+            result.values.append(low);
+    }
+    result.cardinality = result.values.size();
+    return result;
+}
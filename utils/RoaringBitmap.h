@@ -0,0 +1,90 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVector>
+#include <QtAlgorithms>
+
+// Compressed set of 32-bit values in the style of Roaring bitmaps. Values are
+// grouped by their upper 16 bits; each group is stored either as a sorted
+// array (sparse) or as a 65536-bit bitmap (dense), whichever is smaller, so
+// set operations touch 16-bit words or 64-bit words instead of single values.
+class RoaringBitmap
+{
+public:
+    void add(quint32 value);
+    void remove(quint32 value);
+    bool contains(quint32 value) const;
+
+    quint64 cardinality() const;
+    bool isEmpty() const;
+    void clear();
+
+    QVector<quint32> toVector() const;
+
+    template<typename Function>
+    void forEach(Function function) const;
+
+    RoaringBitmap operator&(const RoaringBitmap &other) const;
+    RoaringBitmap operator|(const RoaringBitmap &other) const;
+    RoaringBitmap andNot(const RoaringBitmap &other) const;
+
+    // Little-endian layout with 8-byte aligned containers, so it can be read
+    // straight out of a mapped file. deserialize() returns an empty bitmap
+    // for malformed data.
+    QByteArray serialize() const;
+    static RoaringBitmap deserialize(QByteArrayView data);
+
+    bool operator==(const RoaringBitmap &other) const;
+    bool operator!=(const RoaringBitmap &other) const { return !(*this == other); }
+
+private:
+    // Groups with more values than this are stored as bitmaps.
+    static constexpr int ArrayLimit = 4096;
+    static constexpr int BitmapWords = 1024;
+
+    struct Container
+    {
+        quint16 key = 0;
+        int cardinality = 0;
+        QVector<quint16> values; // sorted, used while cardinality <= ArrayLimit
+        QVector<quint64> words;  // BitmapWords words otherwise
+
+        bool isBitmap() const { return !words.isEmpty(); }
+        bool contains(quint16 low) const;
+        void toBitmap();
+        void toArray();
+        void optimize();
+    };
+
+    int findContainer(quint16 key) const;
+
+    static Container intersect(const Container &a, const Container &b);
+    static Container unite(const Container &a, const Container &b);
+    static Container subtract(const Container &a, const Container &b);
+
+    QVector<Container> mContainers; // sorted by key
+};
+
+template<typename Function>
+void RoaringBitmap::forEach(Function function) const
+{
+    for (const Container &container : mContainers) {
+        const quint32 high = quint32(container.key) << 16;
+        if (container.isBitmap()) {
+            for (int w = 0; w < BitmapWords; ++w) {
+                quint64 word = container.words.at(w);
+                while (word) {
+                    function(high | quint32(w * 64 + qCountTrailingZeroBits(word)));
+                    word &= word - 1;
+                }
+            }
+        } else {
+            for (const quint16 low : container.values)
+                function(high | low);
+        }
+    }
+}
+
+#endif // ROARINGBITMAP_H
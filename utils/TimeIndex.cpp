@@ -0,0 +1,33 @@
+#include "TimeIndex.h"
+
+void TimeIndex::insert(qint64 time, quint32 id)
+{
+    mEntries.emplace(time, id);
+}
+
+void TimeIndex::remove(qint64 time, quint32 id)
+{
+    mEntries.erase({ time, id });
+}
+
+void TimeIndex::clear()
+{
+    mEntries.clear();
+}
+
+int TimeIndex::size() const
+{
+    return int(mEntries.size());
+}
+
+QVector<quint32> TimeIndex::range(qint64 from, qint64 to) const
+{
+    QVector<quint32> ids;
+    if (from >= to)
+        return ids;
+
+    const auto end = mEntries.lower_bound({ to, 0 });
+    for (auto it = mEntries.lower_bound({ from, 0 }); it != end; ++it)
+        ids.append(it->second);
+    return ids;
+}
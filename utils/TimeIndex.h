@@ -0,0 +1,26 @@
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+#include <QVector>
+
+#include <set>
+#include <utility>
+
+// Ids ordered by a timestamp. Insertions and removals are O(log n); the ids
+// in a time range are read in O(log n + k), oldest first.
+class TimeIndex
+{
+public:
+    void insert(qint64 time, quint32 id);
+    void remove(qint64 time, quint32 id);
+    void clear();
+    int size() const;
+
+    // Ids with from <= time < to.
+    QVector<quint32> range(qint64 from, qint64 to) const;
+
+private:
+    std::set<std::pair<qint64, quint32>> mEntries;
+};
+
+#endif // TIMEINDEX_H
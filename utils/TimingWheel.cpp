@@ -0,0 +1,178 @@
+#include "TimingWheel.h"
+
+#include <QtAlgorithms>
+
+TimingWheel::TimingWheel(quint64 now)
+    : mNow(now)
+{
+}
+
+quint64 TimingWheel::now() const
+{
+    return mNow;
+}
+
+int TimingWheel::size() const
+{
+    return mNodes.size();
+}
+
+bool TimingWheel::contains(quint32 id) const
+{
+    return mNodes.contains(id);
+}
+
+void TimingWheel::schedule(quint32 id, quint64 tick)
+{
+    auto it = mNodes.find(id);
+    if (it == mNodes.end())
+        it = mNodes.insert(id, Node());
+    else
+        unlink(*it);
+
+    it->tick = tick;
+    it->slot = slotFor(tick);
+    link(id, *it);
+}
+
+void TimingWheel::cancel(quint32 id)
+{
+    const auto it = mNodes.find(id);
+    if (it == mNodes.end())
+        return;
+
+    unlink(*it);
+    mNodes.erase(it);
+}
+
+void TimingWheel::clear(quint64 now)
+{
+    mNow = now;
+    mNodes.clear();
+    mHeads.fill(0);
+    mOccupied.fill(0);
+    mOverflowSpan = NoTick;
+}
+
+quint64 TimingWheel::nextTick() const
+{
+    if (mHeads[DueSlot])
+        return mNow;
+
+    // Overflow ids come within range at the start of their span.
+    quint64 next = NoTick;
+    if (mHeads[OverflowSlot])
+        next = mOverflowSpan << Span;
+    for (int level = 0; level < Levels; ++level) {
+        if (!mOccupied[level])
+            continue;
+        const int shift = Bits * level;
+        const quint64 base = shift + Bits < 64 ? mNow >> (shift + Bits) << (shift + Bits) : 0;
+        const quint64 tick = base | quint64(qCountTrailingZeroBits(mOccupied[level])) << shift;
+        next = std::min(next, tick);
+    }
+    return next;
+}
+
+QVector<quint32> TimingWheel::advance(quint64 to)
+{
+    QVector<quint32> due = take(DueSlot);
+    for (const quint32 id : std::as_const(due))
+        mNodes.remove(id);
+
+    for (quint64 tick = nextTick(); tick <= to && tick != NoTick; tick = nextTick()) {
+        mNow = tick;
+
+        // The overflow first, then upper levels: what they hand down may be
+        // due on a lower level at this very tick.
+        for (int level = Levels; level >= 0; --level) {
+            const int shift = Bits * level;
+            if (level && tick & ((quint64(1) << shift) - 1))
+                continue;
+            int slot = OverflowSlot;
+            if (level < Levels) {
+                const int index = int(tick >> shift) & (Slots - 1);
+                if (!(mOccupied[level] >> index & 1))
+                    continue;
+                slot = level * Slots + index;
+            }
+
+            for (const quint32 id : take(slot)) {
+                Node &node = mNodes[id];
+                if (node.tick <= mNow) {
+                    due.append(id);
+                    mNodes.remove(id);
+                } else {
+                    node.slot = slotFor(node.tick);
+                    link(id, node);
+                }
+            }
+        }
+    }
+
+    mNow = std::max(mNow, to);
+    return due;
+}
+
+int TimingWheel::slotFor(quint64 tick) const
+{
+    if (tick <= mNow)
+        return DueSlot;
+
+    const quint64 differing = tick ^ mNow;
+    const int level = (63 - int(qCountLeadingZeroBits(differing))) / Bits;
+    if (level >= Levels)
+        return OverflowSlot;
+    return level * Slots + (int(tick >> (Bits * level)) & (Slots - 1));
+}
+
+void TimingWheel::link(quint32 id, Node &node)
+{
+    node.previous = 0;
+    node.next = mHeads[node.slot];
+    if (node.next)
+        mNodes[node.next].previous = id;
+    mHeads[node.slot] = id;
+    if (node.slot < DueSlot)
+        mOccupied[node.slot / Slots] |= quint64(1) << (node.slot % Slots);
+    else if (node.slot == OverflowSlot)
+        mOverflowSpan = std::min(mOverflowSpan, node.tick >> Span);
+}
+
+void TimingWheel::unlink(Node &node)
+{
+    if (node.previous)
+        mNodes[node.previous].next = node.next;
+    else
+        mHeads[node.slot] = node.next;
+    if (node.next)
+        mNodes[node.next].previous = node.previous;
+
+    if (!mHeads[node.slot] && node.slot < DueSlot)
+        mOccupied[node.slot / Slots] &= ~(quint64(1) << (node.slot % Slots));
+    else if (node.slot == OverflowSlot && node.tick >> Span == mOverflowSpan)
+        updateOverflowSpan();
+}
+
+QVector<quint32> TimingWheel::take(int slot)
+{
+    QVector<quint32> ids;
+    for (quint32 id = mHeads[slot]; id; id = mNodes[id].next)
+        ids.append(id);
+
+    mHeads[slot] = 0;
+    if (slot < DueSlot)
+        mOccupied[slot / Slots] &= ~(quint64(1) << (slot % Slots));
+    else if (slot == OverflowSlot)
+        mOverflowSpan = NoTick;
+    return ids;
+}
+
+// Only needed when the earliest overflow id leaves, and the overflow only
+// holds ticks more than two thousand years ahead at one-second ticks.
+void TimingWheel::updateOverflowSpan()
+{
+    mOverflowSpan = NoTick;
+    for (quint32 id = mHeads[OverflowSlot]; id; id = mNodes[id].next)
+        mOverflowSpan = std::min(mOverflowSpan, mNodes[id].tick >> Span);
+}
@@ -0,0 +1,73 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QHash>
+#include <QVector>
+
+#include <array>
+
+// Hierarchical timing wheel of ids due at integer ticks.
+//
+// Six levels of 64 slots cover 2^36 ticks. An id sits at the level of the
+// highest 6-bit group in which its tick differs from now(), in the slot for
+// that group, so every occupied slot lies ahead of the current one and is
+// reached without wrapping. When time reaches a slot on an upper level its
+// ids move down; on level 0 they fire. Ids further ahead than that, whose
+// tick differs from now() above bit 36, wait in an overflow list until time
+// reaches their 2^36 span. Slots are intrusive lists, so scheduling and
+// cancelling are O(1), and nextTick() only looks at one occupancy word per
+// level.
+class TimingWheel
+{
+public:
+    static constexpr quint64 NoTick = ~quint64(0);
+
+    explicit TimingWheel(quint64 now = 0);
+
+    quint64 now() const;
+    int size() const;
+    bool contains(quint32 id) const;
+
+    // Replaces any earlier schedule of id. Ticks not after now() fire on
+    // the next advance().
+    void schedule(quint32 id, quint64 tick);
+    void cancel(quint32 id);
+    void clear(quint64 now);
+
+    // The earliest tick at which advance() has work to do, or NoTick.
+    quint64 nextTick() const;
+
+    // Moves time forward and returns the ids that became due, in tick order.
+    QVector<quint32> advance(quint64 to);
+
+private:
+    static constexpr int Levels = 6;
+    static constexpr int Bits = 6;
+    static constexpr int Slots = 1 << Bits;
+    static constexpr int DueSlot = Levels * Slots; // already due
+    static constexpr int OverflowSlot = DueSlot + 1; // beyond the top level
+    static constexpr int Span = Levels * Bits;
+
+    struct Node
+    {
+        quint64 tick = 0;
+        quint32 previous = 0;
+        quint32 next = 0;
+        int slot = 0;
+    };
+
+    int slotFor(quint64 tick) const;
+    void link(quint32 id, Node &node);
+    void unlink(Node &node);
+    // Empties a slot and returns its ids.
+    QVector<quint32> take(int slot);
+    void updateOverflowSpan();
+
+    quint64 mNow;
+    QHash<quint32, Node> mNodes;
+    std::array<quint32, OverflowSlot + 1> mHeads {};
+    std::array<quint64, Levels> mOccupied {};
+    quint64 mOverflowSpan = NoTick; // earliest tick >> Span in the overflow
+};
+
+#endif // TIMINGWHEEL_H
@@ -0,0 +1,272 @@
+#include "VisibleRangeTree.h"
+
+#include <algorithm>
+
+void VisibleRangeTree::reset(int size)
+{
+    mNodes.clear();
+    mRoot = -1;
+    insert(0, size);
+}
+
+int VisibleRangeTree::size() const
+{
+    return subtreeSize(mRoot);
+}
+
+void VisibleRangeTree::insert(int position, int count)
+{
+    if (count <= 0)
+        return;
+
+    // Build the run as a treap in one pass over a stack of its right spine.
+    QVector<int> spine;
+    for (int i = 0; i < count; ++i) {
+        const int node = newNode();
+        int last = -1;
+        while (!spine.isEmpty() && mNodes.at(spine.last()).priority < mNodes.at(node).priority) {
+            last = spine.takeLast();
+            pull(last);
+        }
+        mNodes[node].left = last;
+        if (!spine.isEmpty())
+            mNodes[spine.last()].right = node;
+        spine.append(node);
+    }
+    while (spine.size() > 1)
+        pull(spine.takeLast());
+    const int run = spine.first();
+    pull(run);
+
+    int left = -1;
+    int right = -1;
+    split(mRoot, position, left, right);
+    mRoot = merge(merge(left, run), right);
+}
+
+void VisibleRangeTree::hide(int first, int last)
+{
+    update(first, last, 1);
+}
+
+void VisibleRangeTree::show(int first, int last)
+{
+    update(first, last, -1);
+}
+
+bool VisibleRangeTree::isVisible(int position) const
+{
+    if (position < 0 || position >= size())
+        return false;
+
+    int node = mRoot;
+    int add = 0;
+    for (;;) {
+        const Node &n = mNodes.at(node);
+        const int leftSize = subtreeSize(n.left);
+        if (position == leftSize)
+            return n.cover + add == 0;
+        add += n.add;
+        if (position < leftSize) {
+            node = n.left;
+        } else {
+            position -= leftSize + 1;
+            node = n.right;
+        }
+    }
+}
+
+int VisibleRangeTree::visibleCount() const
+{
+    return visibleIn(mRoot, 0);
+}
+
+int VisibleRangeTree::countVisible(int first, int last) const
+{
+    if (first > last)
+        return 0;
+    return visibleBefore(last + 1) - visibleBefore(first);
+}
+
+int VisibleRangeTree::rank(int position) const
+{
+    return visibleBefore(position);
+}
+
+int VisibleRangeTree::select(int k) const
+{
+    if (k < 0 || k >= visibleCount())
+        return -1;
+
+    int node = mRoot;
+    int add = 0;
+    int position = 0;
+    for (;;) {
+        const Node &n = mNodes.at(node);
+        const int leftVisible = visibleIn(n.left, add + n.add);
+        if (k < leftVisible) {
+            add += n.add;
+            node = n.left;
+            continue;
+        }
+        k -= leftVisible;
+        position += subtreeSize(n.left);
+        if (n.cover + add == 0) {
+            if (k == 0)
+                return position;
+            --k;
+        }
+        add += n.add;
+        ++position;
+        node = n.right;
+    }
+}
+
+int VisibleRangeTree::newNode()
+{
+    // xorshift32 is plenty to keep the treap balanced in expectation.
+    mSeed ^= mSeed << 13;
+    mSeed ^= mSeed >> 17;
+    mSeed ^= mSeed << 5;
+
+    Node node;
+    node.priority = mSeed;
+    mNodes.append(node);
+    return mNodes.size() - 1;
+}
+
+int VisibleRangeTree::subtreeSize(int node) const
+{
+    return node >= 0 ? mNodes.at(node).size : 0;
+}
+
+int VisibleRangeTree::visibleIn(int node, int add) const
+{
+    if (node < 0)
+        return 0;
+    const Node &n = mNodes.at(node);
+    return n.minCover + add == 0 ? n.minCount : 0;
+}
+
+int VisibleRangeTree::visibleBefore(int position) const
+{
+    int node = mRoot;
+    int add = 0;
+    int visible = 0;
+    while (node >= 0 && position > 0) {
+        const Node &n = mNodes.at(node);
+        const int leftSize = subtreeSize(n.left);
+        if (position <= leftSize) {
+            add += n.add;
+            node = n.left;
+            continue;
+        }
+        visible += visibleIn(n.left, add + n.add);
+        if (n.cover + add == 0)
+            ++visible;
+        position -= leftSize + 1;
+        add += n.add;
+        node = n.right;
+    }
+    return visible;
+}
+
+void VisibleRangeTree::apply(int node, int delta)
+{
+    if (node < 0)
+        return;
+    Node &n = mNodes[node];
+    n.cover += delta;
+    n.add += delta;
+    n.minCover += delta;
+}
+
+void VisibleRangeTree::push(int node)
+{
+    Node &n = mNodes[node];
+    if (n.add == 0)
+        return;
+    const int delta = n.add;
+    n.add = 0;
+    apply(n.left, delta);
+    apply(n.right, delta);
+}
+
+void VisibleRangeTree::pull(int node)
+{
+    Node &n = mNodes[node];
+    n.size = 1;
+    n.minCover = n.cover;
+    n.minCount = 1;
+    for (const int child : {n.left, n.right}) {
+        if (child < 0)
+            continue;
+        // The node's own add is still owed to its children.
+        const Node &c = mNodes.at(child);
+        const int minCover = c.minCover + n.add;
+        n.size += c.size;
+        if (minCover < n.minCover) {
+            n.minCover = minCover;
+            n.minCount = c.minCount;
+        } else if (minCover == n.minCover) {
+            n.minCount += c.minCount;
+        }
+    }
+}
+
+void VisibleRangeTree::split(int node, int count, int &left, int &right)
+{
+    if (node < 0) {
+        left = right = -1;
+        return;
+    }
+
+    push(node);
+    if (subtreeSize(mNodes.at(node).left) >= count) {
+        int rest = -1;
+        split(mNodes.at(node).left, count, left, rest);
+        mNodes[node].left = rest;
+        right = node;
+    } else {
+        int rest = -1;
+        split(mNodes.at(node).right, count - subtreeSize(mNodes.at(node).left) - 1, rest, right);
+        mNodes[node].right = rest;
+        left = node;
+    }
+    pull(node);
+}
+
+int VisibleRangeTree::merge(int left, int right)
+{
+    if (left < 0)
+        return right;
+    if (right < 0)
+        return left;
+
+    if (mNodes.at(left).priority > mNodes.at(right).priority) {
+        push(left);
+        mNodes[left].right = merge(mNodes.at(left).right, right);
+        pull(left);
+        return left;
+    }
+    push(right);
+    mNodes[right].left = merge(left, mNodes.at(right).left);
+    pull(right);
+    return right;
+}
+
+void VisibleRangeTree::update(int first, int last, int delta)
+{
+    first = std::max(first, 0);
+    last = std::min(last, size() - 1);
+    if (first > last)
+        return;
+
+    int left = -1;
+    int middle = -1;
+    int right = -1;
+    split(mRoot, first, left, middle);
+    split(middle, last - first + 1, middle, right);
+    apply(middle, delta);
+    mRoot = merge(merge(left, middle), right);
+}
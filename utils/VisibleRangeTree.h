@@ -0,0 +1,65 @@
+#ifndef VISIBLERANGETREE_H
+#define VISIBLERANGETREE_H
+
+#include <QVector>
+
+// Balanced tree over a linearized sequence of positions where ranges can be
+// hidden and shown again, and runs of positions inserted anywhere. Hidden
+// ranges may nest; a position is visible when no range covering it is hidden.
+// Every operation is O(log n) expected, independent of the length of the
+// affected range; inserting a run additionally costs its length.
+class VisibleRangeTree
+{
+public:
+    void reset(int size);
+
+    int size() const;
+
+    // Inserts count visible positions before position, shifting the later
+    // ones. They are covered by no hidden range, not even one around them.
+    void insert(int position, int count);
+
+    void hide(int first, int last);
+    void show(int first, int last);
+
+    bool isVisible(int position) const;
+    int visibleCount() const;
+    int countVisible(int first, int last) const;
+
+    // Number of visible positions before position.
+    int rank(int position) const;
+    // Position of the k-th visible position.
+    int select(int k) const;
+
+private:
+    // Treap nodes keyed by their index in the sequence. A node's cover and
+    // minimum already include its own add, which is still owed to its
+    // children.
+    struct Node {
+        int left = -1;
+        int right = -1;
+        quint32 priority = 0;
+        int size = 1;
+        int cover = 0;
+        int add = 0;
+        int minCover = 0;
+        int minCount = 1;
+    };
+
+    int newNode();
+    int subtreeSize(int node) const;
+    int visibleIn(int node, int add) const;
+    int visibleBefore(int position) const;
+    void apply(int node, int delta);
+    void push(int node);
+    void pull(int node);
+    void split(int node, int count, int &left, int &right);
+    int merge(int left, int right);
+    void update(int first, int last, int delta);
+
+    QVector<Node> mNodes;
+    int mRoot = -1;
+    quint32 mSeed = 0x9e3779b9;
+};
+
+#endif // VISIBLERANGETREE_H